@@ -0,0 +1,91 @@
+"""Native DDF/DRDF deadband sensor filter for ESPHome."""
+
+import esphome.config_validation as cv
+import esphome.codegen as cg
+from esphome.const import CONF_MODE, ENTITY_CATEGORY_DIAGNOSTIC, STATE_CLASS_MEASUREMENT
+from esphome.components import sensor
+
+DEPENDENCIES = ["sensor"]
+
+deadband_filter_ns = cg.esphome_ns.namespace("deadband_filter")
+DeadbandFilter = deadband_filter_ns.class_("DeadbandFilter", sensor.Filter)
+DeadbandMode = deadband_filter_ns.enum("DeadbandMode")
+
+DEADBAND_MODES = {
+    "ddf": DeadbandMode.DEADBAND_MODE_DDF,
+    "drdf": DeadbandMode.DEADBAND_MODE_DRDF,
+    "drdf_quantile": DeadbandMode.DEADBAND_MODE_DRDF_QUANTILE,
+}
+
+CONF_DEADBAND_FILTER = "deadband_filter"
+CONF_CONTRACTION_FACTOR = "contraction_factor"
+CONF_ALPHA = "alpha"
+CONF_MULTIPLIER = "multiplier"
+CONF_QUANTILE = "quantile"
+CONF_FAST_START = "fast_start"
+CONF_INITIAL_DEADBAND = "initial_deadband"
+CONF_RESTORE_VALUE = "restore_value"
+CONF_RESTORE_KEY = "restore_key"
+CONF_DEADBAND_SENSOR = "deadband_sensor"
+
+# Top-level `deadband_filter:` (no options) loads this module so the sensor filter is registered.
+CONFIG_SCHEMA = cv.Schema({})
+
+def _validate_restore(config):
+    # Filters have no user id, and the generated one moves when the filter list changes.
+    if config[CONF_RESTORE_VALUE] and CONF_RESTORE_KEY not in config:
+        raise cv.Invalid("restore_value requires restore_key (a name unique to this sensor)")
+    return config
+
+
+DEADBAND_FILTER_SCHEMA = cv.All(cv.Schema(
+    {
+        cv.Optional(CONF_MODE, default="drdf"): cv.enum(DEADBAND_MODES, lower=True),
+        cv.Optional(CONF_CONTRACTION_FACTOR, default=0.998): cv.float_range(
+            min=0.5, max=1.0
+        ),
+        cv.Optional(CONF_ALPHA, default=0.01): cv.float_range(
+            min=0.0, min_included=False, max=1.0
+        ),
+        cv.Optional(CONF_MULTIPLIER, default=3.82): cv.float_range(
+            min=0.0, min_included=False
+        ),
+        cv.Optional(CONF_QUANTILE, default=0.99): cv.float_range(min=0.5, max=0.999),
+        cv.Optional(CONF_FAST_START, default=True): cv.boolean,
+        cv.Optional(CONF_INITIAL_DEADBAND, default=0.0): cv.float_range(min=0.0),
+        cv.Optional(CONF_RESTORE_VALUE, default=False): cv.boolean,
+        cv.Optional(CONF_RESTORE_KEY): cv.string_strict,
+        cv.Optional(CONF_DEADBAND_SENSOR): sensor.sensor_schema(
+            accuracy_decimals=4,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+), _validate_restore)
+
+
+@sensor.FILTER_REGISTRY.register(
+    CONF_DEADBAND_FILTER, DeadbandFilter, DEADBAND_FILTER_SCHEMA
+)
+async def deadband_filter_to_code(config, filter_id):
+    var = cg.new_Pvariable(
+        filter_id,
+        config[CONF_MODE],
+        config[CONF_CONTRACTION_FACTOR],
+        config[CONF_ALPHA],
+        config[CONF_MULTIPLIER],
+        config[CONF_INITIAL_DEADBAND],
+    )
+    cg.add(var.set_fast_start(config[CONF_FAST_START]))
+    if config[CONF_MODE] == "drdf_quantile":
+        cg.add(var.set_quantile(config[CONF_QUANTILE]))
+    if config[CONF_RESTORE_VALUE]:
+        cg.add(var.set_restore(config[CONF_RESTORE_KEY]))
+    if CONF_DEADBAND_SENSOR in config:
+        sens = await sensor.new_sensor(config[CONF_DEADBAND_SENSOR])
+        cg.add(var.set_deadband_sensor(sens))
+    return var
+
+
+async def to_code(config):
+    pass
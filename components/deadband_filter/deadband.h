@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "p2_quantile.h"
+
+namespace esphome {
+namespace deadband_filter {
+
+// Dynamic deadband filters (no ESPHome headers, so host tools can use them). The output is the
+// center of a band [lower, upper] that slides with the raw value whenever the value leaves it;
+// values inside the band leave the output unchanged. The filters differ in how the band width
+// adapts:
+//   DDF:  on a trend reversal outside the band only the exceeded bound moves (the band grows);
+//         a reversal inside the band shrinks it by contraction_factor.
+//   DRDF: width = multiplier * EMA(alpha) of |difference| between consecutive reversal values.
+//   DRDF quantile: width = streaming `quantile` (P²) of the same differences, with no
+//         normality assumption.
+// fast_start: the EMA uses alpha = max(alpha, 1/k) for the k-th difference (a running mean at
+// first); the quantile is applied from the first difference instead of after 1/(1-quantile),
+// extrapolated from the p/2 marker and the max until then (P2Quantile::get_extrapolated()).
+enum DeadbandMode : uint8_t {
+  DEADBAND_MODE_DDF = 0,
+  DEADBAND_MODE_DRDF = 1,
+  DEADBAND_MODE_DRDF_QUANTILE = 2,
+};
+
+// Weight of a width that did not come from this run (initial_deadband or restored), in
+// reversal differences: fast start blends it in like that many samples instead of dropping it.
+static const uint16_t DEADBAND_PRIOR_DIFFS = 100;
+
+struct DeadbandParams {
+  DeadbandMode mode{DEADBAND_MODE_DRDF};
+  float contraction_factor{0.998f};  // DDF
+  float alpha{0.01f};                // DRDF
+  float multiplier{3.82f};           // DRDF
+  float quantile{0.99f};             // DRDF quantile
+  bool fast_start{true};             // DRDF, DRDF quantile
+};
+
+// Per-channel state (28 bytes; DRDF quantile keeps a P2Quantile next to it). upper is NaN until
+// the first value; width is kept when the bounds are reset so a warm start (restore or
+// initial_deadband) begins with the learned band.
+struct DeadbandState {
+  float upper{NAN};
+  float lower{NAN};
+  float previous{NAN};
+  float width{0.0f};
+  float ema{0.0f};       // DRDF: EMA of reversal differences (0 = none seen yet)
+  float reversal{NAN};   // DRDF: value at the last reversal
+  int8_t trend{0};       // -1 down, 0 neutral, 1 up
+  bool reversal_pending{false};  // DRDF: previous step was a reversal
+  uint16_t diffs{0};     // DRDF: reversal differences seen (saturating; DEADBAND_PRIOR_DIFFS with a prior)
+};
+
+inline void deadband_recenter(DeadbandState &s, float width) {
+  float center = 0.5f * (s.upper + s.lower);
+  s.width = width;
+  s.upper = center + 0.5f * width;
+  s.lower = center - 0.5f * width;
+}
+
+// Moves both bounds with the value when it leaves the band (width unchanged).
+inline void deadband_slide(DeadbandState &s, float x) {
+  if (x > s.upper) {
+    s.lower += x - s.upper;
+    s.upper = x;
+  } else if (x < s.lower) {
+    s.upper -= s.lower - x;
+    s.lower = x;
+  }
+}
+
+// New DRDF band width after the reversal difference diff, or NaN to keep the current one.
+inline float deadband_drdf_width(const DeadbandParams &p, DeadbandState &s, P2Quantile *q, float diff) {
+  if (s.diffs < UINT16_MAX)
+    s.diffs++;
+  if (p.mode == DEADBAND_MODE_DRDF_QUANTILE) {
+    if (q == nullptr)
+      return NAN;
+    q->add(diff);
+    // Without fast start, or over a prior width, wait until the quantile is backed by data.
+    if (p.fast_start && s.diffs == q->count())
+      return q->get_extrapolated();
+    return (float) q->count() * (1.0f - p.quantile) >= 1.0f ? q->get() : NAN;
+  }
+  if (p.fast_start) {
+    float alpha = 1.0f / (float) s.diffs;
+    s.ema += (alpha > p.alpha ? alpha : p.alpha) * (diff - s.ema);
+  } else {
+    s.ema = s.ema == 0.0f ? diff : s.ema + p.alpha * (diff - s.ema);
+  }
+  return s.ema * p.multiplier;
+}
+
+// One sample; returns the band center. NaN is passed through and leaves the state untouched.
+// q is only used (and required) by DEADBAND_MODE_DRDF_QUANTILE.
+inline float deadband_step(const DeadbandParams &p, DeadbandState &s, float x, P2Quantile *q = nullptr) {
+  if (std::isnan(x))
+    return x;
+  if (std::isnan(s.upper)) {
+    s.upper = x + 0.5f * s.width;
+    s.lower = x - 0.5f * s.width;
+    s.previous = x;
+    s.trend = 0;
+    s.reversal_pending = false;
+    return 0.5f * (s.upper + s.lower);
+  }
+  int8_t trend = x > s.previous ? 1 : (x < s.previous ? -1 : 0);
+  if (trend == 0 && p.mode == DEADBAND_MODE_DDF)
+    trend = s.trend;  // DDF keeps the trend through equal values
+  bool reversed = s.trend != 0 && trend != 0 && trend != s.trend;
+
+  if (p.mode == DEADBAND_MODE_DDF) {
+    if (!reversed) {
+      deadband_slide(s, x);
+    } else if (x > s.upper) {
+      s.upper = x;
+    } else if (x < s.lower) {
+      s.lower = x;
+    } else {
+      deadband_recenter(s, (s.upper - s.lower) * p.contraction_factor);
+    }
+    s.width = s.upper - s.lower;
+  } else {
+    if (reversed) {
+      if (s.reversal_pending) {
+        float width = deadband_drdf_width(p, s, q, std::fabs(x - s.reversal));
+        if (!std::isnan(width))
+          deadband_recenter(s, width);
+      }
+      s.reversal_pending = true;
+      s.reversal = x;
+    } else {
+      s.reversal_pending = false;
+    }
+    deadband_slide(s, x);
+  }
+  s.previous = x;
+  s.trend = trend;
+  return 0.5f * (s.upper + s.lower);
+}
+
+}  // namespace deadband_filter
+}  // namespace esphome
@@ -0,0 +1,91 @@
+#include "deadband_filter.h"
+#include "esphome/core/log.h"
+#include <cmath>
+
+namespace esphome {
+namespace deadband_filter {
+
+static const char *const TAG = "deadband_filter";
+
+// Relative width change that triggers a preferences write (restore only) or a width publish.
+static const float SAVE_THRESHOLD = 0.01f;
+
+DeadbandFilter::DeadbandFilter(DeadbandMode mode, float contraction_factor, float alpha, float multiplier,
+                               float initial_deadband) {
+  params_.mode = mode;
+  params_.contraction_factor = contraction_factor;
+  params_.alpha = alpha;
+  params_.multiplier = multiplier;
+  state_.width = initial_deadband;
+  if (mode == DEADBAND_MODE_DRDF && multiplier > 0.0f)
+    state_.ema = initial_deadband / multiplier;
+  if (initial_deadband > 0.0f)
+    state_.diffs = DEADBAND_PRIOR_DIFFS;
+}
+
+void DeadbandFilter::set_quantile(float quantile) {
+  params_.quantile = quantile;
+  if (!quantile_)
+    quantile_.reset(new P2Quantile());
+  quantile_->set_quantile(quantile);
+}
+
+optional<float> DeadbandFilter::new_value(float value) {
+  if (restore_hash_ != 0 && !pref_ready_)
+    this->load_band_();
+  float out = deadband_step(params_, state_, value, quantile_.get());
+  if (pref_ready_ && std::fabs(state_.width - saved_width_) > SAVE_THRESHOLD * saved_width_)
+    this->save_band_();
+  if (deadband_sensor_ != nullptr &&
+      !(std::fabs(state_.width - published_width_) <= SAVE_THRESHOLD * published_width_)) {
+    published_width_ = state_.width;
+    deadband_sensor_->publish_state(state_.width);
+  }
+  return out;
+}
+
+void DeadbandFilter::reset(bool keep_width) {
+  float width = state_.width;
+  float ema = state_.ema;
+  uint16_t diffs = state_.diffs;
+  state_ = DeadbandState{};
+  if (keep_width) {
+    state_.width = width;
+    state_.ema = ema;
+    state_.diffs = diffs;
+  } else if (quantile_) {
+    quantile_->reset();
+  }
+}
+
+// Preferences are opened on the first value rather than in the constructor, which runs while
+// the sensors are being built.
+void DeadbandFilter::load_band_() {
+  pref_ = global_preferences->make_preference<SavedBand>(restore_hash_, true);
+  pref_ready_ = true;
+  SavedBand saved;
+  if (!pref_.load(&saved) || !std::isfinite(saved.width) || !std::isfinite(saved.ema) || saved.width < 0.0f ||
+      saved.ema < 0.0f) {
+    saved_width_ = state_.width;
+    return;
+  }
+  state_.width = saved.width;
+  state_.ema = saved.ema;
+  if (saved.width > 0.0f && state_.diffs < DEADBAND_PRIOR_DIFFS)
+    state_.diffs = DEADBAND_PRIOR_DIFFS;
+  saved_width_ = saved.width;
+  ESP_LOGD(TAG, "restored deadband %.4f", saved.width);
+}
+
+// Writes go to the preferences cache; flash is written at preferences: flash_write_interval.
+void DeadbandFilter::save_band_() {
+  SavedBand saved{state_.width, state_.ema};
+  if (!pref_.save(&saved)) {
+    ESP_LOGW(TAG, "saving the deadband failed");
+    return;
+  }
+  saved_width_ = state_.width;
+}
+
+}  // namespace deadband_filter
+}  // namespace esphome
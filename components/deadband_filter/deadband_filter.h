@@ -0,0 +1,58 @@
+#pragma once
+
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+#include "deadband.h"
+#include <cmath>
+#include <memory>
+
+namespace esphome {
+namespace deadband_filter {
+
+// Sensor filter `deadband_filter:` (DDF or DRDF, see deadband.h). One class for every channel;
+// each instance only carries its parameters and a DeadbandState (plus a P2Quantile in
+// drdf_quantile mode).
+class DeadbandFilter : public sensor::Filter {
+ public:
+  DeadbandFilter(DeadbandMode mode, float contraction_factor, float alpha, float multiplier, float initial_deadband);
+
+  optional<float> new_value(float value) override;
+
+  // DRDF quantile: target quantile of the reversal differences (allocates the estimator).
+  void set_quantile(float quantile);
+  void set_fast_start(bool fast_start) { params_.fast_start = fast_start; }
+
+  // Keeps the learned band across reboots under restore_key. Loaded on the first value.
+  void set_restore(const std::string &key) { restore_hash_ = fnv1_hash("deadband_filter:" + key); }
+  // Publishes the band width when it changes by more than 1 %.
+  void set_deadband_sensor(sensor::Sensor *s) { deadband_sensor_ = s; }
+
+  // C++ API for code that owns the filter (YAML filters have no id to reach it by).
+  // Drops the bounds (the next value starts a new band); keep_width keeps the learned width.
+  void reset(bool keep_width = true);
+  float get_deadband() const { return state_.width; }
+  const DeadbandState &get_state() const { return state_; }
+  const DeadbandParams &get_params() const { return params_; }
+
+ protected:
+  struct SavedBand {
+    float width;
+    float ema;
+  };
+  void load_band_();
+  void save_band_();
+
+  DeadbandParams params_;
+  DeadbandState state_;
+  std::unique_ptr<P2Quantile> quantile_;
+  ESPPreferenceObject pref_;
+  uint32_t restore_hash_{0};
+  float saved_width_{0.0f};
+  sensor::Sensor *deadband_sensor_{nullptr};
+  float published_width_{NAN};
+  bool pref_ready_{false};
+};
+
+}  // namespace deadband_filter
+}  // namespace esphome
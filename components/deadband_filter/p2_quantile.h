@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace deadband_filter {
+
+// Streaming estimate of the p-quantile with the P² algorithm (Jain & Chlamtac, 1985): five
+// markers (min, p/2, p, (1+p)/2, max) whose heights are adjusted by piecewise-parabolic
+// interpolation as values arrive. Constant memory and O(1) per value. Until five values are seen
+// the markers hold them sorted and get() returns their exact sample quantile. Desired positions
+// are derived from one exact counter rather than accumulated (float sums of p drift by whole
+// positions after ~1e5 values). Positions are halved when they reach RESCALE so the counter stays
+// exact (this also lets older values weigh less).
+class P2Quantile {
+ public:
+  static constexpr int32_t RESCALE = 1 << 20;
+
+  void set_quantile(float p) {
+    p_ = p;
+    dn_[0] = 0.0f;
+    dn_[1] = 0.5f * p;
+    dn_[2] = p;
+    dn_[3] = 0.5f * (1.0f + p);
+    dn_[4] = 1.0f;
+    this->reset();
+  }
+  float get_quantile() const { return p_; }
+
+  void reset() { count_ = 0; }
+  uint32_t count() const { return count_; }
+
+  void add(float x) {
+    if (count_ < 5) {
+      int i = count_;
+      while (i > 0 && q_[i - 1] > x) {
+        q_[i] = q_[i - 1];
+        i--;
+      }
+      q_[i] = x;
+      count_++;
+      if (count_ == 5) {
+        for (int m = 0; m < 5; m++)
+          n_[m] = m;
+        span_ = 4.0f;
+      }
+      return;
+    }
+    if (count_ < UINT32_MAX)
+      count_++;
+
+    int k;
+    if (x < q_[0]) {
+      q_[0] = x;
+      k = 0;
+    } else if (x >= q_[4]) {
+      q_[4] = x;
+      k = 3;
+    } else {
+      k = 0;
+      while (x >= q_[k + 1])
+        k++;
+    }
+    for (int m = k + 1; m < 5; m++)
+      n_[m]++;
+    span_ += 1.0f;
+
+    if (n_[4] >= RESCALE) {
+      for (int m = 1; m < 5; m++) {
+        n_[m] = n_[m] / 2 > n_[m - 1] ? n_[m] / 2 : n_[m - 1] + 1;
+      }
+      span_ *= 0.5f;
+    }
+    for (int m = 1; m < 4; m++) {
+      float d = dn_[m] * span_ - (float) n_[m];
+      if ((d >= 1.0f && n_[m + 1] - n_[m] > 1) || (d <= -1.0f && n_[m - 1] - n_[m] < -1)) {
+        int s = d > 0.0f ? 1 : -1;
+        float qp = this->parabolic_(m, (float) s);
+        if (q_[m - 1] < qp && qp < q_[m + 1]) {
+          q_[m] = qp;
+        } else {
+          q_[m] += (float) s * (q_[m + s] - q_[m]) / (float) (n_[m + s] - n_[m]);
+        }
+        n_[m] += s;
+      }
+    }
+  }
+
+  // NaN while empty. While fewer than 1/(1-p) values are seen the sample p-quantile is their
+  // maximum, which is returned instead of the still-converging middle marker.
+  float get() const {
+    if (count_ == 0)
+      return NAN;
+    if (count_ < 5) {
+      int i = (int) std::ceil(p_ * (float) count_) - 1;
+      return q_[i < 0 ? 0 : i];
+    }
+    if ((float) count_ * (1.0f - p_) < 1.0f)
+      return q_[4];
+    return q_[2];
+  }
+
+  // get() with a tail extrapolation while fewer than 1/(1-p) values are seen, when the max
+  // underestimates the p-quantile (about half of it at p = 0.99 after 25-50 heavy-tailed values).
+  // A power-law tail is fitted through the p/2 marker and the max (taken at plotting position
+  // count/(count+1)) and read at p, capped at twice the max. Falls back to the max when the two
+  // do not span a positive range.
+  float get_extrapolated() const {
+    if (count_ == 0 || (float) count_ * (1.0f - p_) >= 1.0f)
+      return this->get();
+    float hi = q_[count_ < 5 ? count_ - 1 : 4];
+    float lo = q_[1];
+    if (count_ < 5) {
+      int i = (int) std::ceil(0.5f * p_ * (float) count_) - 1;
+      lo = q_[i < 0 ? 0 : i];
+    }
+    if (!(lo > 0.0f) || hi <= lo)
+      return hi;
+    float tail_hi = 1.0f / (float) (count_ + 1);  // 1 - plotting position of the max
+    float slope = std::log(hi / lo) / std::log((1.0f - 0.5f * p_) / tail_hi);
+    float x = hi * std::exp(slope * std::log(tail_hi / (1.0f - p_)));
+    return x < 2.0f * hi ? x : 2.0f * hi;
+  }
+
+ protected:
+  float parabolic_(int m, float s) const {
+    float n0 = (float) n_[m - 1], n1 = (float) n_[m], n2 = (float) n_[m + 1];
+    return q_[m] + s / (n2 - n0) *
+                       ((n1 - n0 + s) * (q_[m + 1] - q_[m]) / (n2 - n1) + (n2 - n1 - s) * (q_[m] - q_[m - 1]) / (n1 - n0));
+  }
+
+  float p_{0.5f};
+  float dn_[5]{0.0f, 0.25f, 0.5f, 0.75f, 1.0f};  // marker quantiles
+  float q_[5]{};   // marker heights
+  float span_{0.0f};  // desired position of the max marker; marker m is wanted at dn_[m] * span_
+  int32_t n_[5]{};  // marker positions
+  uint32_t count_{0};
+};
+
+}  // namespace deadband_filter
+}  // namespace esphome
@@ -5,18 +5,38 @@ import esphome.codegen as cg
 from esphome.const import (
     CONF_ID,
     CONF_NAME,
+    CONF_SENSOR,
     DEVICE_CLASS_HUMIDITY,
     DEVICE_CLASS_TEMPERATURE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
     UNIT_CELSIUS,
+    UNIT_MILLISECOND,
     UNIT_PERCENT,
+    UNIT_SECOND,
 )
 from esphome.components import sensor
+from esphome.components.esp32 import add_idf_component
+from esphome.core import CORE
 
 DEPENDENCIES = ["sensor"]
 
 hp_ukf_ns = cg.esphome_ns.namespace("hp_ukf")
 HpUkfComponent = hp_ukf_ns.class_("HpUkfComponent", cg.PollingComponent)
+HpUkfBankComponent = hp_ukf_ns.class_("HpUkfBankComponent", cg.PollingComponent)
+FilterMode = hp_ukf_ns.enum("FilterMode")
+
+FILTER_MODES = {
+    "ukf": FilterMode.FILTER_MODE_UKF,
+    "sr_ukf": FilterMode.FILTER_MODE_SR_UKF,
+    "linear_kf": FilterMode.FILTER_MODE_LINEAR_KF,
+    "ud": FilterMode.FILTER_MODE_UD,
+}
+
+# esp-dsp from the ESP component registry for `kernels: esp_dsp` (dsps_dotprod_f32).
+ESP_DSP_VERSION = "1.4.12"
 
 CONF_HP_UKF = "hp_ukf"
 CONF_UPDATE_INTERVAL = "update_interval"
@@ -25,6 +45,46 @@ CONF_INLET_HUMIDITY = "inlet_humidity"
 CONF_OUTLET_TEMPERATURE = "outlet_temperature"
 CONF_OUTLET_HUMIDITY = "outlet_humidity"
 CONF_TRACK_TEMPERATURE_DERIVATIVES = "track_temperature_derivatives"
+CONF_FILTER_MODE = "filter_mode"
+CONF_FUSED_PREDICT_UPDATE = "fused_predict_update"
+CONF_SEQUENTIAL_UPDATE = "sequential_update"
+CONF_EVENT_DRIVEN = "event_driven"
+CONF_MEASUREMENT_QUEUE = "measurement_queue"
+CONF_QUEUE_WINDOW = "queue_window"
+CONF_INLET_DELAY = "inlet_delay"
+CONF_OUTLET_DELAY = "outlet_delay"
+CONF_PUBLISH_SIGMA = "publish_sigma"
+CONF_PUBLISH_MAX_INTERVAL = "publish_max_interval"
+CONF_EM_PUBLISH_INTERVAL = "em_publish_interval"
+CONF_STATS = "stats"
+CONF_NUMERIC = "numeric"
+CONF_UNITS = "units"
+CONF_KERNELS = "kernels"
+CONF_RESTORE_STATE = "restore_state"
+CONF_STATE_SAVE_INTERVAL = "state_save_interval"
+CONF_WORKER_TASK = "worker_task"
+CONF_WORKER_CORE = "worker_core"
+CONF_WORKER_PRIORITY = "worker_priority"
+CONF_SUMMARY_INTERVAL = "summary_interval"
+CONF_STEP_TIME_MEAN = "step_time_mean"
+CONF_STEP_TIME_MAX = "step_time_max"
+CONF_STEP_CYCLES_MAX = "step_cycles_max"
+CONF_NAN_EVENTS = "nan_events"
+CONF_CLAMP_EVENTS = "clamp_events"
+CONF_HEAP_MIN_FREE = "heap_min_free"
+CONF_INNOVATION_GATE = "innovation_gate"
+CONF_SIGMA = "sigma"
+CONF_MAX_REJECTIONS = "max_rejections"
+CONF_DIVERGENCE_NIS = "divergence_nis"
+CONF_REJECTED_MEASUREMENTS = "rejected_measurements"
+CONF_FILTER_RESETS = "filter_resets"
+CONF_ADAPTIVE_INTERVAL = "adaptive_interval"
+CONF_MIN_INTERVAL = "min_interval"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_TEMPERATURE_RATE = "temperature_rate"
+CONF_HUMIDITY_RATE = "humidity_rate"
+CONF_INNOVATION_SIGMA = "innovation_sigma"
+CONF_STEP_INTERVAL = "step_interval"
 CONF_FILTERED_INLET_TEMPERATURE = "filtered_inlet_temperature"
 CONF_FILTERED_INLET_HUMIDITY = "filtered_inlet_humidity"
 CONF_FILTERED_OUTLET_TEMPERATURE = "filtered_outlet_temperature"
@@ -33,6 +93,21 @@ CONF_FILTERED_INLET_TEMPERATURE_DERIVATIVE = "filtered_inlet_temperature_derivat
 CONF_FILTERED_OUTLET_TEMPERATURE_DERIVATIVE = "filtered_outlet_temperature_derivative"
 CONF_FILTERED_INLET_HUMIDITY_DERIVATIVE = "filtered_inlet_humidity_derivative"
 CONF_FILTERED_OUTLET_HUMIDITY_DERIVATIVE = "filtered_outlet_humidity_derivative"
+CONF_INLET_DEW_POINT = "inlet_dew_point"
+CONF_OUTLET_DEW_POINT = "outlet_dew_point"
+CONF_INLET_ABSOLUTE_HUMIDITY = "inlet_absolute_humidity"
+CONF_OUTLET_ABSOLUTE_HUMIDITY = "outlet_absolute_humidity"
+CONF_INLET_ENTHALPY = "inlet_enthalpy"
+CONF_OUTLET_ENTHALPY = "outlet_enthalpy"
+CONF_ENTHALPY_DELTA = "enthalpy_delta"
+CONF_ENTHALPY_DELTA_STD_DEV = "enthalpy_delta_std_dev"
+CONF_ATMOSPHERIC_PRESSURE = "atmospheric_pressure"
+CONF_CONTROL = "control"
+CONF_TIME_CONSTANT = "time_constant"
+CONF_INPUTS = "inputs"
+CONF_OUTLET_TEMPERATURE_GAIN = "outlet_temperature_gain"
+CONF_OUTLET_HUMIDITY_GAIN = "outlet_humidity_gain"
+CONF_TABLE = "table"
 CONF_EM_AUTOTUNE = "em_autotune"
 CONF_EM_LAMBDA_Q = "em_lambda_q"
 CONF_EM_LAMBDA_R_INLET = "em_lambda_r_inlet"
@@ -62,7 +137,292 @@ def _em_lambda(value):
     return v
 
 
-CONFIG_SCHEMA = cv.Schema(
+def _divergence_nis(value):
+    # A consistent filter averages NIS = 1, so thresholds close to it would reset constantly.
+    v = cv.float_(value)
+    if v != 0 and v < 1.5:
+        raise cv.Invalid("divergence_nis must be 0 (off) or at least 1.5")
+    return v
+
+
+FILTERED_TEMPERATURE_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_CELSIUS,
+    accuracy_decimals=2,
+    device_class=DEVICE_CLASS_TEMPERATURE,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+FILTERED_HUMIDITY_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_PERCENT,
+    accuracy_decimals=1,
+    device_class=DEVICE_CLASS_HUMIDITY,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+FILTERED_TEMPERATURE_DERIVATIVE_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="°C/s",
+    accuracy_decimals=3,
+    device_class=DEVICE_CLASS_TEMPERATURE,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+FILTERED_HUMIDITY_DERIVATIVE_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="%/s",
+    accuracy_decimals=4,
+    device_class=DEVICE_CLASS_HUMIDITY,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+
+DEW_POINT_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_CELSIUS,
+    accuracy_decimals=1,
+    device_class=DEVICE_CLASS_TEMPERATURE,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+ABSOLUTE_HUMIDITY_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="g/m³",
+    accuracy_decimals=2,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+ENTHALPY_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="kJ/kg",
+    accuracy_decimals=2,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+
+# Derived moist-air outputs, in PsychroOutput order (hp_ukf_psychro.h).
+PSYCHRO_OUTPUT_SCHEMAS = [
+    (CONF_INLET_DEW_POINT, DEW_POINT_SCHEMA),
+    (CONF_OUTLET_DEW_POINT, DEW_POINT_SCHEMA),
+    (CONF_INLET_ABSOLUTE_HUMIDITY, ABSOLUTE_HUMIDITY_SCHEMA),
+    (CONF_OUTLET_ABSOLUTE_HUMIDITY, ABSOLUTE_HUMIDITY_SCHEMA),
+    (CONF_INLET_ENTHALPY, ENTHALPY_SCHEMA),
+    (CONF_OUTLET_ENTHALPY, ENTHALPY_SCHEMA),
+    (CONF_ENTHALPY_DELTA, ENTHALPY_SCHEMA),
+]
+
+# Per-unit inputs and outputs of a filter bank (`units:`), in measurement and state order.
+UNIT_INPUT_KEYS = [CONF_INLET_TEMPERATURE, CONF_INLET_HUMIDITY, CONF_OUTLET_TEMPERATURE, CONF_OUTLET_HUMIDITY]
+UNIT_OUTPUT_SCHEMAS = [
+    (CONF_FILTERED_INLET_TEMPERATURE, FILTERED_TEMPERATURE_SCHEMA),
+    (CONF_FILTERED_INLET_HUMIDITY, FILTERED_HUMIDITY_SCHEMA),
+    (CONF_FILTERED_OUTLET_TEMPERATURE, FILTERED_TEMPERATURE_SCHEMA),
+    (CONF_FILTERED_OUTLET_HUMIDITY, FILTERED_HUMIDITY_SCHEMA),
+    (CONF_FILTERED_INLET_TEMPERATURE_DERIVATIVE, FILTERED_TEMPERATURE_DERIVATIVE_SCHEMA),
+    (CONF_FILTERED_OUTLET_TEMPERATURE_DERIVATIVE, FILTERED_TEMPERATURE_DERIVATIVE_SCHEMA),
+    (CONF_FILTERED_INLET_HUMIDITY_DERIVATIVE, FILTERED_HUMIDITY_DERIVATIVE_SCHEMA),
+    (CONF_FILTERED_OUTLET_HUMIDITY_DERIVATIVE, FILTERED_HUMIDITY_DERIVATIVE_SCHEMA),
+]
+UNIT_SCHEMA = cv.Schema(
+    {
+        **{cv.Optional(key): cv.use_id(sensor.Sensor) for key in UNIT_INPUT_KEYS},
+        **{cv.Optional(key): schema for key, schema in UNIT_OUTPUT_SCHEMAS},
+    }
+)
+
+def _control_table_point(value):
+    value = cv.ensure_list(cv.float_)(value)
+    if len(value) != 3:
+        raise cv.Invalid("table point must be [u, outlet_temperature_offset, outlet_humidity_offset]")
+    return value
+
+
+def _sorted_table(points):
+    points = sorted(points, key=lambda p: p[0])
+    for a, b in zip(points, points[1:]):
+        if a[0] == b[0]:
+            raise cv.Invalid(f"duplicate table input value {a[0]}")
+    return points
+
+
+def _validate_control_input(config):
+    if CONF_TABLE in config and CONF_OUTLET_HUMIDITY_GAIN in config:
+        raise cv.Invalid("outlet_humidity_gain cannot be combined with table")
+    return config
+
+
+# Control inputs for predict: each maps to an equilibrium offset of the outlet levels, either
+# linear (gains) or a piecewise-linear table of [u, T_out offset, RH_out offset] points.
+CONTROL_INPUT_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Required(CONF_SENSOR): cv.use_id(sensor.Sensor),
+            cv.Exclusive(CONF_OUTLET_TEMPERATURE_GAIN, "response"): cv.float_,
+            cv.Optional(CONF_OUTLET_HUMIDITY_GAIN): cv.float_,
+            cv.Exclusive(CONF_TABLE, "response"): cv.All(
+                cv.ensure_list(_control_table_point), cv.Length(min=2, max=8), _sorted_table
+            ),
+        }
+    ),
+    _validate_control_input,
+)
+CONTROL_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_TIME_CONSTANT, default="60s"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(min=cv.TimePeriod(seconds=1))
+        ),
+        cv.Required(CONF_INPUTS): cv.All(cv.ensure_list(CONTROL_INPUT_SCHEMA), cv.Length(min=1, max=4)),
+    }
+)
+
+
+# Instrumentation; the whole block compiles out (USE_HP_UKF_STATS) when not configured.
+STATS_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_SUMMARY_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_STEP_TIME_MEAN): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=3,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_STEP_TIME_MAX): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=3,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_STEP_CYCLES_MAX): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_NAN_EVENTS): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_CLAMP_EVENTS): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_HEAP_MIN_FREE): sensor.sensor_schema(
+            unit_of_measurement=UNIT_BYTES,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+
+# NIS gate and divergence detector (HpUkfInnovationGate); divergence_nis 0 disables the detector.
+INNOVATION_GATE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_SIGMA, default=5.0): cv.float_range(min=1.0),
+        cv.Optional(CONF_MAX_REJECTIONS, default=5): cv.int_range(min=1, max=1000),
+        cv.Optional(CONF_DIVERGENCE_NIS, default=4.0): _divergence_nis,
+        cv.Optional(CONF_REJECTED_MEASUREMENTS): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_FILTER_RESETS): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+
+# Adaptive step interval (HpUkfAdaptiveScheduler); min_interval defaults to update_interval.
+ADAPTIVE_INTERVAL_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_MIN_INTERVAL): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_INTERVAL, default="30s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_TEMPERATURE_RATE, default=0.01): cv.float_range(min=0.0),
+        cv.Optional(CONF_HUMIDITY_RATE, default=0.02): cv.float_range(min=0.0),
+        cv.Optional(CONF_INNOVATION_SIGMA, default=4.0): cv.float_range(min=1.0),
+        cv.Optional(CONF_STEP_INTERVAL): sensor.sensor_schema(
+            unit_of_measurement=UNIT_SECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+
+def _validate_adaptive_interval(config):
+    # Steps are taken on polls, so the intervals are bounded below by update_interval.
+    if CONF_ADAPTIVE_INTERVAL not in config:
+        return config
+    adaptive = config[CONF_ADAPTIVE_INTERVAL]
+    for key in (CONF_EVENT_DRIVEN, CONF_MEASUREMENT_QUEUE):
+        if config[key]:
+            raise cv.Invalid(f"adaptive_interval and {key} are mutually exclusive")
+    poll = config[CONF_UPDATE_INTERVAL]
+    if CONF_MIN_INTERVAL not in adaptive:
+        adaptive[CONF_MIN_INTERVAL] = poll
+    if adaptive[CONF_MIN_INTERVAL] < poll:
+        raise cv.Invalid("adaptive_interval: min_interval must be at least update_interval")
+    if adaptive[CONF_MAX_INTERVAL] < adaptive[CONF_MIN_INTERVAL]:
+        raise cv.Invalid("adaptive_interval: max_interval must be at least min_interval")
+    return config
+
+
+def _validate_queue(config):
+    if config[CONF_MEASUREMENT_QUEUE] and config[CONF_EVENT_DRIVEN]:
+        raise cv.Invalid("measurement_queue and event_driven are mutually exclusive")
+    # Q is the process noise of one update_interval; each predict adds its dt share of it.
+    if config[CONF_UPDATE_INTERVAL] == cv.update_interval("never"):
+        for key in (CONF_EVENT_DRIVEN, CONF_MEASUREMENT_QUEUE):
+            if config[key]:
+                raise cv.Invalid(f"{key} requires a finite update_interval (Q is scaled per update_interval)")
+    return config
+
+
+def _validate_kernels(config):
+    if config[CONF_KERNELS] == "esp_dsp" and not (CORE.is_esp32 and CORE.using_esp_idf):
+        raise cv.Invalid("kernels: esp_dsp requires an ESP32 target with framework type esp-idf (esp-dsp component)")
+    return config
+
+
+def _validate_worker_task(config):
+    # The worker only takes polled samples; queue/event-driven fusion and stats stay on the main loop.
+    if not config[CONF_WORKER_TASK]:
+        return config
+    if not CORE.is_esp32:
+        raise cv.Invalid("worker_task requires an ESP32 target (FreeRTOS task)")
+    for key in (CONF_EVENT_DRIVEN, CONF_MEASUREMENT_QUEUE):
+        if config[key]:
+            raise cv.Invalid(f"worker_task and {key} are mutually exclusive")
+    if CONF_STATS in config:
+        raise cv.Invalid("worker_task and stats are mutually exclusive")
+    return config
+
+
+def _float_only_options(config):
+    # Options the fixed-point backend (linear_kf only, hp_ukf_fixed.h) cannot honour.
+    options = []
+    if config[CONF_EM_AUTOTUNE]:
+        options.append(CONF_EM_AUTOTUNE)
+    if CONF_INNOVATION_GATE in config:
+        options.append(CONF_INNOVATION_GATE)
+    if config.get(CONF_FILTER_MODE, "linear_kf") != "linear_kf":
+        options.append(f"{CONF_FILTER_MODE}: {config[CONF_FILTER_MODE]}")
+    for key in (CONF_SEQUENTIAL_UPDATE, CONF_FUSED_PREDICT_UPDATE):
+        if config[key]:
+            options.append(key)
+    return options
+
+
+def _resolve_numeric(config):
+    # auto: fixed-point on ESP8266 (no FPU) unless an option needs the float filter.
+    # filter_mode defaults to ukf, or to linear_kf (the algorithm it runs) with fixed.
+    if config[CONF_NUMERIC] == "auto":
+        fixed = CORE.is_esp8266 and not _float_only_options(config)
+        config[CONF_NUMERIC] = "fixed" if fixed else "float"
+    if config[CONF_NUMERIC] == "fixed":
+        options = _float_only_options(config)
+        if options:
+            raise cv.Invalid(f"{options[0]} requires numeric: float (numeric: fixed runs linear_kf only)")
+    if CONF_FILTER_MODE not in config:
+        mode = "linear_kf" if config[CONF_NUMERIC] == "fixed" else "ukf"
+        config[CONF_FILTER_MODE] = cv.enum(FILTER_MODES, lower=True)(mode)
+    return config
+
+
+FILTER_SCHEMA = cv.All(cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(HpUkfComponent),
         cv.Optional(CONF_UPDATE_INTERVAL, default="1s"): cv.update_interval,
@@ -71,78 +431,65 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Optional(CONF_OUTLET_TEMPERATURE): cv.use_id(sensor.Sensor),
         cv.Optional(CONF_OUTLET_HUMIDITY): cv.use_id(sensor.Sensor),
         cv.Optional(CONF_TRACK_TEMPERATURE_DERIVATIVES, default=True): cv.boolean,
+        cv.Optional(CONF_FILTER_MODE): cv.enum(FILTER_MODES, lower=True),
+        cv.Optional(CONF_NUMERIC, default="float"): cv.one_of("auto", "float", "fixed", lower=True),
+        cv.Optional(CONF_KERNELS, default="auto"): cv.one_of("auto", "scalar", "vector", "esp_dsp", lower=True),
+        cv.Optional(CONF_FUSED_PREDICT_UPDATE, default=False): cv.boolean,
+        cv.Optional(CONF_SEQUENTIAL_UPDATE, default=False): cv.boolean,
+        cv.Optional(CONF_EVENT_DRIVEN, default=False): cv.boolean,
+        cv.Optional(CONF_MEASUREMENT_QUEUE, default=False): cv.boolean,
+        cv.Optional(CONF_QUEUE_WINDOW, default="2s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_INLET_DELAY, default="0ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_OUTLET_DELAY, default="0ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_PUBLISH_SIGMA, default=0.0): cv.float_range(min=0.0),
+        cv.Optional(CONF_PUBLISH_MAX_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_EM_PUBLISH_INTERVAL, default="0ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_RESTORE_STATE, default=False): cv.boolean,
+        cv.Optional(CONF_STATE_SAVE_INTERVAL, default="15min"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(min=cv.TimePeriod(minutes=1))
+        ),
+        **{cv.Optional(key): schema for key, schema in PSYCHRO_OUTPUT_SCHEMAS},
+        cv.Optional(CONF_ENTHALPY_DELTA_STD_DEV): ENTHALPY_SCHEMA,
+        cv.Optional(CONF_CONTROL): CONTROL_SCHEMA,
+        cv.Optional(CONF_ATMOSPHERIC_PRESSURE, default=1013.25): cv.float_range(min=500.0, max=1100.0),
+        cv.Optional(CONF_WORKER_TASK, default=False): cv.boolean,
+        cv.Optional(CONF_WORKER_CORE, default=1): cv.int_range(min=0, max=1),
+        cv.Optional(CONF_WORKER_PRIORITY, default=1): cv.int_range(min=1, max=24),
+        cv.Optional(CONF_STATS): STATS_SCHEMA,
+        cv.Optional(CONF_INNOVATION_GATE): INNOVATION_GATE_SCHEMA,
+        cv.Optional(CONF_ADAPTIVE_INTERVAL): ADAPTIVE_INTERVAL_SCHEMA,
         cv.Optional(
             CONF_FILTERED_INLET_TEMPERATURE,
             default={CONF_NAME: "Filtered Inlet Temperature"},
-        ): sensor.sensor_schema(
-            unit_of_measurement=UNIT_CELSIUS,
-            accuracy_decimals=2,
-            device_class=DEVICE_CLASS_TEMPERATURE,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_TEMPERATURE_SCHEMA,
         cv.Optional(
             CONF_FILTERED_INLET_HUMIDITY,
             default={CONF_NAME: "Filtered Inlet Humidity"},
-        ): sensor.sensor_schema(
-            unit_of_measurement=UNIT_PERCENT,
-            accuracy_decimals=1,
-            device_class=DEVICE_CLASS_HUMIDITY,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_HUMIDITY_SCHEMA,
         cv.Optional(
             CONF_FILTERED_OUTLET_TEMPERATURE,
             default={CONF_NAME: "Filtered Outlet Temperature"},
-        ): sensor.sensor_schema(
-            unit_of_measurement=UNIT_CELSIUS,
-            accuracy_decimals=2,
-            device_class=DEVICE_CLASS_TEMPERATURE,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_TEMPERATURE_SCHEMA,
         cv.Optional(
             CONF_FILTERED_OUTLET_HUMIDITY,
             default={CONF_NAME: "Filtered Outlet Humidity"},
-        ): sensor.sensor_schema(
-            unit_of_measurement=UNIT_PERCENT,
-            accuracy_decimals=1,
-            device_class=DEVICE_CLASS_HUMIDITY,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_HUMIDITY_SCHEMA,
         cv.Optional(
             CONF_FILTERED_INLET_TEMPERATURE_DERIVATIVE,
             default={CONF_NAME: "Filtered Inlet Temperature Derivative"},
-        ): sensor.sensor_schema(
-            unit_of_measurement="°C/s",
-            accuracy_decimals=3,
-            device_class=DEVICE_CLASS_TEMPERATURE,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_TEMPERATURE_DERIVATIVE_SCHEMA,
         cv.Optional(
             CONF_FILTERED_OUTLET_TEMPERATURE_DERIVATIVE,
             default={CONF_NAME: "Filtered Outlet Temperature Derivative"},
-        ): sensor.sensor_schema(
-            unit_of_measurement="°C/s",
-            accuracy_decimals=3,
-            device_class=DEVICE_CLASS_TEMPERATURE,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_TEMPERATURE_DERIVATIVE_SCHEMA,
         cv.Optional(
             CONF_FILTERED_INLET_HUMIDITY_DERIVATIVE,
             default={CONF_NAME: "Filtered Inlet Humidity Derivative"},
-        ): sensor.sensor_schema(
-            unit_of_measurement="%/s",
-            accuracy_decimals=4,
-            device_class=DEVICE_CLASS_HUMIDITY,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_HUMIDITY_DERIVATIVE_SCHEMA,
         cv.Optional(
             CONF_FILTERED_OUTLET_HUMIDITY_DERIVATIVE,
             default={CONF_NAME: "Filtered Outlet Humidity Derivative"},
-        ): sensor.sensor_schema(
-            unit_of_measurement="%/s",
-            accuracy_decimals=4,
-            device_class=DEVICE_CLASS_HUMIDITY,
-            state_class=STATE_CLASS_MEASUREMENT,
-        ),
+        ): FILTERED_HUMIDITY_DERIVATIVE_SCHEMA,
         cv.Optional(CONF_EM_AUTOTUNE, default=False): cv.boolean,
         cv.Optional(CONF_EM_LAMBDA_Q, default=0.995): _em_lambda,
         cv.Optional(CONF_EM_LAMBDA_R_INLET, default=0.998): _em_lambda,
@@ -221,14 +568,126 @@ CONFIG_SCHEMA = cv.Schema(
             state_class=STATE_CLASS_MEASUREMENT,
         ),
     }
+).extend(cv.COMPONENT_SCHEMA), _validate_queue, _validate_kernels, _validate_worker_task,
+    _validate_adaptive_interval, _resolve_numeric)
+
+# `units:` builds a HpUkfBankComponent (float linear KF over all units) from its own schema.
+BANK_BASE_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(HpUkfBankComponent),
+        cv.Optional(CONF_UPDATE_INTERVAL, default="1s"): cv.update_interval,
+        cv.Optional(CONF_TRACK_TEMPERATURE_DERIVATIVES, default=True): cv.boolean,
+        cv.Optional(CONF_NUMERIC, default="float"): cv.one_of("auto", "float", lower=True),
+        cv.Required(CONF_UNITS): cv.All(cv.ensure_list(UNIT_SCHEMA), cv.Length(min=1)),
+    }
 ).extend(cv.COMPONENT_SCHEMA)
+BANK_KEYS = {str(key) for key in BANK_BASE_SCHEMA.schema}
+
+
+def _bank_options(config):
+    # Options of the single filter are errors here rather than silently ignored.
+    for key, value in config.items():
+        if key in UNIT_INPUT_KEYS:
+            raise cv.Invalid(f"{key} goes inside each entry of units", path=[key])
+        if key == CONF_NUMERIC and str(value).lower() == "fixed":
+            raise cv.Invalid("units requires numeric: float", path=[key])
+        if key not in BANK_KEYS:
+            raise cv.Invalid(f"{key} is not supported with units", path=[key])
+    return config
+
+
+def _validate_bank(config):
+    if not config[CONF_TRACK_TEMPERATURE_DERIVATIVES]:
+        for unit in config[CONF_UNITS]:
+            for key, _ in UNIT_OUTPUT_SCHEMAS[4:]:
+                if key in unit:
+                    raise cv.Invalid(f"{key} requires track_temperature_derivatives")
+    return config
+
+
+BANK_SCHEMA = cv.All(_bank_options, BANK_BASE_SCHEMA, _validate_bank)
+
+
+def _config_schema(config):
+    if isinstance(config, dict) and CONF_UNITS in config:
+        return BANK_SCHEMA(config)
+    return FILTER_SCHEMA(config)
+
+
+CONFIG_SCHEMA = _config_schema
+
+
+async def units_to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    cg.add(var.set_update_interval(config[CONF_UPDATE_INTERVAL]))
+    cg.add_define("HP_UKF_STATE_DIM", 8 if config[CONF_TRACK_TEMPERATURE_DERIVATIVES] else 4)
+    cg.add_define("HP_UKF_BANK_UNITS", len(config[CONF_UNITS]))
+    for unit, unit_config in enumerate(config[CONF_UNITS]):
+        for channel, key in enumerate(UNIT_INPUT_KEYS):
+            if key in unit_config:
+                sens = await cg.get_variable(unit_config[key])
+                cg.add(var.set_input_sensor(unit, channel, sens))
+        for index, (key, _) in enumerate(UNIT_OUTPUT_SCHEMAS):
+            if key in unit_config:
+                sens = await sensor.new_sensor(unit_config[key])
+                cg.add(var.set_filtered_sensor(unit, index, sens))
 
 
 async def to_code(config):
+    if CONF_UNITS in config:
+        await units_to_code(config)
+        return
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     cg.add(var.set_update_interval(config[CONF_UPDATE_INTERVAL]))
-    cg.add(var.set_track_temperature_derivatives(config[CONF_TRACK_TEMPERATURE_DERIVATIVES]))
+    # State dimension is a template parameter: 8 with rate states, 4 without.
+    cg.add_define("HP_UKF_STATE_DIM", 8 if config[CONF_TRACK_TEMPERATURE_DERIVATIVES] else 4)
+    if config[CONF_NUMERIC] == "fixed":
+        cg.add_define("HP_UKF_FIXED_POINT")
+    # Dense UKF kernels (hp_ukf_kernels.h); auto picks vector on SIMD hosts, else scalar.
+    if config[CONF_KERNELS] != "auto":
+        cg.add_define(f"HP_UKF_KERNELS_{config[CONF_KERNELS].upper()}")
+    if config[CONF_KERNELS] == "esp_dsp":
+        add_idf_component(name="espressif/esp-dsp", ref=ESP_DSP_VERSION)
+    cg.add(var.set_filter_mode(config[CONF_FILTER_MODE]))
+    cg.add(var.set_fused_predict_update(config[CONF_FUSED_PREDICT_UPDATE]))
+    cg.add(var.set_sequential_update(config[CONF_SEQUENTIAL_UPDATE]))
+    cg.add(var.set_event_driven(config[CONF_EVENT_DRIVEN]))
+    cg.add(var.set_measurement_queue(config[CONF_MEASUREMENT_QUEUE]))
+    cg.add(var.set_queue_window(config[CONF_QUEUE_WINDOW]))
+    cg.add(var.set_inlet_delay(config[CONF_INLET_DELAY]))
+    cg.add(var.set_outlet_delay(config[CONF_OUTLET_DELAY]))
+    cg.add(var.set_publish_sigma(config[CONF_PUBLISH_SIGMA]))
+    cg.add(var.set_publish_max_interval(config[CONF_PUBLISH_MAX_INTERVAL]))
+    cg.add(var.set_em_publish_interval(config[CONF_EM_PUBLISH_INTERVAL]))
+    cg.add(var.set_restore_state(config[CONF_RESTORE_STATE]))
+    cg.add(var.set_state_save_interval(config[CONF_STATE_SAVE_INTERVAL]))
+    cg.add(var.set_pressure(config[CONF_ATMOSPHERIC_PRESSURE]))
+    for index, (key, _) in enumerate(PSYCHRO_OUTPUT_SCHEMAS):
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(var.set_psychro_sensor(index, sens))
+    if CONF_ENTHALPY_DELTA_STD_DEV in config:
+        sens = await sensor.new_sensor(config[CONF_ENTHALPY_DELTA_STD_DEV])
+        cg.add(var.set_enthalpy_delta_std_dev_sensor(sens))
+    if CONF_CONTROL in config:
+        control = config[CONF_CONTROL]
+        cg.add(var.set_control_time_constant(control[CONF_TIME_CONSTANT]))
+        for inp in control[CONF_INPUTS]:
+            sens = await cg.get_variable(inp[CONF_SENSOR])
+            cg.add(
+                var.add_control_input(
+                    sens, inp.get(CONF_OUTLET_TEMPERATURE_GAIN, 0.0), inp.get(CONF_OUTLET_HUMIDITY_GAIN, 0.0)
+                )
+            )
+            for u, t_out, rh_out in inp.get(CONF_TABLE, []):
+                cg.add(var.add_control_table_point(u, t_out, rh_out))
+    if config[CONF_WORKER_TASK]:
+        cg.add_define("USE_HP_UKF_WORKER")
+        cg.add(var.set_worker_task(True))
+        cg.add(var.set_worker_core(config[CONF_WORKER_CORE]))
+        cg.add(var.set_worker_priority(config[CONF_WORKER_PRIORITY]))
     if CONF_INLET_TEMPERATURE in config:
         sens = await cg.get_variable(config[CONF_INLET_TEMPERATURE])
         cg.add(var.set_inlet_temperature_sensor(sens))
@@ -247,6 +706,29 @@ async def to_code(config):
     cg.add(var.set_em_lambda_r_inlet(config[CONF_EM_LAMBDA_R_INLET]))
     cg.add(var.set_em_lambda_r_outlet(config[CONF_EM_LAMBDA_R_OUTLET]))
     cg.add(var.set_em_inflation(config[CONF_EM_INFLATION]))
+    if CONF_INNOVATION_GATE in config:
+        gate = config[CONF_INNOVATION_GATE]
+        cg.add(var.set_innovation_gate(gate[CONF_SIGMA], gate[CONF_MAX_REJECTIONS], gate[CONF_DIVERGENCE_NIS]))
+        if CONF_REJECTED_MEASUREMENTS in gate:
+            sens = await sensor.new_sensor(gate[CONF_REJECTED_MEASUREMENTS])
+            cg.add(var.set_rejected_measurements_sensor(sens))
+        if CONF_FILTER_RESETS in gate:
+            sens = await sensor.new_sensor(gate[CONF_FILTER_RESETS])
+            cg.add(var.set_filter_resets_sensor(sens))
+    if CONF_ADAPTIVE_INTERVAL in config:
+        adaptive = config[CONF_ADAPTIVE_INTERVAL]
+        cg.add(
+            var.set_adaptive_interval(
+                adaptive[CONF_MIN_INTERVAL],
+                adaptive[CONF_MAX_INTERVAL],
+                adaptive[CONF_TEMPERATURE_RATE],
+                adaptive[CONF_HUMIDITY_RATE],
+                adaptive[CONF_INNOVATION_SIGMA],
+            )
+        )
+        if CONF_STEP_INTERVAL in adaptive:
+            sens = await sensor.new_sensor(adaptive[CONF_STEP_INTERVAL])
+            cg.add(var.set_step_interval_sensor(sens))
 
     sens = await sensor.new_sensor(config[CONF_FILTERED_INLET_TEMPERATURE])
     cg.add(var.set_filtered_inlet_temperature_sensor(sens))
@@ -310,3 +792,19 @@ async def to_code(config):
     if CONF_EM_LAMBDA_R_OUTLET_SENSOR in config:
         sens = await sensor.new_sensor(config[CONF_EM_LAMBDA_R_OUTLET_SENSOR])
         cg.add(var.set_em_lambda_r_outlet_sensor(sens))
+
+    if CONF_STATS in config:
+        stats = config[CONF_STATS]
+        cg.add_define("USE_HP_UKF_STATS")
+        cg.add(var.set_stats_interval(stats[CONF_SUMMARY_INTERVAL]))
+        for key, setter in (
+            (CONF_STEP_TIME_MEAN, var.set_stats_step_time_mean_sensor),
+            (CONF_STEP_TIME_MAX, var.set_stats_step_time_max_sensor),
+            (CONF_STEP_CYCLES_MAX, var.set_stats_step_cycles_max_sensor),
+            (CONF_NAN_EVENTS, var.set_stats_nan_events_sensor),
+            (CONF_CLAMP_EVENTS, var.set_stats_clamp_events_sensor),
+            (CONF_HEAP_MIN_FREE, var.set_stats_heap_min_free_sensor),
+        ):
+            if key in stats:
+                sens = await sensor.new_sensor(stats[key])
+                cg.add(setter(sens))
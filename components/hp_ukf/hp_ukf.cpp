@@ -1,6 +1,7 @@
 #include "hp_ukf.h"
 #include "esphome/core/application.h"
 #include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 #include <cmath>
 #include <algorithm>
@@ -26,18 +27,44 @@ static uint32_t get_free_heap_bytes() {
 #endif
 }
 
+static const char *filter_mode_to_string(FilterMode mode) {
+  switch (mode) {
+    case FILTER_MODE_SR_UKF:
+      return "sr_ukf";
+    case FILTER_MODE_LINEAR_KF:
+      return "linear_kf";
+    case FILTER_MODE_UD:
+      return "ud";
+    default:
+      return "ukf";
+  }
+}
+
 static float read_sensor(sensor::Sensor *s) {
   if (s != nullptr && s->has_state())
     return s->get_state();
   return NAN;
 }
 
+static void capture_estimate(const HpUkfFilter &filter, HpUkfEstimate &est) {
+  const float *x = filter.get_state();
+  const float *P = filter.get_covariance_packed();
+  for (int i = 0; i < HpUkfFilter::N; i++)
+    est.x[i] = x[i];
+  for (int i = 0; i < HpUkfFilter::N_PACKED; i++)
+    est.P[i] = P[i];
+  filter.get_process_noise_diag(est.q_diag);
+  filter.get_measurement_noise_diag(est.r_diag);
+}
+
 void HpUkfComponent::setup() {
   uint32_t t_setup_start_us = micros();
   ESP_LOGCONFIG(TAG, "Setting up HP-UKF component");
-  filter_.set_state_dimension(track_derivatives_ ? 8 : 4);
+  filter_.set_filter_mode(filter_mode_);
+  filter_.set_sequential_update(sequential_update_);
 
-  float x0[HpUkfFilter::N_MAX] = {20.0f, 50.0f, 20.0f, 50.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  constexpr int n = HpUkfFilter::N;
+  float x0[n] = {20.0f, 50.0f, 20.0f, 50.0f};  // rates (if any) start at zero
   float t_in = read_sensor(inlet_temperature_);
   float rh_in = read_sensor(inlet_humidity_);
   float t_out = read_sensor(outlet_temperature_);
@@ -51,13 +78,17 @@ void HpUkfComponent::setup() {
   if (!std::isnan(rh_out))
     x0[3] = rh_out;
 
-  float P0[HpUkfFilter::N_MAX * HpUkfFilter::N_MAX];
-  int n = filter_.get_state_dimension();
+  float P0[n * n];
   for (int i = 0; i < n * n; i++)
     P0[i] = 0.0f;
   for (int i = 0; i < n; i++)
     P0[i * n + i] = 1.0f;
   filter_.set_initial_state(x0, P0);
+  if (restore_state_) {
+    state_pref_ = global_preferences->make_preference<HpUkfSavedState>(fnv1_hash("hp_ukf_state"), true);
+    this->load_saved_state_();
+    this->set_interval("state_save", state_save_interval_ms_, [this]() { this->save_state_(); });
+  }
 
   if (em_autotune_) {
     filter_.enable_em_autotune(true);
@@ -66,6 +97,11 @@ void HpUkfComponent::setup() {
     filter_.set_em_lambda_r_outlet(em_lambda_r_outlet_);
     filter_.set_em_inflation(em_inflation_);
   }
+  if (gate_sigma_ > 0.0f) {
+    filter_.set_innovation_gate(gate_sigma_);
+    filter_.set_gate_max_rejections(gate_max_rejections_);
+    filter_.set_divergence_nis(gate_divergence_nis_);
+  }
 
   // Publish initial state so sensors show values immediately (avoids NaN/unknown
   // before first update and when source sensors haven't reported yet).
@@ -78,7 +114,7 @@ void HpUkfComponent::setup() {
     filtered_outlet_temperature_->publish_state(x[2]);
   if (filtered_outlet_humidity_)
     filtered_outlet_humidity_->publish_state(x[3]);
-  if (track_derivatives_) {
+  if constexpr (TRACK_DERIVATIVES) {
     if (filtered_inlet_temperature_derivative_)
       filtered_inlet_temperature_derivative_->publish_state(x[4]);
     if (filtered_outlet_temperature_derivative_)
@@ -88,6 +124,8 @@ void HpUkfComponent::setup() {
     if (filtered_outlet_humidity_derivative_)
       filtered_outlet_humidity_derivative_->publish_state(x[7]);
   }
+  if (has_psychro_)
+    this->publish_psychro_(x, filter_.get_covariance_packed(), millis());
 
   {
     int em_sensor_count = (em_q_t_in_ ? 1 : 0) + (em_q_rh_in_ ? 1 : 0) + (em_q_t_out_ ? 1 : 0) + (em_q_rh_out_ ? 1 : 0)
@@ -97,16 +135,15 @@ void HpUkfComponent::setup() {
     ESP_LOGD(TAG, "setup: em_autotune=%d em_sensor_count=%d", em_autotune_ ? 1 : 0, em_sensor_count);
   }
   if (em_autotune_) {
-    float q_diag[HpUkfFilter::N_MAX], r_diag[HpUkfFilter::M];
+    float q_diag[HpUkfFilter::N], r_diag[HpUkfFilter::M];
     filter_.get_process_noise_diag(q_diag);
     filter_.get_measurement_noise_diag(r_diag);
     ESP_LOGD(TAG, "setup Q/R diag: q[0]=%.6f q[2]=%.6f r[0]=%.6f r[2]=%.6f",
              q_diag[0], q_diag[2], r_diag[0], r_diag[2]);
-    int n = filter_.get_state_dimension();
     ESP_LOGD(TAG, "Q/R diagonal (copy to hp_ukf initial config):");
     ESP_LOGD(TAG, "  q_t_in: %.6e  q_rh_in: %.6e  q_t_out: %.6e  q_rh_out: %.6e",
              q_diag[0], q_diag[1], q_diag[2], q_diag[3]);
-    if (n >= 8) {
+    if constexpr (TRACK_DERIVATIVES) {
       ESP_LOGD(TAG, "  q_dt_in: %.6e  q_dt_out: %.6e  q_drh_in: %.6e  q_drh_out: %.6e",
                q_diag[4], q_diag[5], q_diag[6], q_diag[7]);
     }
@@ -116,7 +153,7 @@ void HpUkfComponent::setup() {
     if (em_q_rh_in_) em_q_rh_in_->publish_state(q_diag[1]);
     if (em_q_t_out_) em_q_t_out_->publish_state(q_diag[2]);
     if (em_q_rh_out_) em_q_rh_out_->publish_state(q_diag[3]);
-    if (n >= 8) {
+    if constexpr (TRACK_DERIVATIVES) {
       if (em_q_dt_in_) em_q_dt_in_->publish_state(q_diag[4]);
       if (em_q_dt_out_) em_q_dt_out_->publish_state(q_diag[5]);
       if (em_q_drh_in_) em_q_drh_in_->publish_state(q_diag[6]);
@@ -135,109 +172,604 @@ void HpUkfComponent::setup() {
   uint32_t free_heap = get_free_heap_bytes();
   ESP_LOGD(TAG, "setup: %.2f ms, free_heap %u bytes",
            (t_setup_end_us - t_setup_start_us) / 1000.0f, (unsigned) free_heap);
+  if (event_driven_ || measurement_queue_) {
+    sensor::Sensor *inputs[HpUkfFilter::M] = {inlet_temperature_, inlet_humidity_, outlet_temperature_,
+                                              outlet_humidity_};
+    for (int i = 0; i < HpUkfFilter::M; i++) {
+      if (inputs[i] != nullptr)
+        inputs[i]->add_on_state_callback([this, i](float value) { this->on_measurement_(i, value); });
+    }
+  }
+
   last_update_ms_ = millis();
+  queue_.checkpoint(filter_, control_state_, last_update_ms_);
+#ifdef USE_HP_UKF_WORKER
+  if (worker_task_) {
+    // Seed the snapshot so the main loop has a valid estimate before the first worker step.
+    capture_estimate(filter_, worker_estimates_.write_buffer());
+    worker_estimates_.publish();
+    worker_estimates_.consume();
+    if (!worker_.start("hp_ukf", WORKER_STACK_SIZE, worker_priority_, worker_core_, &HpUkfComponent::worker_entry_,
+                       this)) {
+      ESP_LOGE(TAG, "worker task could not be created");
+      this->mark_failed();
+      return;
+    }
+  }
+#endif
   initialized_ = true;
 }
 
-void HpUkfComponent::update() {
-  if (this->is_failed() || !initialized_)
+// Warm start from the flash snapshot: x, P and the (EM-adapted) Q/R diagonals. The saved P is
+// from before the outage, so each level variance is raised to at least its R to let the first
+// samples pull a stale level back quickly.
+bool HpUkfComponent::load_saved_state_() {
+  constexpr int n = HpUkfFilter::N;
+  constexpr int m = HpUkfFilter::M;
+  HpUkfSavedState saved;
+  if (!state_pref_.load(&saved)) {
+    ESP_LOGD(TAG, "restore: no saved state, cold start");
+    return false;
+  }
+  if (saved.tag != SAVED_STATE_TAG) {
+    ESP_LOGW(TAG, "restore: saved state tag 0x%08x does not match 0x%08x (version or shape changed), ignored",
+             (unsigned) saved.tag, (unsigned) SAVED_STATE_TAG);
+    return false;
+  }
+  bool valid = true;
+  for (int i = 0; i < n; i++) {
+    float p_ii = saved.est.P[HpUkfFilter::packed_index(i, i)];
+    valid = valid && std::isfinite(saved.est.x[i]) && std::isfinite(p_ii) && p_ii > 0.0f &&
+            saved.est.q_diag[i] > 0.0f && std::isfinite(saved.est.q_diag[i]);
+  }
+  for (int i = 0; i < m; i++)
+    valid = valid && saved.est.r_diag[i] > 0.0f && std::isfinite(saved.est.r_diag[i]);
+  if (!valid) {
+    ESP_LOGW(TAG, "restore: saved state is not finite/positive, ignored");
+    return false;
+  }
+
+  float P[n * n];
+  float Q[n * n];
+  float R[m * m];
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      P[i * n + j] = saved.est.P[HpUkfFilter::packed_index(i, j)];
+      Q[i * n + j] = (i == j) ? saved.est.q_diag[i] : 0.0f;
+    }
+  }
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < m; j++)
+      R[i * m + j] = (i == j) ? saved.est.r_diag[i] : 0.0f;
+    P[i * n + i] = std::max(P[i * n + i], saved.est.r_diag[i]);
+  }
+  filter_.set_initial_state(saved.est.x, P);
+  filter_.set_process_noise(Q);
+  filter_.set_measurement_noise(R);
+  ESP_LOGI(TAG, "restore: warm start from saved state (T_in %.2f, RH_in %.1f, T_out %.2f, RH_out %.1f)",
+           saved.est.x[0], saved.est.x[1], saved.est.x[2], saved.est.x[3]);
+  return true;
+}
+
+// Writes go to the preferences cache; ESPHome flushes it to flash only when the content changed
+// (preferences: flash_write_interval), so state_save_interval bounds the flash wear.
+void HpUkfComponent::save_state_() {
+  if (!initialized_)
     return;
+  HpUkfSavedState saved;
+  saved.tag = SAVED_STATE_TAG;
+  this->get_estimate_(saved.est);
+  bool finite = true;
+  for (int i = 0; i < HpUkfFilter::N; i++)
+    finite = finite && std::isfinite(saved.est.x[i]);
+  for (int i = 0; i < HpUkfFilter::N_PACKED; i++)
+    finite = finite && std::isfinite(saved.est.P[i]);
+  if (!finite) {
+    ESP_LOGW(TAG, "save: filter state not finite, keeping the previous snapshot");
+    return;
+  }
+  if (!state_pref_.save(&saved)) {
+    ESP_LOGW(TAG, "save: writing the filter snapshot failed");
+    return;
+  }
+  ESP_LOGD(TAG, "save: filter snapshot stored (%u bytes)", (unsigned) sizeof(saved));
+}
 
-  uint32_t t0_us = micros();
-  uint32_t heap_before = get_free_heap_bytes();
-  uint32_t now_ms = millis();
-  float dt_s = (now_ms - last_update_ms_) / 1000.0f;
-  dt_s = std::max(1e-6f, std::min(dt_s, 3600.0f));
+void HpUkfComponent::get_estimate_(HpUkfEstimate &est) {
+#ifdef USE_HP_UKF_WORKER
+  if (worker_task_) {
+    est = worker_estimates_.read_buffer();
+    return;
+  }
+#endif
+  capture_estimate(filter_, est);
+}
 
-  filter_.predict(dt_s);
-  uint32_t t_after_predict_us = micros();
+void HpUkfComponent::on_safe_shutdown() {
+  if (restore_state_)
+    this->save_state_();
+}
 
+void HpUkfComponent::on_measurement_(int channel, float value) {
+  if (this->is_failed() || !initialized_)
+    return;
+  if (std::isnan(value)) {
+#ifdef USE_HP_UKF_STATS
+    stats_.nan_events++;
+#endif
+    return;
+  }
+  if (measurement_queue_) {
+    // Time of the reading itself: callback time minus the configured sensor delay.
+    uint32_t delay_ms = (channel <= 1) ? inlet_delay_ms_ : outlet_delay_ms_;
+    TimedMeasurement m{millis() - delay_ms, static_cast<uint8_t>(channel), value};
+    queue_.push(m);
+    return;
+  }
   float z[HpUkfFilter::M];
   bool mask[HpUkfFilter::M];
-  z[0] = read_sensor(inlet_temperature_);
-  z[1] = read_sensor(inlet_humidity_);
-  z[2] = read_sensor(outlet_temperature_);
-  z[3] = read_sensor(outlet_humidity_);
-  for (int i = 0; i < HpUkfFilter::M; i++)
-    mask[i] = !std::isnan(z[i]);
-
-  filter_.update(z, mask);
+  for (int i = 0; i < HpUkfFilter::M; i++) {
+    z[i] = NAN;
+    mask[i] = false;
+  }
+  z[channel] = value;
+  mask[channel] = true;
+  float u[HpUkfControlModel::MAX_INPUTS];
+  this->read_control_(u);
+  this->filter_step_(millis(), z, mask, u);
+  this->publish_filtered_state_();
+}
+
+// Fuse queued samples in time order (see MeasurementQueue::process()); each timestamp is one
+// filter step, so its predict adds the dt share of Q.
+void HpUkfComponent::process_queue_() {
+  // Control inputs change slowly; the current values apply to the whole batch.
+  float u[HpUkfControlModel::MAX_INPUTS];
+  this->read_control_(u);
+  int replayed = queue_.process(filter_, control_state_, last_update_ms_, millis(), queue_window_ms_,
+                                [this, &u](uint32_t t_ms, const float *z, const bool *mask) {
+                                  this->filter_step_(t_ms, z, mask, u);
+                                });
+  if (replayed >= 0)
+    ESP_LOGD(TAG, "queue: late sample, replayed %d fused sample(s) from checkpoint", replayed);
+
+  uint32_t dropped = queue_.get_dropped();
+  if (dropped != queue_dropped_logged_) {
+    ESP_LOGW(TAG, "queue: %u sample(s) dropped (queue full or older than the checkpoint)",
+             (unsigned) (dropped - queue_dropped_logged_));
+    queue_dropped_logged_ = dropped;
+  }
+}
+
+// Predict from the filter time up to t_ms (skipped if no time passed), then update with the
+// available measurements. The control feed-forward is applied before the predict so the
+// response starts within the step (and also works with fused_predict_update).
+// Timings go to the `stats:` counters (USE_HP_UKF_STATS) instead of a per-step log line; the
+// verbose log keeps them for bench sessions.
+void HpUkfComponent::filter_step_(uint32_t t_ms, const float *z, const bool *mask, const float *u) {
+#ifdef USE_HP_UKF_STATS
+  uint32_t c0 = arch_get_cpu_cycle_count();
+#endif
+  uint32_t t0_us = micros();
+  uint32_t t_predict_us = t0_us;
+  int32_t elapsed_ms = static_cast<int32_t>(t_ms - last_update_ms_);
+  float dt_s = elapsed_ms / 1000.0f;
+  bool dt_clamped = dt_s > 3600.0f;
+  dt_s = std::max(1e-6f, std::min(dt_s, 3600.0f));
+  if (elapsed_ms > 0 && control_.size() > 0)
+    this->apply_control_(u, dt_s);
+  // Q is the process noise of one nominal step (update_interval, or min_interval with
+  // adaptive_interval); event-driven and queued sub-steps add their dt share of it.
+  if (elapsed_ms > 0) {
+    filter_.set_process_noise_scale(adaptive_ ? scheduler_.process_noise_scale(dt_s)
+                                              : dt_s * 1000.0f / (float) this->get_update_interval());
+  }
+
+  if (elapsed_ms <= 0) {
+    filter_.update(z, mask);
+  } else if (fused_predict_update_) {
+    filter_.predict_update(dt_s, z, mask);
+  } else {
+    filter_.predict(dt_s);
+    t_predict_us = micros();
+    filter_.update(z, mask);
+  }
   uint32_t t_end_us = micros();
-  uint32_t heap_after = get_free_heap_bytes();
-  ESP_LOGD(TAG, "update: predict %.2f ms, update %.2f ms, total %.2f ms, free_heap %u -> %u bytes",
-           (t_after_predict_us - t0_us) / 1000.0f, (t_end_us - t_after_predict_us) / 1000.0f,
-           (t_end_us - t0_us) / 1000.0f, (unsigned) heap_before, (unsigned) heap_after);
-  last_update_ms_ = now_ms;
+  ESP_LOGV(TAG, "step: predict %u us, update %u us", (unsigned) (t_predict_us - t0_us),
+           (unsigned) (t_end_us - t_predict_us));
+  if (elapsed_ms > 0)
+    last_update_ms_ = t_ms;
+  uint32_t new_sr_failures = filter_.get_sr_downdate_failures() - sr_downdate_failures_;
+  if (new_sr_failures != 0) {
+    sr_downdate_failures_ = filter_.get_sr_downdate_failures();
+    ESP_LOGW(TAG, "SR-UKF: covariance downdate skipped (loss of positive-definiteness), total %u",
+             (unsigned) sr_downdate_failures_);
+  }
+  // A queue replay restores the counters from the checkpoint and counts the replayed samples
+  // again, so only increases are reported.
+  uint32_t rejected = filter_.get_rejected_count();
+  uint32_t rejected_before = gate_rejected_.load(std::memory_order_relaxed);
+  if (rejected > rejected_before)
+    ESP_LOGD(TAG, "innovation gate: %u measurement(s) rejected", (unsigned) (rejected - rejected_before));
+  gate_rejected_.store(rejected, std::memory_order_relaxed);
+  uint32_t resets = filter_.get_reset_count();
+  if (resets > gate_resets_.load(std::memory_order_relaxed))
+    ESP_LOGW(TAG, "innovation gate: covariance soft reset (persistent outlier or divergence), total %u",
+             (unsigned) resets);
+  gate_resets_.store(resets, std::memory_order_relaxed);
 
+#ifdef USE_HP_UKF_STATS
+  stats_.step_cycles.add(arch_get_cpu_cycle_count() - c0);
+  stats_.step_us.add(t_end_us - t0_us);
+  if (elapsed_ms > 0 && !fused_predict_update_) {
+    stats_.predict_us.add(t_predict_us - t0_us);
+    stats_.update_us.add(t_end_us - t_predict_us);
+  }
+  stats_.steps++;
+  stats_.clamp_events += new_sr_failures + (dt_clamped ? 1 : 0);
   const float *x = filter_.get_state();
-  // Only publish finite values so we don't overwrite with NaN (e.g. when source
-  // sensors haven't reported yet or filter is still converging).
-  if (filtered_inlet_temperature_ && std::isfinite(x[0]))
-    filtered_inlet_temperature_->publish_state(x[0]);
-  if (filtered_inlet_humidity_ && std::isfinite(x[1]))
-    filtered_inlet_humidity_->publish_state(x[1]);
-  if (filtered_outlet_temperature_ && std::isfinite(x[2]))
-    filtered_outlet_temperature_->publish_state(x[2]);
-  if (filtered_outlet_humidity_ && std::isfinite(x[3]))
-    filtered_outlet_humidity_->publish_state(x[3]);
-  if (track_derivatives_) {
-    if (filtered_inlet_temperature_derivative_ && std::isfinite(x[4]))
-      filtered_inlet_temperature_derivative_->publish_state(x[4]);
-    if (filtered_outlet_temperature_derivative_ && std::isfinite(x[5]))
-      filtered_outlet_temperature_derivative_->publish_state(x[5]);
-    if (filtered_inlet_humidity_derivative_ && std::isfinite(x[6]))
-      filtered_inlet_humidity_derivative_->publish_state(x[6]);
-    if (filtered_outlet_humidity_derivative_ && std::isfinite(x[7]))
-      filtered_outlet_humidity_derivative_->publish_state(x[7]);
+  for (int i = 0; i < HpUkfFilter::N; i++) {
+    if (!std::isfinite(x[i])) {
+      stats_.nan_events++;
+      break;
+    }
   }
+  stats_.heap_min_free = std::min(stats_.heap_min_free, get_free_heap_bytes());
+#else
+  (void) dt_clamped;
+#endif
+}
 
-  if (em_autotune_) {
-    float q_diag[HpUkfFilter::N_MAX], r_diag[HpUkfFilter::M];
-    filter_.get_process_noise_diag(q_diag);
-    filter_.get_measurement_noise_diag(r_diag);
-    static uint32_t s_update_count;
-    if (s_update_count < 3) {
-      ESP_LOGI(TAG, "update#%u Q/R: q[0]=%.6f r[0]=%.6f finite=%d %d",
-               s_update_count, q_diag[0], r_diag[0],
-               std::isfinite(q_diag[0]) ? 1 : 0, std::isfinite(r_diag[0]) ? 1 : 0);
-      s_update_count++;
+void HpUkfComponent::read_control_(float *u) {
+  for (int j = 0; j < control_.size(); j++)
+    u[j] = read_sensor(control_sensors_[j]);
+}
+
+// Known additive input: only x moves (through set_state), P is unchanged. With rate states the
+// change of the feed-forward rate goes to dT_out/dRH_out, otherwise f * dt to the levels.
+void HpUkfComponent::apply_control_(const float *u, float dt_s) {
+  float d_rate[2], d_level[2];
+  control_.step(control_state_, u, dt_s, d_rate, d_level);
+  if (d_rate[0] == 0.0f && d_rate[1] == 0.0f && d_level[0] == 0.0f && d_level[1] == 0.0f)
+    return;
+  float x[HpUkfFilter::N];
+  const float *x_now = filter_.get_state();
+  for (int i = 0; i < HpUkfFilter::N; i++)
+    x[i] = x_now[i];
+  if constexpr (TRACK_DERIVATIVES) {
+    x[5] += d_rate[0];  // dT_out
+    x[7] += d_rate[1];  // dRH_out
+  } else {
+    x[2] += d_level[0];
+    x[3] += d_level[1];
+  }
+  filter_.set_state(x);
+}
+
+#ifdef USE_HP_UKF_STATS
+// One summary line per stats_interval; timing windows restart after each summary.
+void HpUkfComponent::report_stats_() {
+  ESP_LOGI(TAG,
+           "stats: %u steps, step %u/%u/%u us (%u cyc max), predict %u/%u/%u us, update %u/%u/%u us, "
+           "nan %u, clamp %u, heap min %u B",
+           (unsigned) stats_.step_us.count, (unsigned) stats_.step_us.min_or_zero(), (unsigned) stats_.step_us.mean(),
+           (unsigned) stats_.step_us.max, (unsigned) stats_.step_cycles.max,
+           (unsigned) stats_.predict_us.min_or_zero(), (unsigned) stats_.predict_us.mean(),
+           (unsigned) stats_.predict_us.max, (unsigned) stats_.update_us.min_or_zero(),
+           (unsigned) stats_.update_us.mean(), (unsigned) stats_.update_us.max, (unsigned) stats_.nan_events,
+           (unsigned) stats_.clamp_events, (unsigned) stats_.heap_min_free);
+  if (stats_step_time_mean_ && stats_.step_us.count)
+    stats_step_time_mean_->publish_state(stats_.step_us.mean() / 1000.0f);
+  if (stats_step_time_max_ && stats_.step_us.count)
+    stats_step_time_max_->publish_state(stats_.step_us.max / 1000.0f);
+  if (stats_step_cycles_max_ && stats_.step_cycles.count)
+    stats_step_cycles_max_->publish_state(stats_.step_cycles.max);
+  if (stats_nan_events_)
+    stats_nan_events_->publish_state(stats_.nan_events);
+  if (stats_clamp_events_)
+    stats_clamp_events_->publish_state(stats_.clamp_events);
+  if (stats_heap_min_free_ && stats_.heap_min_free != UINT32_MAX)
+    stats_heap_min_free_->publish_state(stats_.heap_min_free);
+  stats_.reset_window();
+}
+#endif
+
+// With publish_sigma > 0 a value is only published when it moved more than publish_sigma
+// standard deviations (sqrt of its P diagonal, or the unscented variance for derived outputs)
+// since its last publish, or when publish_max_interval has passed.
+void HpUkfComponent::publish_filtered_state_() {
+  const float *P = (publish_sigma_ > 0.0f || has_psychro_) ? filter_.get_covariance_packed() : nullptr;
+  this->publish_filtered_state_(filter_.get_state(), P);
+}
+
+void HpUkfComponent::publish_filtered_state_(const float *x, const float *P) {
+  sensor::Sensor *outputs[HpUkfFilter::N];
+  outputs[0] = filtered_inlet_temperature_;
+  outputs[1] = filtered_inlet_humidity_;
+  outputs[2] = filtered_outlet_temperature_;
+  outputs[3] = filtered_outlet_humidity_;
+  if constexpr (TRACK_DERIVATIVES) {
+    outputs[4] = filtered_inlet_temperature_derivative_;
+    outputs[5] = filtered_outlet_temperature_derivative_;
+    outputs[6] = filtered_inlet_humidity_derivative_;
+    outputs[7] = filtered_outlet_humidity_derivative_;
+  }
+  uint32_t now_ms = millis();
+  for (int i = 0; i < HpUkfFilter::N; i++) {
+    // Only publish finite values so we don't overwrite with NaN (e.g. when source
+    // sensors haven't reported yet or filter is still converging).
+    if (outputs[i] == nullptr || !std::isfinite(x[i]))
+      continue;
+    float sigma = (P != nullptr) ? std::sqrt(std::max(P[HpUkfFilter::packed_index(i, i)], 0.0f)) : 0.0f;
+    this->publish_gated_(outputs[i], i, x[i], sigma, now_ms);
+  }
+  if (has_psychro_ && P != nullptr)
+    this->publish_psychro_(x, P, now_ms);
+}
+
+// Derived outputs: unscented transform of the level block of P (hp_ukf_psychro.h), so the
+// published value is the mean over the level uncertainty and its spread drives the gating.
+void HpUkfComponent::publish_psychro_(const float *x, const float *P, uint32_t now_ms) {
+  float P4[ut_packed_index<4>(3, 3) + 1];
+  for (int i = 0; i < 4; i++)
+    for (int j = i; j < 4; j++)
+      P4[ut_packed_index<4>(i, j)] = P[HpUkfFilter::packed_index(i, j)];
+  float mean[PSYCHRO_OUTPUT_COUNT], var[PSYCHRO_OUTPUT_COUNT];
+  psychro_unscented(x, P4, pressure_hpa_, mean, var);
+  for (int o = 0; o < PSYCHRO_OUTPUT_COUNT; o++) {
+    bool with_std_dev = o == PSYCHRO_ENTHALPY_DELTA && enthalpy_delta_std_dev_ != nullptr;
+    if ((psychro_sensors_[o] == nullptr && !with_std_dev) || !std::isfinite(mean[o]) || !std::isfinite(var[o]))
+      continue;
+    float sigma = std::sqrt(std::max(var[o], 0.0f));
+    if (this->publish_gated_(psychro_sensors_[o], HpUkfFilter::N + o, mean[o], sigma, now_ms) && with_std_dev)
+      enthalpy_delta_std_dev_->publish_state(sigma);
+  }
+}
+
+bool HpUkfComponent::publish_gated_(sensor::Sensor *s, int slot, float value, float sigma, uint32_t now_ms) {
+  if (publish_sigma_ > 0.0f && published_[slot] && now_ms - last_publish_ms_[slot] < publish_max_interval_ms_ &&
+      std::fabs(value - last_published_[slot]) <= publish_sigma_ * sigma)
+    return false;
+  if (s != nullptr)
+    s->publish_state(value);
+  last_published_[slot] = value;
+  last_publish_ms_[slot] = now_ms;
+  published_[slot] = true;
+  return true;
+}
+
+void HpUkfComponent::update() {
+  if (this->is_failed() || !initialized_)
+    return;
+
+  // In event-driven and queue mode each input sample arrives through on_measurement_(), so
+  // polling would only fuse the same readings a second time.
+  if (measurement_queue_) {
+    this->process_queue_();
+    this->publish_filtered_state_();
+  } else if (!event_driven_) {
+    float z[HpUkfFilter::M];
+    bool mask[HpUkfFilter::M];
+    z[0] = read_sensor(inlet_temperature_);
+    z[1] = read_sensor(inlet_humidity_);
+    z[2] = read_sensor(outlet_temperature_);
+    z[3] = read_sensor(outlet_humidity_);
+    for (int i = 0; i < HpUkfFilter::M; i++)
+      mask[i] = !std::isnan(z[i]);
+#ifdef USE_HP_UKF_STATS
+    sensor::Sensor *inputs[HpUkfFilter::M] = {inlet_temperature_, inlet_humidity_, outlet_temperature_,
+                                              outlet_humidity_};
+    for (int i = 0; i < HpUkfFilter::M; i++) {
+      if (inputs[i] != nullptr && inputs[i]->has_state() && !mask[i])
+        stats_.nan_events++;
     }
-    int n = filter_.get_state_dimension();
-    // Debug: Q/R diagonal in copy-paste form for use as compile-time initial values
-    ESP_LOGD(TAG, "Q/R diagonal (copy to hp_ukf initial config):");
-    ESP_LOGD(TAG, "  q_t_in: %.6e  q_rh_in: %.6e  q_t_out: %.6e  q_rh_out: %.6e",
-             q_diag[0], q_diag[1], q_diag[2], q_diag[3]);
-    if (n >= 8) {
-      ESP_LOGD(TAG, "  q_dt_in: %.6e  q_dt_out: %.6e  q_drh_in: %.6e  q_drh_out: %.6e",
-               q_diag[4], q_diag[5], q_diag[6], q_diag[7]);
+#endif
+    if (adaptive_ && !this->adaptive_step_due_(millis(), z, mask)) {
+      // Quiet poll: nothing to fuse or publish.
     }
-    ESP_LOGD(TAG, "  r_t_in: %.6e  r_rh_in: %.6e  r_t_out: %.6e  r_rh_out: %.6e",
-             r_diag[0], r_diag[1], r_diag[2], r_diag[3]);
-    if (em_q_t_in_ && std::isfinite(q_diag[0])) em_q_t_in_->publish_state(q_diag[0]);
-    if (em_q_rh_in_ && std::isfinite(q_diag[1])) em_q_rh_in_->publish_state(q_diag[1]);
-    if (em_q_t_out_ && std::isfinite(q_diag[2])) em_q_t_out_->publish_state(q_diag[2]);
-    if (em_q_rh_out_ && std::isfinite(q_diag[3])) em_q_rh_out_->publish_state(q_diag[3]);
-    if (n >= 8) {
-      if (em_q_dt_in_ && std::isfinite(q_diag[4])) em_q_dt_in_->publish_state(q_diag[4]);
-      if (em_q_dt_out_ && std::isfinite(q_diag[5])) em_q_dt_out_->publish_state(q_diag[5]);
-      if (em_q_drh_in_ && std::isfinite(q_diag[6])) em_q_drh_in_->publish_state(q_diag[6]);
-      if (em_q_drh_out_ && std::isfinite(q_diag[7])) em_q_drh_out_->publish_state(q_diag[7]);
+#ifdef USE_HP_UKF_WORKER
+    else if (worker_task_) {
+      WorkerSample sample;
+      sample.t_ms = millis();
+      for (int i = 0; i < HpUkfFilter::M; i++) {
+        sample.z[i] = z[i];
+        sample.mask[i] = mask[i];
+      }
+      this->read_control_(sample.u);
+      if (!worker_samples_.push(sample))
+        worker_dropped_++;
+      worker_.notify();
+      if (worker_dropped_ != worker_dropped_logged_) {
+        ESP_LOGW(TAG, "worker: %u sample(s) dropped (worker task behind)",
+                 (unsigned) (worker_dropped_ - worker_dropped_logged_));
+        worker_dropped_logged_ = worker_dropped_;
+      }
+    } else
+#endif
+    {
+      float u[HpUkfControlModel::MAX_INPUTS];
+      this->read_control_(u);
+      this->filter_step_(millis(), z, mask, u);
+      this->publish_filtered_state_();
+    }
+  }
+
+  // EM diagnostics change slowly; em_publish_interval keeps them off the per-tick path.
+  uint32_t now_ms = millis();
+  if (em_autotune_ && (!em_published_ || now_ms - em_published_ms_ >= em_publish_interval_ms_)) {
+    em_published_ms_ = now_ms;
+    em_published_ = true;
+#ifdef USE_HP_UKF_WORKER
+    if (worker_task_) {
+      const HpUkfEstimate &est = worker_estimates_.read_buffer();
+      this->publish_em_diagnostics_(est.q_diag, est.r_diag);
+    } else
+#endif
+    {
+      float q_diag[HpUkfFilter::N], r_diag[HpUkfFilter::M];
+      filter_.get_process_noise_diag(q_diag);
+      filter_.get_measurement_noise_diag(r_diag);
+      this->publish_em_diagnostics_(q_diag, r_diag);
+    }
+  }
+
+  if (gate_sigma_ > 0.0f)
+    this->publish_gate_diagnostics_();
+  if (step_interval_ != nullptr && scheduler_.get_interval() != step_interval_published_) {
+    step_interval_published_ = scheduler_.get_interval();
+    step_interval_->publish_state(step_interval_published_ / 1000.0f);
+  }
+
+#ifdef USE_HP_UKF_STATS
+  if (now_ms - stats_reported_ms_ >= stats_interval_ms_) {
+    stats_reported_ms_ = now_ms;
+    this->report_stats_();
+  }
+#endif
+}
+
+void HpUkfComponent::publish_em_diagnostics_(const float *q_diag, const float *r_diag) {
+  static uint32_t s_update_count;
+  if (s_update_count < 3) {
+    ESP_LOGI(TAG, "update#%u Q/R: q[0]=%.6f r[0]=%.6f finite=%d %d",
+             s_update_count, q_diag[0], r_diag[0],
+             std::isfinite(q_diag[0]) ? 1 : 0, std::isfinite(r_diag[0]) ? 1 : 0);
+    s_update_count++;
+  }
+  // Q/R diagonal in copy-paste form for use as compile-time initial values (verbose only;
+  // the float formatting costs more than the filter step).
+  ESP_LOGV(TAG, "Q/R diagonal (copy to hp_ukf initial config):");
+  ESP_LOGV(TAG, "  q_t_in: %.6e  q_rh_in: %.6e  q_t_out: %.6e  q_rh_out: %.6e",
+           q_diag[0], q_diag[1], q_diag[2], q_diag[3]);
+  if constexpr (TRACK_DERIVATIVES) {
+    ESP_LOGV(TAG, "  q_dt_in: %.6e  q_dt_out: %.6e  q_drh_in: %.6e  q_drh_out: %.6e",
+             q_diag[4], q_diag[5], q_diag[6], q_diag[7]);
+  }
+  ESP_LOGV(TAG, "  r_t_in: %.6e  r_rh_in: %.6e  r_t_out: %.6e  r_rh_out: %.6e",
+           r_diag[0], r_diag[1], r_diag[2], r_diag[3]);
+  if (em_q_t_in_ && std::isfinite(q_diag[0])) em_q_t_in_->publish_state(q_diag[0]);
+  if (em_q_rh_in_ && std::isfinite(q_diag[1])) em_q_rh_in_->publish_state(q_diag[1]);
+  if (em_q_t_out_ && std::isfinite(q_diag[2])) em_q_t_out_->publish_state(q_diag[2]);
+  if (em_q_rh_out_ && std::isfinite(q_diag[3])) em_q_rh_out_->publish_state(q_diag[3]);
+  if constexpr (TRACK_DERIVATIVES) {
+    if (em_q_dt_in_ && std::isfinite(q_diag[4])) em_q_dt_in_->publish_state(q_diag[4]);
+    if (em_q_dt_out_ && std::isfinite(q_diag[5])) em_q_dt_out_->publish_state(q_diag[5]);
+    if (em_q_drh_in_ && std::isfinite(q_diag[6])) em_q_drh_in_->publish_state(q_diag[6]);
+    if (em_q_drh_out_ && std::isfinite(q_diag[7])) em_q_drh_out_->publish_state(q_diag[7]);
+  }
+  if (em_r_t_in_ && std::isfinite(r_diag[0])) em_r_t_in_->publish_state(r_diag[0]);
+  if (em_r_rh_in_ && std::isfinite(r_diag[1])) em_r_rh_in_->publish_state(r_diag[1]);
+  if (em_r_t_out_ && std::isfinite(r_diag[2])) em_r_t_out_->publish_state(r_diag[2]);
+  if (em_r_rh_out_ && std::isfinite(r_diag[3])) em_r_rh_out_->publish_state(r_diag[3]);
+  if (em_lambda_q_sensor_) em_lambda_q_sensor_->publish_state(em_lambda_q_);
+  if (em_lambda_r_inlet_sensor_) em_lambda_r_inlet_sensor_->publish_state(em_lambda_r_inlet_);
+  if (em_lambda_r_outlet_sensor_) em_lambda_r_outlet_sensor_->publish_state(em_lambda_r_outlet_);
+}
+
+// Counters are published when they change (and once at start) so idle ticks send nothing.
+void HpUkfComponent::publish_gate_diagnostics_() {
+  uint32_t rejected = gate_rejected_.load(std::memory_order_relaxed);
+  uint32_t resets = gate_resets_.load(std::memory_order_relaxed);
+  if (gate_published_ && rejected == gate_rejected_published_ && resets == gate_resets_published_)
+    return;
+  gate_published_ = true;
+  gate_rejected_published_ = rejected;
+  gate_resets_published_ = resets;
+  if (rejected_measurements_ != nullptr)
+    rejected_measurements_->publish_state(rejected);
+  if (filter_resets_ != nullptr)
+    filter_resets_->publish_state(resets);
+}
+
+// Runs on the main loop against the newest estimate (the worker's snapshot with worker_task).
+bool HpUkfComponent::adaptive_step_due_(uint32_t now_ms, const float *z, const bool *mask) {
+#ifdef USE_HP_UKF_WORKER
+  if (worker_task_) {
+    const HpUkfEstimate &est = worker_estimates_.read_buffer();
+    return scheduler_.due(now_ms, est.x, est.P, est.r_diag, z, mask);
+  }
+#endif
+  float r_diag[HpUkfFilter::M];
+  filter_.get_measurement_noise_diag(r_diag);
+  return scheduler_.due(now_ms, filter_.get_state(), filter_.get_covariance_packed(), r_diag, z, mask);
+}
+
+#ifdef USE_HP_UKF_WORKER
+// Main loop side of worker_task: publish the worker's newest estimate, if any.
+void HpUkfComponent::loop() {
+  if (!worker_task_ || !initialized_ || !worker_estimates_.consume())
+    return;
+  const HpUkfEstimate &est = worker_estimates_.read_buffer();
+  this->publish_filtered_state_(est.x, est.P);
+}
+
+void HpUkfComponent::worker_entry_(void *arg) { static_cast<HpUkfComponent *>(arg)->worker_run_(); }
+
+// Worker task: owns filter_ from here on. Wake-ups collapse, so each one drains the sample
+// queue and hands back one estimate for the batch. Never returns (FreeRTOS task body).
+void HpUkfComponent::worker_run_() {
+  WorkerSample sample;
+  while (true) {
+    worker_.wait();
+    bool stepped = false;
+    while (worker_samples_.pop(sample)) {
+      this->filter_step_(sample.t_ms, sample.z, sample.mask, sample.u);
+      stepped = true;
+    }
+    if (stepped) {
+      capture_estimate(filter_, worker_estimates_.write_buffer());
+      worker_estimates_.publish();
     }
-    if (em_r_t_in_ && std::isfinite(r_diag[0])) em_r_t_in_->publish_state(r_diag[0]);
-    if (em_r_rh_in_ && std::isfinite(r_diag[1])) em_r_rh_in_->publish_state(r_diag[1]);
-    if (em_r_t_out_ && std::isfinite(r_diag[2])) em_r_t_out_->publish_state(r_diag[2]);
-    if (em_r_rh_out_ && std::isfinite(r_diag[3])) em_r_rh_out_->publish_state(r_diag[3]);
-    if (em_lambda_q_sensor_) em_lambda_q_sensor_->publish_state(em_lambda_q_);
-    if (em_lambda_r_inlet_sensor_) em_lambda_r_inlet_sensor_->publish_state(em_lambda_r_inlet_);
-    if (em_lambda_r_outlet_sensor_) em_lambda_r_outlet_sensor_->publish_state(em_lambda_r_outlet_);
   }
 }
+#endif
 
 void HpUkfComponent::dump_config() {
   ESP_LOGCONFIG(TAG, "HP-UKF component");
   LOG_UPDATE_INTERVAL(this);
   ESP_LOGCONFIG(TAG, "  Track derivatives (dT_in, dT_out, dRH_in, dRH_out): %s",
-                track_derivatives_ ? "yes" : "no");
+                TRACK_DERIVATIVES ? "yes" : "no");
+#ifdef HP_UKF_FIXED_POINT
+  ESP_LOGCONFIG(TAG, "  Numeric backend: fixed-point (Q16.16 levels, Q8.24 rates/covariance), linear KF");
+#else
+  ESP_LOGCONFIG(TAG, "  Filter mode: %s", filter_mode_to_string(filter_mode_));
+#endif
+  ESP_LOGCONFIG(TAG, "  Fused predict/update: %s", fused_predict_update_ ? "yes" : "no");
+  ESP_LOGCONFIG(TAG, "  Sequential scalar update: %s", sequential_update_ ? "yes" : "no");
+  ESP_LOGCONFIG(TAG, "  Event-driven updates: %s", event_driven_ ? "yes" : "no");
+  if (measurement_queue_) {
+    ESP_LOGCONFIG(TAG, "  Measurement queue: %d samples, window %u ms, inlet/outlet delay %u/%u ms", QUEUE_SIZE,
+                  (unsigned) queue_window_ms_, (unsigned) inlet_delay_ms_, (unsigned) outlet_delay_ms_);
+  }
+  if (publish_sigma_ > 0.0f) {
+    ESP_LOGCONFIG(TAG, "  Publish gating: %.2f sigma, heartbeat %u ms", publish_sigma_,
+                  (unsigned) publish_max_interval_ms_);
+  }
+  if (control_.size() > 0) {
+    ESP_LOGCONFIG(TAG, "  Control inputs: %d, time constant %.1f s", control_.size(),
+                  control_.get_time_constant());
+  }
+  if (has_psychro_)
+    ESP_LOGCONFIG(TAG, "  Psychrometric outputs: yes, pressure %.2f hPa", pressure_hpa_);
+  if (adaptive_) {
+    ESP_LOGCONFIG(TAG, "  Adaptive interval: %u-%u ms", (unsigned) scheduler_.get_min_interval(),
+                  (unsigned) scheduler_.get_max_interval());
+  }
+  if (gate_sigma_ > 0.0f) {
+    ESP_LOGCONFIG(TAG, "  Innovation gate: %.1f sigma, reset after %u rejections, divergence NIS %.1f", gate_sigma_,
+                  (unsigned) gate_max_rejections_, gate_divergence_nis_);
+  }
+  if (restore_state_)
+    ESP_LOGCONFIG(TAG, "  Restore state: yes, saved every %u ms", (unsigned) state_save_interval_ms_);
+#ifdef USE_HP_UKF_WORKER
+  if (worker_task_) {
+    ESP_LOGCONFIG(TAG, "  Worker task: core %d, priority %d, stack %u B", worker_core_, worker_priority_,
+                  (unsigned) WORKER_STACK_SIZE);
+  }
+#endif
+#ifdef USE_HP_UKF_STATS
+  ESP_LOGCONFIG(TAG, "  Stats summary every %u ms", (unsigned) stats_interval_ms_);
+#endif
   ESP_LOGCONFIG(TAG, "  Inlet temperature sensor: %s", inlet_temperature_ ? "set" : "not set");
   ESP_LOGCONFIG(TAG, "  Inlet humidity sensor: %s", inlet_humidity_ ? "set" : "not set");
   ESP_LOGCONFIG(TAG, "  Outlet temperature sensor: %s", outlet_temperature_ ? "set" : "not set");
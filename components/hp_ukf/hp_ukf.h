@@ -1,26 +1,84 @@
 #pragma once
 
+#include <atomic>
 #include "esphome/core/component.h"
+#include "esphome/core/defines.h"
 #include "esphome/core/hal.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/sensor/sensor.h"
+#include "hp_ukf_adaptive.h"
+#include "hp_ukf_control.h"
+#include "hp_ukf_psychro.h"
+#include "hp_ukf_queue.h"
+#include "hp_ukf_stats.h"
 #include "hp_ukf_ukf.h"
+#ifdef HP_UKF_FIXED_POINT
+#include "hp_ukf_fixed.h"
+#endif
+#ifdef USE_HP_UKF_WORKER
+#include "hp_ukf_worker.h"
+#endif
 
 namespace esphome {
 namespace hp_ukf {
 
+// State dimension, emitted by __init__.py from track_temperature_derivatives (8 with rates, 4 without).
+#ifndef HP_UKF_STATE_DIM
+#define HP_UKF_STATE_DIM 8
+#endif
+// Numeric backend, emitted by __init__.py from `numeric` (fixed-point on FPU-less targets).
+#ifdef HP_UKF_FIXED_POINT
+using HpUkfFilter = HpUkfFixedFilterT<HP_UKF_STATE_DIM>;
+#else
+using HpUkfFilter = HpUkfFilterT<HP_UKF_STATE_DIM>;
+#endif
+
+// Filter outputs as the main loop sees them: state, packed covariance and the (EM-adapted) Q/R
+// diagonals.
+struct HpUkfEstimate {
+  float x[HpUkfFilter::N];
+  float P[HpUkfFilter::N_PACKED];
+  float q_diag[HpUkfFilter::N];
+  float r_diag[HpUkfFilter::M];
+};
+
+// Filter snapshot kept in flash with `restore_state`. tag holds the layout version and the
+// shape (N, M); a record with another tag is ignored.
+struct HpUkfSavedState {
+  uint32_t tag;
+  HpUkfEstimate est;
+};
+
 class HpUkfComponent : public PollingComponent {
  public:
   void setup() override;
   void update() override;
+#ifdef USE_HP_UKF_WORKER
+  void loop() override;
+#endif
   void dump_config() override;
 
   float get_setup_priority() const override { return setup_priority::DATA; }
+  // Saves the snapshot before an OTA/API reboot (preferences are synced right after).
+  void on_safe_shutdown() override;
 
   void set_inlet_temperature_sensor(sensor::Sensor *s) { inlet_temperature_ = s; }
   void set_inlet_humidity_sensor(sensor::Sensor *s) { inlet_humidity_ = s; }
   void set_outlet_temperature_sensor(sensor::Sensor *s) { outlet_temperature_ = s; }
   void set_outlet_humidity_sensor(sensor::Sensor *s) { outlet_humidity_ = s; }
-  void set_track_temperature_derivatives(bool v) { track_derivatives_ = v; }
+  void set_filter_mode(FilterMode mode) { filter_mode_ = mode; }
+  void set_fused_predict_update(bool v) { fused_predict_update_ = v; }
+  void set_sequential_update(bool v) { sequential_update_ = v; }
+  void set_event_driven(bool v) { event_driven_ = v; }
+  void set_measurement_queue(bool v) { measurement_queue_ = v; }
+  void set_queue_window(uint32_t ms) { queue_window_ms_ = ms; }
+  void set_inlet_delay(uint32_t ms) { inlet_delay_ms_ = ms; }
+  void set_outlet_delay(uint32_t ms) { outlet_delay_ms_ = ms; }
+  void set_publish_sigma(float k) { publish_sigma_ = k; }
+  void set_publish_max_interval(uint32_t ms) { publish_max_interval_ms_ = ms; }
+  void set_em_publish_interval(uint32_t ms) { em_publish_interval_ms_ = ms; }
+  void set_restore_state(bool v) { restore_state_ = v; }
+  void set_state_save_interval(uint32_t ms) { state_save_interval_ms_ = ms; }
 
   void set_filtered_inlet_temperature_sensor(sensor::Sensor *s) { filtered_inlet_temperature_ = s; }
   void set_filtered_inlet_humidity_sensor(sensor::Sensor *s) { filtered_inlet_humidity_ = s; }
@@ -39,6 +97,29 @@ class HpUkfComponent : public PollingComponent {
     filtered_outlet_humidity_derivative_ = s;
   }
 
+  // output: PsychroOutput (hp_ukf_psychro.h).
+  void set_psychro_sensor(int output, sensor::Sensor *s) {
+    psychro_sensors_[output] = s;
+    has_psychro_ = true;
+  }
+  void set_enthalpy_delta_std_dev_sensor(sensor::Sensor *s) {
+    enthalpy_delta_std_dev_ = s;
+    has_psychro_ = true;
+  }
+  void set_pressure(float hpa) { pressure_hpa_ = hpa; }
+
+  // Control inputs (`control:`): a linear input, optionally turned into a table by the points
+  // added right after it.
+  void add_control_input(sensor::Sensor *s, float gain_t_out, float gain_rh_out) {
+    int j = control_.add_linear_input(gain_t_out, gain_rh_out);
+    if (j >= 0)
+      control_sensors_[j] = s;
+  }
+  void add_control_table_point(float u, float t_out, float rh_out) {
+    control_.add_table_point(control_.size() - 1, u, t_out, rh_out);
+  }
+  void set_control_time_constant(uint32_t ms) { control_.set_time_constant(ms / 1000.0f); }
+
   void set_em_autotune(bool v) { em_autotune_ = v; }
   void set_em_lambda_q(float v) { em_lambda_q_ = v; }
   void set_em_lambda_r_inlet(float v) { em_lambda_r_inlet_ = v; }
@@ -61,12 +142,102 @@ class HpUkfComponent : public PollingComponent {
   void set_em_lambda_r_inlet_sensor(sensor::Sensor *s) { em_lambda_r_inlet_sensor_ = s; }
   void set_em_lambda_r_outlet_sensor(sensor::Sensor *s) { em_lambda_r_outlet_sensor_ = s; }
 
+  // Innovation gate (`innovation_gate:`, see HpUkfInnovationGate). divergence_nis 0 disables
+  // the divergence detector.
+  void set_innovation_gate(float sigma, uint16_t max_rejections, float divergence_nis) {
+    gate_sigma_ = sigma;
+    gate_max_rejections_ = max_rejections;
+    gate_divergence_nis_ = divergence_nis;
+  }
+  void set_rejected_measurements_sensor(sensor::Sensor *s) { rejected_measurements_ = s; }
+  void set_filter_resets_sensor(sensor::Sensor *s) { filter_resets_ = s; }
+
+  // Adaptive step interval (`adaptive_interval:`, see HpUkfAdaptiveScheduler); polling mode only.
+  void set_adaptive_interval(uint32_t min_ms, uint32_t max_ms, float temperature_rate, float humidity_rate,
+                             float innovation_sigma) {
+    scheduler_.configure(min_ms, max_ms, temperature_rate, humidity_rate, innovation_sigma);
+    adaptive_ = true;
+  }
+  void set_step_interval_sensor(sensor::Sensor *s) { step_interval_ = s; }
+
+#ifdef USE_HP_UKF_WORKER
+  void set_worker_task(bool v) { worker_task_ = v; }
+  void set_worker_core(int core) { worker_core_ = core; }
+  void set_worker_priority(int priority) { worker_priority_ = priority; }
+#endif
+
+#ifdef USE_HP_UKF_STATS
+  void set_stats_interval(uint32_t ms) { stats_interval_ms_ = ms; }
+  void set_stats_step_time_mean_sensor(sensor::Sensor *s) { stats_step_time_mean_ = s; }
+  void set_stats_step_time_max_sensor(sensor::Sensor *s) { stats_step_time_max_ = s; }
+  void set_stats_step_cycles_max_sensor(sensor::Sensor *s) { stats_step_cycles_max_ = s; }
+  void set_stats_nan_events_sensor(sensor::Sensor *s) { stats_nan_events_ = s; }
+  void set_stats_clamp_events_sensor(sensor::Sensor *s) { stats_clamp_events_ = s; }
+  void set_stats_heap_min_free_sensor(sensor::Sensor *s) { stats_heap_min_free_ = s; }
+#endif
+
  protected:
+  // Event-driven mode: predict to now and apply the single new sample of `channel` (0..3).
+  // Queue mode: timestamp the sample and queue it for process_queue_().
+  void on_measurement_(int channel, float value);
+  void process_queue_();
+  // u: control inputs (control_.size() values), read when the sample was taken.
+  void filter_step_(uint32_t t_ms, const float *z, const bool *mask, const float *u);
+  void read_control_(float *u);
+  void apply_control_(const float *u, float dt_s);
+  void publish_filtered_state_();
+  void publish_filtered_state_(const float *x, const float *P);
+  void publish_psychro_(const float *x, const float *P, uint32_t now_ms);
+  // Publishes value unless publish gating holds it back (slot indexes the gating arrays);
+  // s may be null to only run the gate. Returns true if the value was due.
+  bool publish_gated_(sensor::Sensor *s, int slot, float value, float sigma, uint32_t now_ms);
+  void publish_em_diagnostics_(const float *q_diag, const float *r_diag);
+  void publish_gate_diagnostics_();
+  // Adaptive interval: whether this poll steps the filter (readings z/mask taken at now_ms).
+  bool adaptive_step_due_(uint32_t now_ms, const float *z, const bool *mask);
+  // Copies the filter outputs; with worker_task, the newest snapshot published by the worker.
+  void get_estimate_(HpUkfEstimate &est);
+  bool load_saved_state_();
+  void save_state_();
+#ifdef USE_HP_UKF_STATS
+  void report_stats_();
+#endif
+#ifdef USE_HP_UKF_WORKER
+  static void worker_entry_(void *arg);
+  void worker_run_();
+#endif
+
   sensor::Sensor *inlet_temperature_{nullptr};
   sensor::Sensor *inlet_humidity_{nullptr};
   sensor::Sensor *outlet_temperature_{nullptr};
   sensor::Sensor *outlet_humidity_{nullptr};
-  bool track_derivatives_{true};
+  static constexpr bool TRACK_DERIVATIVES = HpUkfFilter::N >= 8;
+  FilterMode filter_mode_{FILTER_MODE_UKF};
+  bool fused_predict_update_{false};
+  bool sequential_update_{false};
+  bool event_driven_{false};
+  bool measurement_queue_{false};
+  uint32_t queue_window_ms_{2000};
+  uint32_t inlet_delay_ms_{0};
+  uint32_t outlet_delay_ms_{0};
+
+  // Publish gating: per filtered state and derived output, the last published value and time.
+  static constexpr int GATED_OUTPUTS = HpUkfFilter::N + PSYCHRO_OUTPUT_COUNT;
+  float publish_sigma_{0.0f};
+  uint32_t publish_max_interval_ms_{60000};
+  uint32_t em_publish_interval_ms_{0};
+  float last_published_[GATED_OUTPUTS]{};
+  uint32_t last_publish_ms_[GATED_OUTPUTS]{};
+  bool published_[GATED_OUTPUTS]{};
+  uint32_t em_published_ms_{0};
+  bool em_published_{false};
+
+  // Warm start: snapshot saved every state_save_interval and on safe shutdown.
+  static constexpr uint32_t SAVED_STATE_VERSION = 1;
+  static constexpr uint32_t SAVED_STATE_TAG = (SAVED_STATE_VERSION << 16) | (HpUkfFilter::N << 8) | HpUkfFilter::M;
+  bool restore_state_{false};
+  uint32_t state_save_interval_ms_{900000};
+  ESPPreferenceObject state_pref_;
 
   sensor::Sensor *filtered_inlet_temperature_{nullptr};
   sensor::Sensor *filtered_inlet_humidity_{nullptr};
@@ -77,6 +248,12 @@ class HpUkfComponent : public PollingComponent {
   sensor::Sensor *filtered_inlet_humidity_derivative_{nullptr};
   sensor::Sensor *filtered_outlet_humidity_derivative_{nullptr};
 
+  // Derived moist-air outputs (dew point, absolute humidity, enthalpy) at pressure_hpa_.
+  sensor::Sensor *psychro_sensors_[PSYCHRO_OUTPUT_COUNT]{};
+  sensor::Sensor *enthalpy_delta_std_dev_{nullptr};
+  float pressure_hpa_{1013.25f};
+  bool has_psychro_{false};
+
   bool em_autotune_{false};
   float em_lambda_q_{0.995f};
   float em_lambda_r_inlet_{0.998f};
@@ -99,9 +276,70 @@ class HpUkfComponent : public PollingComponent {
   sensor::Sensor *em_lambda_r_inlet_sensor_{nullptr};
   sensor::Sensor *em_lambda_r_outlet_sensor_{nullptr};
 
+  float gate_sigma_{0.0f};
+  uint16_t gate_max_rejections_{5};
+  float gate_divergence_nis_{0.0f};
+  sensor::Sensor *rejected_measurements_{nullptr};
+  sensor::Sensor *filter_resets_{nullptr};
+
+  bool adaptive_{false};
+  HpUkfAdaptiveScheduler<HpUkfFilter::N> scheduler_;
+  sensor::Sensor *step_interval_{nullptr};
+  uint32_t step_interval_published_{0};
+
   HpUkfFilter filter_;
-  uint32_t last_update_ms_{0};
+  uint32_t last_update_ms_{0};  // time the filter state refers to
+
+  HpUkfControlModel control_;
+  HpUkfControlModel::State control_state_;
+  sensor::Sensor *control_sensors_[HpUkfControlModel::MAX_INPUTS]{};
+
+  // Measurement queue: pending samples, replay history and the checkpoint of filter_ and
+  // control_state_.
+  static constexpr int QUEUE_SIZE = 16;
+  MeasurementQueue<HpUkfFilter, HpUkfControlModel::State, QUEUE_SIZE> queue_;
+  uint32_t queue_dropped_logged_{0};
+  uint32_t sr_downdate_failures_{0};
+  // Gate counters as last seen after a filter step (written by the worker with worker_task, read
+  // by update(), hence atomic) and as last published.
+  std::atomic<uint32_t> gate_rejected_{0};
+  std::atomic<uint32_t> gate_resets_{0};
+  uint32_t gate_rejected_published_{0};
+  uint32_t gate_resets_published_{0};
+  bool gate_published_{false};
   bool initialized_{false};
+
+#ifdef USE_HP_UKF_WORKER
+  // worker_task: update() queues samples for the worker task, which owns filter_ after setup()
+  // and hands back an HpUkfEstimate per batch; loop() publishes it.
+  struct WorkerSample {
+    uint32_t t_ms;
+    float z[HpUkfFilter::M];
+    bool mask[HpUkfFilter::M];
+    float u[HpUkfControlModel::MAX_INPUTS];
+  };
+  static constexpr uint32_t WORKER_STACK_SIZE = 4096;
+  bool worker_task_{false};
+  int worker_core_{1};
+  int worker_priority_{1};
+  WorkerThread worker_;
+  SpscRing<WorkerSample, 8> worker_samples_;
+  SpscSnapshot<HpUkfEstimate> worker_estimates_;
+  uint32_t worker_dropped_{0};
+  uint32_t worker_dropped_logged_{0};
+#endif
+
+#ifdef USE_HP_UKF_STATS
+  HpUkfStats stats_;
+  uint32_t stats_interval_ms_{60000};
+  uint32_t stats_reported_ms_{0};
+  sensor::Sensor *stats_step_time_mean_{nullptr};
+  sensor::Sensor *stats_step_time_max_{nullptr};
+  sensor::Sensor *stats_step_cycles_max_{nullptr};
+  sensor::Sensor *stats_nan_events_{nullptr};
+  sensor::Sensor *stats_clamp_events_{nullptr};
+  sensor::Sensor *stats_heap_min_free_{nullptr};
+#endif
 };
 
 }  // namespace hp_ukf
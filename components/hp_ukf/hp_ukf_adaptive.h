@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace hp_ukf {
+
+// Adaptive step interval (`adaptive_interval:`). The component still polls at update_interval
+// but only steps the filter when the current interval has passed, or at once when a reading
+// surprises the estimate. Each step decides the next interval from the newest estimate:
+//   active: |dT_out| or |dRH_out| above its threshold, or a reading outside innovation_sigma
+//           -> min_interval
+//   quiet:  the interval doubles, up to max_interval
+// A reading is outside when (z_c - x_c)^2 > innovation_sigma^2 * (P_cc + R_cc). Every poll checks
+// this (no filter math), so a change is caught one poll after it shows up. The rate states
+// are not extrapolated and P is not propagated over the gap: with the default Q that would
+// widen the test so much during a long interval that a ramp passes as quiet.
+template<int N> class HpUkfAdaptiveScheduler {
+ public:
+  static constexpr int M = 4;
+
+  void configure(uint32_t min_ms, uint32_t max_ms, float temperature_rate, float humidity_rate,
+                 float innovation_sigma) {
+    min_ms_ = min_ms > 0 ? min_ms : 1;
+    max_ms_ = max_ms > min_ms_ ? max_ms : min_ms_;
+    rate_t_ = temperature_rate;
+    rate_rh_ = humidity_rate;
+    nis_ = innovation_sigma * innovation_sigma;
+    interval_ms_ = min_ms_;
+  }
+
+  // Estimate (x, packed P, R diagonal) and the current readings; true when this poll should step
+  // the filter. now_ms is then taken as the step time.
+  bool due(uint32_t now_ms, const float *x, const float *P, const float *r_diag, const float *z, const bool *mask) {
+    if (!started_) {
+      started_ = true;
+      step_ms_ = now_ms;
+      return true;
+    }
+    uint32_t elapsed_ms = now_ms - step_ms_;
+    bool surprise = false;
+    for (int c = 0; c < M && !surprise; c++) {
+      if (!mask[c])
+        continue;
+      float innov = z[c] - x[c];
+      surprise = innov * innov > nis_ * (P[packed_index(c, c)] + r_diag[c]);
+    }
+    bool fast = false;
+    if constexpr (N >= 8)
+      fast = std::fabs(x[5]) > rate_t_ || std::fabs(x[7]) > rate_rh_;
+    if (surprise || fast)
+      interval_ms_ = min_ms_;
+    if (!surprise && elapsed_ms < interval_ms_)
+      return false;
+    if (!surprise && !fast)
+      interval_ms_ = interval_ms_ > max_ms_ / 2 ? max_ms_ : interval_ms_ * 2;
+    step_ms_ = now_ms;
+    if (surprise)
+      surprises_++;
+    return true;
+  }
+
+  // Q multiplier for a step of dt seconds (Q is tuned per min_interval).
+  float process_noise_scale(float dt) const { return dt * 1000.0f / (float) min_ms_; }
+  uint32_t get_interval() const { return interval_ms_; }
+  uint32_t get_min_interval() const { return min_ms_; }
+  uint32_t get_max_interval() const { return max_ms_; }
+  // Steps started early by a reading outside innovation_sigma.
+  uint32_t get_surprises() const { return surprises_; }
+
+ protected:
+  static constexpr int packed_index(int i, int j) {
+    return i <= j ? i * N - i * (i - 1) / 2 + (j - i) : j * N - j * (j - 1) / 2 + (i - j);
+  }
+
+  uint32_t min_ms_{1000};
+  uint32_t max_ms_{30000};
+  uint32_t interval_ms_{1000};
+  uint32_t step_ms_{0};
+  uint32_t surprises_{0};
+  float rate_t_{0.01f};
+  float rate_rh_{0.02f};
+  float nis_{9.0f};
+  bool started_{false};
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
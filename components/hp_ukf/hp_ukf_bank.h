@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include "hp_ukf_ukf.h"
+
+namespace esphome {
+namespace hp_ukf {
+
+// K independent heat-pump filters stepped together (`units:` in YAML).
+// Runs the linear Kalman filter of FILTER_MODE_LINEAR_KF (per-channel position/rate 2x2 blocks,
+// scalar update per measured channel) in structure-of-arrays layout: every quantity is a
+// [channel][unit] array, and all inner loops run over the K units with no branches or
+// indexing between them, so the compiler can vectorize them (a missing sample is a zero
+// weight, not a skip). Header-only because K is set per configuration (HP_UKF_BANK_UNITS).
+template<int K, int NX, int NZ = 4> class HpUkfFilterBank {
+  static_assert(K >= 1, "filter bank needs at least one unit");
+  static_assert(NX == 4 || NX == 8, "HP-UKF state dimension must be 4 or 8");
+  static_assert(NZ == 4, "HP-UKF measures exactly T_in, RH_in, T_out, RH_out");
+
+ public:
+  static constexpr int UNITS = K;
+  static constexpr int N = NX;
+  static constexpr int M = NZ;
+
+  // x = 0, P = I, default Q/R (DEFAULT_Q_DIAG, DEFAULT_R_DIAG) for every unit.
+  HpUkfFilterBank() {
+    for (int c = 0; c < M; c++) {
+      for (int k = 0; k < K; k++) {
+        ppp_[c][k] = 1.0f;
+        prr_[c][k] = 1.0f;
+        q_level_[c][k] = DEFAULT_Q_DIAG[c];
+        q_rate_[c][k] = DEFAULT_Q_DIAG[RATE_INDEX[c]];
+        r_[c][k] = DEFAULT_R_DIAG[c];
+      }
+    }
+  }
+
+  // Per unit, full N x N P (row-major); only the per-channel block terms are kept.
+  void set_initial_state(int unit, const float *x, const float *P) {
+    for (int c = 0; c < M; c++) {
+      level_[c][unit] = x[c];
+      ppp_[c][unit] = P[c * N + c];
+      if constexpr (N >= 8) {
+        int r = RATE_INDEX[c];
+        rate_[c][unit] = x[r];
+        ppr_[c][unit] = P[c * N + r];
+        prr_[c][unit] = P[r * N + r];
+      }
+    }
+  }
+
+  // Per unit, diagonals in state order (q, N entries) and measurement order (r, M entries).
+  void set_process_noise_diag(int unit, const float *q) {
+    for (int c = 0; c < M; c++) {
+      q_level_[c][unit] = q[c];
+      if constexpr (N >= 8)
+        q_rate_[c][unit] = q[RATE_INDEX[c]];
+    }
+  }
+  void set_measurement_noise_diag(int unit, const float *r) {
+    for (int c = 0; c < M; c++)
+      r_[c][unit] = r[c];
+  }
+
+  // Same dt for all units (one scheduler tick).
+  void predict(float dt) {
+    for (int c = 0; c < M; c++) {
+      if constexpr (N < 8) {
+        for (int k = 0; k < K; k++)
+          ppp_[c][k] += q_level_[c][k];
+        continue;
+      }
+      // P = F*P*F' + Q with F = [1 dt; 0 1] on each block.
+      for (int k = 0; k < K; k++) {
+        level_[c][k] += rate_[c][k] * dt;
+        ppp_[c][k] += dt * (2.0f * ppr_[c][k] + dt * prr_[c][k]) + q_level_[c][k];
+        ppr_[c][k] += dt * prr_[c][k];
+        prr_[c][k] += q_rate_[c][k];
+      }
+    }
+  }
+
+  // z and mask are [channel][unit] (z[c * K + k]); mask is 0/1 bytes (a bool load keeps GCC
+  // from vectorizing the loop) and masked entries of z must be finite (0).
+  // Closed form of the Joseph update on each block: Ppp' = kp*R, Ppr' = kr*R,
+  // Prr' = Prr - kr*Ppr. The mask enters as a 0/1 weight instead of a branch: a masked unit
+  // gets zero gains and keeps its prior exactly (kp*R + (1-w)*Ppp adds an exact zero).
+  void update(const float *z, const uint8_t *mask) {
+    for (int c = 0; c < M; c++) {
+      for (int k = 0; k < K; k++) {
+        float w = mask[c * K + k];
+        float p = ppp_[c][k];
+        float g = w / (p + r_[c][k]);
+        float innov = w * (z[c * K + k] - level_[c][k]);
+        float kp = p * g;
+        level_[c][k] += kp * innov;
+        ppp_[c][k] = kp * r_[c][k] + (1.0f - w) * p;
+        if constexpr (N >= 8) {
+          float pr = ppr_[c][k];
+          float kr = pr * g;
+          rate_[c][k] += kr * innov;
+          prr_[c][k] -= kr * pr;
+          ppr_[c][k] = kr * r_[c][k] + (1.0f - w) * pr;
+        }
+      }
+    }
+  }
+
+  // State i in HpUkfFilterT order (T_in, RH_in, T_out, RH_out, dT_in, dT_out, dRH_in, dRH_out).
+  float get_state(int unit, int i) const {
+    return i < M ? level_[i][unit] : rate_[RATE_CHANNEL[i - M]][unit];
+  }
+  float get_variance(int unit, int i) const {
+    return i < M ? ppp_[i][unit] : prr_[RATE_CHANNEL[i - M]][unit];
+  }
+
+ private:
+  static constexpr int RATE_INDEX[M] = {4, 6, 5, 7};
+  static constexpr int RATE_CHANNEL[M] = {0, 2, 1, 3};  // inverse of RATE_INDEX
+
+  alignas(16) float level_[M][K]{};
+  alignas(16) float rate_[M][K]{};
+  alignas(16) float ppp_[M][K]{};
+  alignas(16) float ppr_[M][K]{};
+  alignas(16) float prr_[M][K]{};
+  alignas(16) float q_level_[M][K]{};
+  alignas(16) float q_rate_[M][K]{};
+  alignas(16) float r_[M][K]{};
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
@@ -0,0 +1,87 @@
+#include "hp_ukf_bank_component.h"
+
+#ifdef HP_UKF_BANK_UNITS
+
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cmath>
+
+namespace esphome {
+namespace hp_ukf {
+
+static const char *const TAG = "hp_ukf.bank";
+
+void HpUkfBankComponent::setup() {
+  ESP_LOGCONFIG(TAG, "Setting up HP-UKF filter bank (%d units)", K);
+  for (int k = 0; k < K; k++) {
+    float x0[N] = {20.0f, 50.0f, 20.0f, 50.0f};  // rates (if any) start at zero
+    for (int c = 0; c < M; c++) {
+      sensor::Sensor *s = inputs_[c][k];
+      if (s != nullptr && s->has_state() && !std::isnan(s->get_state()))
+        x0[c] = s->get_state();
+    }
+    float P0[N * N] = {};
+    for (int i = 0; i < N; i++)
+      P0[i * N + i] = 1.0f;
+    bank_.set_initial_state(k, x0, P0);
+  }
+  this->publish_state_();
+  last_update_ms_ = millis();
+}
+
+// Same dt and clamp as HpUkfComponent::filter_step_(); a unit whose sensor has no value gets a
+// zero-weight update for that channel.
+void HpUkfBankComponent::update() {
+  float z[M * K];
+  uint8_t mask[M * K];
+  for (int c = 0; c < M; c++) {
+    for (int k = 0; k < K; k++) {
+      sensor::Sensor *s = inputs_[c][k];
+      float v = (s != nullptr && s->has_state()) ? s->get_state() : NAN;
+      bool have = std::isfinite(v);
+      z[c * K + k] = have ? v : 0.0f;
+      mask[c * K + k] = have ? 1 : 0;
+    }
+  }
+
+  uint32_t now_ms = millis();
+  uint32_t t0_us = micros();
+  int32_t elapsed_ms = static_cast<int32_t>(now_ms - last_update_ms_);
+  if (elapsed_ms > 0) {
+    float dt_s = std::max(1e-6f, std::min(elapsed_ms / 1000.0f, 3600.0f));
+    bank_.predict(dt_s);
+    last_update_ms_ = now_ms;
+  }
+  bank_.update(z, mask);
+  ESP_LOGV(TAG, "step: %d units in %u us", K, (unsigned) (micros() - t0_us));
+  this->publish_state_();
+}
+
+void HpUkfBankComponent::publish_state_() {
+  for (int i = 0; i < N; i++) {
+    for (int k = 0; k < K; k++) {
+      float v = bank_.get_state(k, i);
+      if (filtered_[i][k] != nullptr && std::isfinite(v))
+        filtered_[i][k]->publish_state(v);
+    }
+  }
+}
+
+void HpUkfBankComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "HP-UKF filter bank");
+  LOG_UPDATE_INTERVAL(this);
+  ESP_LOGCONFIG(TAG, "  Units: %d, state dimension %d, linear KF", K, N);
+  for (int k = 0; k < K; k++) {
+    int inputs = 0, outputs = 0;
+    for (int c = 0; c < M; c++)
+      inputs += inputs_[c][k] != nullptr ? 1 : 0;
+    for (int i = 0; i < N; i++)
+      outputs += filtered_[i][k] != nullptr ? 1 : 0;
+    ESP_LOGCONFIG(TAG, "  Unit %d: %d input sensor(s), %d filtered sensor(s)", k, inputs, outputs);
+  }
+}
+
+}  // namespace hp_ukf
+}  // namespace esphome
+
+#endif  // HP_UKF_BANK_UNITS
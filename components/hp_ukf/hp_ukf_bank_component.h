@@ -0,0 +1,44 @@
+#pragma once
+
+#include "hp_ukf.h"
+#include "hp_ukf_bank.h"
+
+// Only built when __init__.py configures `units:` (emits the unit count).
+#ifdef HP_UKF_BANK_UNITS
+
+namespace esphome {
+namespace hp_ukf {
+
+using HpUkfBank = HpUkfFilterBank<HP_UKF_BANK_UNITS, HP_UKF_STATE_DIM>;
+
+// One polling component for several heat pumps (`units:`): reads all units' sensors, steps the
+// whole bank once per update_interval and publishes every unit's filtered outputs.
+class HpUkfBankComponent : public PollingComponent {
+ public:
+  static constexpr int K = HpUkfBank::UNITS;
+  static constexpr int N = HpUkfBank::N;
+  static constexpr int M = HpUkfBank::M;
+
+  void setup() override;
+  void update() override;
+  void dump_config() override;
+
+  float get_setup_priority() const override { return setup_priority::DATA; }
+
+  // channel: T_in, RH_in, T_out, RH_out; index: state order of HpUkfFilterT.
+  void set_input_sensor(int unit, int channel, sensor::Sensor *s) { inputs_[channel][unit] = s; }
+  void set_filtered_sensor(int unit, int index, sensor::Sensor *s) { filtered_[index][unit] = s; }
+
+ protected:
+  void publish_state_();
+
+  HpUkfBank bank_;
+  sensor::Sensor *inputs_[M][K]{};
+  sensor::Sensor *filtered_[N][K]{};
+  uint32_t last_update_ms_{0};
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
+
+#endif  // HP_UKF_BANK_UNITS
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cmath>
+
+namespace esphome {
+namespace hp_ukf {
+
+// Control-input feed-forward for predict (`control:`). Each input u_j (compressor frequency,
+// mode, fan stage, ...) maps to an equilibrium offset g_j(u_j) of the outlet levels
+// [T_out °C, RH_out %]: linear (gain * u) or a piecewise-linear table, clamped at its ends.
+// When the summed offset changes by dg, the outlet is assumed to settle at the new equilibrium
+// with time constant tau: a feed-forward rate f jumps by dg / tau and then decays
+// (backward Euler, f *= tau / (tau + dt), so its integral is ~dg). The filter receives f as a
+// known input; P is not touched.
+class HpUkfControlModel {
+ public:
+  static constexpr int MAX_INPUTS = 4;
+  static constexpr int MAX_POINTS = 8;
+
+  // Per-filter dynamic part, kept apart from the configuration so the measurement queue can
+  // checkpoint and roll it back together with the filter.
+  struct State {
+    float ff[2]{};  // feed-forward rate on T_out, RH_out
+    float g_prev[MAX_INPUTS][2]{};
+    bool seen[MAX_INPUTS]{};
+  };
+
+  int size() const { return count_; }
+  void set_time_constant(float tau_s) { tau_s_ = tau_s > 1e-3f ? tau_s : 1e-3f; }
+  float get_time_constant() const { return tau_s_; }
+
+  // Returns the input index, or -1 when MAX_INPUTS are in use.
+  int add_linear_input(float gain_t_out, float gain_rh_out) {
+    if (count_ >= MAX_INPUTS)
+      return -1;
+    Input &in = inputs_[count_];
+    in.gain[0] = gain_t_out;
+    in.gain[1] = gain_rh_out;
+    in.points = 0;
+    return count_++;
+  }
+  // Points must be added in increasing u; from the first point on the input is table-driven.
+  bool add_table_point(int input, float u, float t_out, float rh_out) {
+    if (input < 0 || input >= count_ || inputs_[input].points >= MAX_POINTS)
+      return false;
+    Input &in = inputs_[input];
+    in.u[in.points] = u;
+    in.g[in.points][0] = t_out;
+    in.g[in.points][1] = rh_out;
+    in.points++;
+    return true;
+  }
+
+  // Equilibrium offset [T_out, RH_out] of input j at value u.
+  void offset(int j, float u, float *g) const {
+    const Input &in = inputs_[j];
+    if (in.points == 0) {
+      g[0] = in.gain[0] * u;
+      g[1] = in.gain[1] * u;
+      return;
+    }
+    int last = in.points - 1;
+    if (in.points == 1 || u <= in.u[0] || u >= in.u[last]) {
+      int k = (in.points == 1 || u <= in.u[0]) ? 0 : last;
+      g[0] = in.g[k][0];
+      g[1] = in.g[k][1];
+      return;
+    }
+    int k = 0;
+    while (u > in.u[k + 1])
+      k++;
+    float span = in.u[k + 1] - in.u[k];
+    float f = span > 0.0f ? (u - in.u[k]) / span : 0.0f;
+    for (int c = 0; c < 2; c++)
+      g[c] = in.g[k][c] + f * (in.g[k + 1][c] - in.g[k][c]);
+  }
+
+  // One predict step of dt seconds with inputs u[size()] (NaN holds an input's last value; its
+  // first value sets the baseline without a kick). d_rate: change of the feed-forward rate, to
+  // add to the outlet rate states; d_level: f * dt, to add to the outlet levels when there are
+  // no rate states.
+  void step(State &st, const float *u, float dt, float *d_rate, float *d_level) const {
+    float dg[2] = {0.0f, 0.0f};
+    for (int j = 0; j < count_; j++) {
+      if (!std::isfinite(u[j]))
+        continue;
+      float g[2];
+      offset(j, u[j], g);
+      if (!st.seen[j]) {
+        st.seen[j] = true;
+        st.g_prev[j][0] = g[0];
+        st.g_prev[j][1] = g[1];
+      }
+      for (int c = 0; c < 2; c++) {
+        dg[c] += g[c] - st.g_prev[j][c];
+        st.g_prev[j][c] = g[c];
+      }
+    }
+    float decay = tau_s_ / (tau_s_ + dt);
+    for (int c = 0; c < 2; c++) {
+      float f = (st.ff[c] + dg[c] / tau_s_) * decay;
+      d_rate[c] = f - st.ff[c];
+      d_level[c] = f * dt;
+      st.ff[c] = f;
+    }
+  }
+
+ protected:
+  struct Input {
+    float gain[2];
+    int points;
+    float u[MAX_POINTS];
+    float g[MAX_POINTS][2];
+  };
+  Input inputs_[MAX_INPUTS]{};
+  int count_{0};
+  float tau_s_{60.0f};
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
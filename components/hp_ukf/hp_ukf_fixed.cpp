@@ -0,0 +1,230 @@
+#include "hp_ukf_fixed.h"
+#include <algorithm>
+#include <cmath>
+
+namespace esphome {
+namespace hp_ukf {
+
+static constexpr float LEVEL_ONE = static_cast<float>(1L << 16);  // Q16.16
+static constexpr float COV_ONE = static_cast<float>(1L << 24);    // Q8.24
+
+static int32_t sat32(int64_t v) {
+  if (v > INT32_MAX)
+    return INT32_MAX;
+  if (v < INT32_MIN)
+    return INT32_MIN;
+  return static_cast<int32_t>(v);
+}
+
+static int32_t to_fixed(float v, float one) {
+  float s = v * one;
+  if (!(s < 2147483520.0f))  // also catches NaN
+    return s > 0.0f ? INT32_MAX : 0;
+  if (s < -2147483520.0f)
+    return INT32_MIN;
+  return static_cast<int32_t>(std::lround(s));
+}
+
+template<int NX, int NZ> HpUkfFixedFilterT<NX, NZ>::HpUkfFixedFilterT() {
+  for (int c = 0; c < M; c++) {
+    q_level_[c] = to_fixed(DEFAULT_Q_DIAG[c], COV_ONE);
+    if constexpr (N >= 8)
+      q_rate_[c] = to_fixed(DEFAULT_Q_DIAG[RATE_INDEX[c]], COV_ONE);
+    r_[c] = to_fixed(DEFAULT_R_DIAG[c], COV_ONE);
+  }
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::set_state(const float *x) {
+  for (int c = 0; c < M; c++) {
+    x_level_[c] = to_fixed(x[c], LEVEL_ONE);
+    if constexpr (N >= 8)
+      x_rate_[c] = to_fixed(x[RATE_INDEX[c]], COV_ONE);
+  }
+  refresh_state_mirror();
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::set_covariance(const float *P) {
+  for (int c = 0; c < M; c++) {
+    store(Ppp_[c], e_pp_[c], to_fixed(P[c * N + c], COV_ONE), 0);
+    if constexpr (N >= 8) {
+      int r = RATE_INDEX[c];
+      store(Ppr_[c], e_pr_[c], to_fixed(P[c * N + r], COV_ONE), 0);
+      store(Prr_[c], e_rr_[c], to_fixed(P[r * N + r], COV_ONE), 0);
+    }
+  }
+  p_stale_ = true;
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::set_initial_state(const float *x, const float *P) {
+  set_state(x);
+  set_covariance(P);
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::store(int32_t &m, int8_t &e, int64_t v, int exp) {
+  constexpr int64_t HI = int64_t(1) << 30;
+  constexpr int64_t LO = int64_t(1) << 29;
+  int64_t mag = v < 0 ? -v : v;
+  while (mag >= HI && exp < P_EXP_MAX) {
+    v >>= 1;
+    mag >>= 1;
+    exp++;
+  }
+  while (exp > 0 && mag < LO) {
+    v <<= 1;
+    mag <<= 1;
+    exp--;
+  }
+  // Exponent at its limit (decades without a measurement): hold the variance there.
+  m = static_cast<int32_t>(std::max(-(HI - 1), std::min(v, HI - 1)));
+  e = static_cast<int8_t>(exp);
+}
+
+// v given at exponent from, brought to exponent to >= from (low bits dropped).
+static int64_t align(int64_t v, int from, int to) { return to - from < 63 ? v >> (to - from) : (v < 0 ? -1 : 0); }
+
+// (a * b) >> s with |b| < 2^31; a is pre-shifted when large so the product cannot overflow.
+static int64_t mul_shift(int64_t a, int64_t b, int s) {
+  while (s > 0 && (a >= (int64_t(1) << 32) || a <= -(int64_t(1) << 32))) {
+    a >>= 1;
+    s--;
+  }
+  return (a * b) >> s;
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::set_process_noise_scale(float scale) {
+  q_scale_ = to_fixed(scale, LEVEL_ONE);
+}
+
+// P = F*P*F' + Q per block with F = [1 dt; 0 1]; dt in Q16.16 seconds. Each sum is formed at
+// the larger exponent of its terms (Q values at exponent 0, scaled by q_scale_).
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::predict(float dt) {
+  int64_t dt_q = to_fixed(dt, LEVEL_ONE);
+  for (int c = 0; c < M; c++) {
+    int e_pp = e_pp_[c];
+    int64_t q_level = mul_shift(q_level_[c], q_scale_, FRAC_LEVEL);
+    if constexpr (N >= 8) {
+      x_level_[c] = sat32(x_level_[c] + ((x_rate_[c] * dt_q) >> FRAC_COV));
+      int e_pr = e_pr_[c], e_rr = e_rr_[c];
+      int64_t dt_prr = (static_cast<int64_t>(Prr_[c]) * dt_q) >> FRAC_LEVEL;  // at e_rr
+      int e_in = std::max(e_pr, e_rr);
+      int64_t inner = align(2 * static_cast<int64_t>(Ppr_[c]), e_pr, e_in) + align(dt_prr, e_rr, e_in);
+      int64_t dt_inner = mul_shift(inner, dt_q, FRAC_LEVEL);
+      int e = std::max(e_pp, e_in);
+      int64_t ppp = align(Ppp_[c], e_pp, e) + align(dt_inner, e_in, e) + align(q_level, 0, e);
+      int64_t q_rate = mul_shift(q_rate_[c], q_scale_, FRAC_LEVEL);
+      int64_t prr = Prr_[c] + align(q_rate, 0, e_rr);
+      // Ppr + dt*Prr at e_in; Ppp and Prr use the old block.
+      int64_t ppr = align(Ppr_[c], e_pr, e_in) + align(dt_prr, e_rr, e_in);
+      store(Ppp_[c], e_pp_[c], ppp, e);
+      store(Ppr_[c], e_pr_[c], ppr, e_in);
+      store(Prr_[c], e_rr_[c], prr, e_rr);
+    } else {
+      store(Ppp_[c], e_pp_[c], Ppp_[c] + align(q_level, 0, e_pp), e_pp);
+    }
+  }
+  refresh_state_mirror();
+  p_stale_ = true;
+}
+
+// Scalar update per channel, closed form of the Joseph update on the block (as update_linear):
+// Ppp' = kp*R, Ppr' = kr*R, Prr' = Prr - kr*Ppr. Gains are scale free (Q8.24); Ppp' and Ppr'
+// are renormalized from exponent 0.
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::update(const float *z, const bool *mask) {
+  for (int c = 0; c < M; c++) {
+    if (!mask[c])
+      continue;
+    int e_pp = e_pp_[c];
+    int64_t innov = sat32(static_cast<int64_t>(to_fixed(z[c], LEVEL_ONE)) - x_level_[c]);
+    int64_t s = static_cast<int64_t>(Ppp_[c]) + align(r_[c], 0, e_pp);  // at e_pp
+    if (s <= 0)
+      continue;
+    int64_t kp = (static_cast<int64_t>(Ppp_[c]) << FRAC_COV) / s;
+    x_level_[c] = sat32(x_level_[c] + ((kp * innov) >> FRAC_COV));
+    store(Ppp_[c], e_pp_[c], (kp * r_[c]) >> FRAC_COV, 0);
+    if constexpr (N >= 8) {
+      // kr = Ppr / s = (m_pr / m_s) * 2^(e_pr - e_pp).
+      int e_pr = e_pr_[c], e_rr = e_rr_[c];
+      int64_t kr = (static_cast<int64_t>(Ppr_[c]) << FRAC_COV) / s;
+      int d = e_pr - e_pp;
+      if (d < 0)
+        kr = align(kr, 0, -d);
+      else if (d > 0)
+        kr = (d < 31 && (kr < 0 ? -kr : kr) < (int64_t(1) << (62 - d))) ? kr << d : (kr < 0 ? INT32_MIN : INT32_MAX);
+      kr = sat32(kr);
+      x_rate_[c] = sat32(x_rate_[c] + ((kr * innov) >> FRAC_LEVEL));
+      int64_t kr_ppr = (kr * Ppr_[c]) >> FRAC_COV;  // at e_pr
+      int e = std::max(e_rr, e_pr);
+      int64_t prr = std::max<int64_t>(align(Prr_[c], e_rr, e) - align(kr_ppr, e_pr, e), 0);
+      store(Prr_[c], e_rr_[c], prr, e);
+      store(Ppr_[c], e_pr_[c], (kr * r_[c]) >> FRAC_COV, 0);
+    }
+  }
+  refresh_state_mirror();
+  p_stale_ = true;
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::refresh_state_mirror() {
+  for (int c = 0; c < M; c++) {
+    x_f_[c] = x_level_[c] / LEVEL_ONE;
+    if constexpr (N >= 8)
+      x_f_[RATE_INDEX[c]] = x_rate_[c] / COV_ONE;
+  }
+}
+
+template<int NX, int NZ> const float *HpUkfFixedFilterT<NX, NZ>::get_covariance_packed() const {
+  if (p_stale_) {
+    for (int i = 0; i < N_PACKED; i++)
+      P_f_[i] = 0.0f;
+    for (int c = 0; c < M; c++) {
+      P_f_[packed_index(c, c)] = std::ldexp(static_cast<float>(Ppp_[c]), e_pp_[c] - FRAC_COV);
+      if constexpr (N >= 8) {
+        int r = RATE_INDEX[c];
+        P_f_[packed_index(c, r)] = std::ldexp(static_cast<float>(Ppr_[c]), e_pr_[c] - FRAC_COV);
+        P_f_[packed_index(r, r)] = std::ldexp(static_cast<float>(Prr_[c]), e_rr_[c] - FRAC_COV);
+      }
+    }
+    p_stale_ = false;
+  }
+  return P_f_;
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::get_covariance(float *P) const {
+  const float *Pp = get_covariance_packed();
+  for (int i = 0; i < N; i++)
+    for (int j = 0; j < N; j++)
+      P[i * N + j] = Pp[packed_index(i, j)];
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::set_process_noise(const float *Q) {
+  for (int c = 0; c < M; c++) {
+    q_level_[c] = to_fixed(Q[c * N + c], COV_ONE);
+    if constexpr (N >= 8) {
+      int r = RATE_INDEX[c];
+      q_rate_[c] = to_fixed(Q[r * N + r], COV_ONE);
+    }
+  }
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::set_measurement_noise(const float *R) {
+  for (int c = 0; c < M; c++)
+    r_[c] = to_fixed(R[c * M + c], COV_ONE);
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::get_process_noise_diag(float *q_diag) const {
+  for (int c = 0; c < M; c++) {
+    q_diag[c] = q_level_[c] / COV_ONE;
+    if constexpr (N >= 8)
+      q_diag[RATE_INDEX[c]] = q_rate_[c] / COV_ONE;
+  }
+}
+
+template<int NX, int NZ> void HpUkfFixedFilterT<NX, NZ>::get_measurement_noise_diag(float *r_diag) const {
+  for (int c = 0; c < M; c++)
+    r_diag[c] = r_[c] / COV_ONE;
+}
+
+template class HpUkfFixedFilterT<4>;
+template class HpUkfFixedFilterT<8>;
+
+}  // namespace hp_ukf
+}  // namespace esphome
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include "hp_ukf_ukf.h"
+
+namespace esphome {
+namespace hp_ukf {
+
+// Fixed-point backend for FPU-less targets (ESP8266), selected with `numeric: fixed`.
+// Runs the exact linear Kalman filter of FILTER_MODE_LINEAR_KF (per-channel position/rate 2x2
+// blocks, scalar update per measured channel) in integer arithmetic:
+//   levels (T, RH)     Q16.16  int32  (range +-32768, resolution 1.5e-5)
+//   rates, Q, R, gain  Q8.24   int32  (range +-128, resolution 6e-8), int64 products
+//   P blocks           int32 mantissas with an exponent per element: Q8.24 normally,
+//                      shifted right when a long gap makes a variance outgrow it (Ppp by
+//                      dt^3, Ppr by dt^2, Prr by dt), so each keeps ~29 significant bits.
+// The model is linear, so no sigma points and no Cholesky factor are needed; only two int64
+// divisions per measured channel remain. Floats appear only at the API boundary (inputs, the
+// get_state()/get_covariance_packed() mirrors and setup-time noise values).
+// Same public interface as HpUkfFilterT so HpUkfComponent can use either; filter mode,
+// sequential update, EM auto-tune and the innovation gate do not apply and are accepted as no-ops.
+template<int NX, int NZ = 4> class HpUkfFixedFilterT {
+  static_assert(NX == 4 || NX == 8, "HP-UKF state dimension must be 4 or 8");
+  static_assert(NZ == 4, "HP-UKF measures exactly T_in, RH_in, T_out, RH_out");
+
+ public:
+  static constexpr int N = NX;
+  static constexpr int M = NZ;
+  static constexpr int N_PACKED = N * (N + 1) / 2;
+  static constexpr int packed_index(int i, int j) { return HpUkfFilterT<NX, NZ>::packed_index(i, j); }
+
+  static constexpr int FRAC_LEVEL = 16;
+  static constexpr int FRAC_COV = 24;
+
+  HpUkfFixedFilterT();
+
+  static constexpr int get_state_dimension() { return N; }
+
+  void set_filter_mode(FilterMode /*mode*/) {}
+  FilterMode get_filter_mode() const { return FILTER_MODE_LINEAR_KF; }
+  void set_sequential_update(bool /*enable*/) {}
+  bool get_sequential_update() const { return true; }
+
+  // Full N x N float inputs; only the per-channel block terms are kept.
+  void set_state(const float *x);
+  void set_covariance(const float *P);
+  void set_initial_state(const float *x, const float *P);
+
+  void predict(float dt);
+  void update(const float *z, const bool *mask);
+  void predict_update(float dt, const float *z, const bool *mask) {
+    predict(dt);
+    update(z, mask);
+  }
+
+  // Float mirrors, refreshed after each step (state) or on demand (covariance).
+  const float *get_state() const { return x_f_; }
+  void get_covariance(float *P) const;
+  const float *get_covariance_packed() const;
+
+  uint32_t get_sr_downdate_failures() const { return 0; }
+
+  void set_innovation_gate(float /*sigma*/) {}
+  void set_gate_max_rejections(uint16_t /*n*/) {}
+  void set_divergence_nis(float /*nis*/) {}
+  uint32_t get_rejected_count() const { return 0; }
+  uint32_t get_reset_count() const { return 0; }
+
+  // Diagonals of the full matrices are used.
+  void set_process_noise(const float *Q);
+  void set_measurement_noise(const float *R);
+  void set_process_noise_scale(float scale);
+
+  void enable_em_autotune(bool /*enable*/) {}
+  void set_em_lambda_q(float /*v*/) {}
+  void set_em_lambda_r_inlet(float /*v*/) {}
+  void set_em_lambda_r_outlet(float /*v*/) {}
+  void set_em_inflation(float /*v*/) {}
+  bool em_autotune_enabled() const { return false; }
+
+  void get_process_noise_diag(float *q_diag) const;
+  void get_measurement_noise_diag(float *r_diag) const;
+
+ private:
+  static constexpr int RATE_INDEX[M] = {4, 6, 5, 7};
+  // Upper bound of the P exponents: keeps the int64 shifts in range and the int8 from overflowing.
+  static constexpr int P_EXP_MAX = 62;
+
+  // Per measured channel c: x_level_[c], and with rates x_rate_[c], Ppp/Ppr/Prr of its block.
+  // Block values are m * 2^(e - 24) with e from e_pp_/e_pr_/e_rr_.
+  int32_t x_level_[M]{};
+  int32_t x_rate_[M]{};
+  int32_t Ppp_[M]{};
+  int32_t Ppr_[M]{};
+  int32_t Prr_[M]{};
+  int8_t e_pp_[M]{};
+  int8_t e_pr_[M]{};
+  int8_t e_rr_[M]{};
+  int32_t q_level_[M]{};
+  int32_t q_rate_[M]{};
+  int32_t r_[M]{};
+  int32_t q_scale_{1 << FRAC_LEVEL};  // Q16.16
+
+  float x_f_[N]{};
+  mutable float P_f_[N_PACKED]{};
+  mutable bool p_stale_{true};
+
+  void refresh_state_mirror();
+  // Store an int64 value given at exponent exp, choosing the smallest exponent that fits.
+  static void store(int32_t &m, int8_t &e, int64_t v, int exp);
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
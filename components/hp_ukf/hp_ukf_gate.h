@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace hp_ukf {
+
+// Innovation gate and divergence detector for the scalar channels of HpUkfFilterT.
+// With H selecting states and diagonal R, the prior innovation of channel c has variance
+// s_c = P_cc + R_cc (the diagonal of the Pzz the update builds anyway), so its normalized
+// innovation squared NIS = innov^2 / s_c is chi-square with one degree of freedom when the
+// filter is consistent.
+//   Gate: NIS > threshold drops the channel from this update (and from EM). After
+//     max_rejections consecutive rejections on one channel the value is taken as a real step:
+//     the channel's variance is raised to cover it and it is accepted.
+//   Divergence: an EMA of the NIS of accepted values per channel (expected 1). Above
+//     divergence_nis the filter is overconfident, so P is scaled by that mean.
+// Both recoveries are soft resets: the state is kept, only P grows.
+class HpUkfInnovationGate {
+ public:
+  static constexpr int M = 4;
+  static constexpr float NIS_EMA_ALPHA = 0.05f;
+  static constexpr float MAX_SCALE = 100.0f;
+
+  // threshold = sigma^2; 0 disables the gate (and the divergence detector).
+  void set_threshold(float threshold) { threshold_ = threshold; }
+  void set_max_rejections(uint16_t n) { max_rejections_ = n; }
+  // Mean NIS that triggers a reset; 0 disables the divergence detector.
+  void set_divergence_nis(float nis) { divergence_nis_ = nis; }
+  bool enabled() const { return threshold_ > 0.0f; }
+
+  // innov[c] and s[c] (= P_cc + R_cc) for the channels set in mask. Clears mask[c] for rejected
+  // channels. Returns the factor P should be scaled by (1 = none) and fills add[c] with the
+  // variance to add to P_cc afterwards (0 = none).
+  float check(const float *innov, const float *s, bool *mask, float *add) {
+    float scale = 1.0f;
+    bool reset = false;
+    for (int c = 0; c < M; c++) {
+      add[c] = 0.0f;
+      if (!mask[c] || !(s[c] > 0.0f))
+        continue;
+      float nis = innov[c] * innov[c] / s[c];
+      if (nis > threshold_) {
+        if (++streak_[c] < max_rejections_) {
+          mask[c] = false;
+          rejected_++;
+          continue;
+        }
+        // Persistent: raise P_cc so the value lands at NIS = 1 and take it.
+        add[c] = innov[c] * innov[c] - s[c];
+        streak_[c] = 0;
+        nis_mean_[c] = 1.0f;
+        reset = true;
+        continue;
+      }
+      streak_[c] = 0;
+      nis_mean_[c] += NIS_EMA_ALPHA * (nis - nis_mean_[c]);
+      if (divergence_nis_ > 0.0f && nis_mean_[c] > divergence_nis_ && nis_mean_[c] > scale)
+        scale = nis_mean_[c];
+    }
+    if (scale > 1.0f) {
+      for (int c = 0; c < M; c++)
+        nis_mean_[c] = 1.0f;
+      reset = true;
+    }
+    if (reset)
+      resets_++;
+    return scale < MAX_SCALE ? scale : MAX_SCALE;
+  }
+
+  uint32_t get_rejected_count() const { return rejected_; }
+  uint32_t get_reset_count() const { return resets_; }
+
+ protected:
+  float threshold_{0.0f};
+  float divergence_nis_{0.0f};
+  float nis_mean_[M]{1.0f, 1.0f, 1.0f, 1.0f};
+  uint32_t rejected_{0};
+  uint32_t resets_{0};
+  uint16_t streak_[M]{};
+  uint16_t max_rejections_{5};
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
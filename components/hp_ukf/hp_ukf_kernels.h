@@ -0,0 +1,148 @@
+#pragma once
+
+#ifdef HP_UKF_KERNELS_ESP_DSP
+#include "dsps_dotprod.h"
+#endif
+
+namespace esphome {
+namespace hp_ukf {
+
+// Small dense kernels of the UKF update (sigma-point outer products, Pxz, K = Pxz*Pzz^-1, the
+// Joseph-form products). All matrices are row-major and laid out so the innermost loop runs
+// over a contiguous row: sigma-point deviations are stored one state per row, and products are
+// formed as row updates y += s*x. A backend supplies the two unit-stride primitives:
+//   dot_tail(a, b, cols)  sum of a[k]*b[k] for k = 1..cols-1 ((cols - 1) % 4 == 0), as four
+//                         interleaved partial sums combined as (s0 + s1) + (s2 + s3)
+//   axpy(s, x, y, len)    y[j] += s * x[j]
+// The scalar and vector backends perform the same operations in the same order and give the
+// same results (tools/hp_ukf_kernel_check compares them).
+
+// Reference backend.
+struct ScalarBackend {
+  static float dot_tail(const float *a, const float *b, int cols) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    for (int k = 1; k < cols; k += 4) {
+      s0 += a[k] * b[k];
+      s1 += a[k + 1] * b[k + 1];
+      s2 += a[k + 2] * b[k + 2];
+      s3 += a[k + 3] * b[k + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+  }
+  static void axpy(float s, const float *x, float *y, int len) {
+    for (int j = 0; j < len; j++)
+      y[j] += s * x[j];
+  }
+};
+
+#if defined(__GNUC__)
+// GCC vector extensions: one 4-lane register per partial-sum group. Unaligned loads go through
+// memcpy, which compiles to a single vector load where the target has one.
+struct VectorBackend {
+  typedef float V4 __attribute__((vector_size(16)));
+  static V4 load4(const float *p) {
+    V4 v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  static void store4(float *p, V4 v) { __builtin_memcpy(p, &v, sizeof(v)); }
+
+  static float dot_tail(const float *a, const float *b, int cols) {
+    V4 acc = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int k = 1; k < cols; k += 4)
+      acc += load4(a + k) * load4(b + k);
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+  }
+  static void axpy(float s, const float *x, float *y, int len) {
+    int j = 0;
+    for (; j + 4 <= len; j += 4)
+      store4(y + j, load4(y + j) + s * load4(x + j));
+    for (; j < len; j++)
+      y[j] += s * x[j];
+  }
+};
+#endif
+
+#ifdef HP_UKF_KERNELS_ESP_DSP
+// Vendor slot: Espressif esp-dsp (ESP32-S3 SIMD / ESP32 assembly). Summation order is the
+// library's, so results match the reference to rounding only.
+struct EspDspBackend {
+  static float dot_tail(const float *a, const float *b, int cols) {
+    float out = 0.0f;
+    dsps_dotprod_f32(a + 1, b + 1, &out, cols - 1);
+    return out;
+  }
+  static void axpy(float s, const float *x, float *y, int len) { ScalarBackend::axpy(s, x, y, len); }
+};
+#endif
+
+template<typename B> struct HpUkfKernelsT {
+  using Backend = B;
+
+  // out (packed upper triangle) = add + w0 * d_i[0] * d_j[0] + w * sum_{k>=1} d_i[k] * d_j[k]
+  // for the rows d_i of D (rows x cols), i <= j.
+  static void weighted_gram_packed(const float *D, int rows, int cols, float w0, float w, const float *add,
+                                   float *out) {
+    int p = 0;
+    for (int i = 0; i < rows; i++) {
+      const float *di = &D[i * cols];
+      for (int j = i; j < rows; j++, p++) {
+        const float *dj = &D[j * cols];
+        out[p] = add[p] + w0 * di[0] * dj[0] + w * B::dot_tail(di, dj, cols);
+      }
+    }
+  }
+
+  // out (rows x m) = the same weighted sums for each row d_i of D against row d_idx[j].
+  static void weighted_cross(const float *D, int rows, int cols, const int *idx, int m, float w0, float w,
+                             float *out) {
+    for (int i = 0; i < rows; i++) {
+      const float *di = &D[i * cols];
+      for (int j = 0; j < m; j++) {
+        const float *dj = &D[idx[j] * cols];
+        out[i * m + j] = w0 * di[0] * dj[0] + w * B::dot_tail(di, dj, cols);
+      }
+    }
+  }
+
+  // out (rows x cols) = A (rows x inner) * Bm (inner x cols).
+  static void mat_mul(const float *A, const float *Bm, int rows, int inner, int cols, float *out) {
+    for (int i = 0; i < rows * cols; i++)
+      out[i] = 0.0f;
+    mat_mul_add(A, Bm, rows, inner, cols, 1.0f, out);
+  }
+
+  // out += sign * A * Bm.
+  static void mat_mul_add(const float *A, const float *Bm, int rows, int inner, int cols, float sign, float *out) {
+    for (int i = 0; i < rows; i++)
+      for (int r = 0; r < inner; r++)
+        B::axpy(sign * A[i * inner + r], &Bm[r * cols], &out[i * cols], cols);
+  }
+
+  // out (packed upper triangle of n x n) = A + C * K' with C, K both n x m.
+  static void sym_update_packed(const float *A, int n, const float *C, const float *K, int m, float *out) {
+    int p = 0;
+    for (int i = 0; i < n; i++)
+      for (int j = i; j < n; j++, p++) {
+        float acc = A[i * n + j];
+        for (int r = 0; r < m; r++)
+          acc += C[i * m + r] * K[j * m + r];
+        out[p] = acc;
+      }
+  }
+};
+
+// Backend selection: HP_UKF_KERNELS_ESP_DSP / HP_UKF_KERNELS_SCALAR / HP_UKF_KERNELS_VECTOR
+// (emitted by __init__.py from `kernels`), else vector where GCC maps it to SIMD registers.
+#if defined(HP_UKF_KERNELS_ESP_DSP)
+using HpUkfKernels = HpUkfKernelsT<EspDspBackend>;
+#elif defined(HP_UKF_KERNELS_SCALAR)
+using HpUkfKernels = HpUkfKernelsT<ScalarBackend>;
+#elif defined(HP_UKF_KERNELS_VECTOR) || (defined(__GNUC__) && (defined(__SSE__) || defined(__ARM_NEON)))
+using HpUkfKernels = HpUkfKernelsT<VectorBackend>;
+#else
+using HpUkfKernels = HpUkfKernelsT<ScalarBackend>;
+#endif
+
+}  // namespace hp_ukf
+}  // namespace esphome
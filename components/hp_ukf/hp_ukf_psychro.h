@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "hp_ukf_unscented.h"
+
+namespace esphome {
+namespace hp_ukf {
+
+// Moist-air quantities derived from the filtered levels [T_in °C, RH_in %, T_out °C, RH_out %].
+// Saturation vapour pressure over water (Magnus form, Sonntag 1990 constants:
+// 6.112 * exp(17.62 T / (243.12 + T)) hPa) comes from a 1 °C table with linear interpolation,
+// max relative error under 0.125 % in -40..80 °C; dew point is the exact inverse of that
+// interpolation. No expf/logf per call.
+enum PsychroOutput {
+  PSYCHRO_DEW_POINT_INLET = 0,
+  PSYCHRO_DEW_POINT_OUTLET,
+  PSYCHRO_ABSOLUTE_HUMIDITY_INLET,
+  PSYCHRO_ABSOLUTE_HUMIDITY_OUTLET,
+  PSYCHRO_ENTHALPY_INLET,
+  PSYCHRO_ENTHALPY_OUTLET,
+  PSYCHRO_ENTHALPY_DELTA,
+  PSYCHRO_OUTPUT_COUNT,
+};
+
+constexpr float PSYCHRO_T_MIN = -40.0f;
+constexpr int PSYCHRO_TABLE_SIZE = 121;  // -40..80 °C, 1 °C step
+constexpr float PSYCHRO_ES_TABLE[PSYCHRO_TABLE_SIZE] = {
+    0.190212f, 0.210916f, 0.233638f, 0.258551f, 0.285841f, 0.315707f, 0.348362f, 0.384035f,
+    0.42297f, 0.465428f, 0.511689f, 0.56205f, 0.616829f, 0.676365f, 0.741017f, 0.811171f,
+    0.887233f, 0.969638f, 1.05885f, 1.15534f, 1.25965f, 1.37232f, 1.49392f, 1.62508f,
+    1.76645f, 1.91871f, 2.08259f, 2.25886f, 2.44833f, 2.65184f, 2.87031f, 3.10468f,
+    3.35593f, 3.62514f, 3.91339f, 4.22185f, 4.55173f, 4.90431f, 5.28093f, 5.68301f,
+    6.112f, 6.56946f, 7.057f, 7.57632f, 8.12918f, 8.71743f, 9.343f, 10.0079f,
+    10.7143f, 11.4643f, 12.2603f, 13.1046f, 13.9998f, 14.9483f, 15.9531f, 17.0167f,
+    18.1423f, 19.3327f, 20.5913f, 21.9212f, 23.326f, 24.809f, 26.3742f, 28.0251f,
+    29.7659f, 31.6006f, 33.5334f, 35.5689f, 37.7115f, 39.966f, 42.3372f, 44.8303f,
+    47.4505f, 50.2031f, 53.0939f, 56.1284f, 59.3128f, 62.6531f, 66.1558f, 69.8274f,
+    73.6746f, 77.7044f, 81.9241f, 86.3409f, 90.9627f, 95.7971f, 100.852f, 106.137f,
+    111.659f, 117.427f, 123.452f, 129.741f, 136.304f, 143.152f, 150.294f, 157.742f,
+    165.504f, 173.593f, 182.02f, 190.796f, 199.933f, 209.443f, 219.338f, 229.632f,
+    240.337f, 251.467f, 263.035f, 275.056f, 287.543f, 300.512f, 313.977f, 327.954f,
+    342.458f, 357.506f, 373.114f, 389.299f, 406.077f, 423.468f, 441.487f, 460.155f,
+    479.489f,
+};
+
+// Saturation vapour pressure in hPa; t_c is clamped to the table range.
+inline float saturation_vapor_pressure(float t_c) {
+  float u = std::max(0.0f, std::min(t_c - PSYCHRO_T_MIN, static_cast<float>(PSYCHRO_TABLE_SIZE - 1)));
+  int i = std::min(static_cast<int>(u), PSYCHRO_TABLE_SIZE - 2);
+  float f = u - static_cast<float>(i);
+  return PSYCHRO_ES_TABLE[i] + f * (PSYCHRO_ES_TABLE[i + 1] - PSYCHRO_ES_TABLE[i]);
+}
+
+// Temperature (°C) at which the interpolated saturation pressure equals e_hpa; clamped to the
+// table range.
+inline float dew_point_from_vapor_pressure(float e_hpa) {
+  if (!(e_hpa > PSYCHRO_ES_TABLE[0]))
+    return PSYCHRO_T_MIN;
+  if (e_hpa >= PSYCHRO_ES_TABLE[PSYCHRO_TABLE_SIZE - 1])
+    return PSYCHRO_T_MIN + (PSYCHRO_TABLE_SIZE - 1);
+  const float *hi = std::upper_bound(PSYCHRO_ES_TABLE, PSYCHRO_ES_TABLE + PSYCHRO_TABLE_SIZE, e_hpa);
+  int i = static_cast<int>(hi - PSYCHRO_ES_TABLE) - 1;
+  float f = (e_hpa - PSYCHRO_ES_TABLE[i]) / (PSYCHRO_ES_TABLE[i + 1] - PSYCHRO_ES_TABLE[i]);
+  return PSYCHRO_T_MIN + static_cast<float>(i) + f;
+}
+
+// All PSYCHRO_OUTPUT_COUNT outputs for one level vector at total pressure p_hpa: dew point °C,
+// absolute humidity g/m³, specific enthalpy kJ/kg dry air, and outlet minus inlet enthalpy.
+inline void psychro_outputs(const float *levels, float p_hpa, float *out) {
+  for (int side = 0; side < 2; side++) {
+    float t = levels[2 * side];
+    float rh = std::max(0.0f, std::min(levels[2 * side + 1], 100.0f));
+    float e = 0.01f * rh * saturation_vapor_pressure(t);
+    float w = 0.622f * e / std::max(p_hpa - e, 1.0f);  // mixing ratio kg/kg
+    out[PSYCHRO_DEW_POINT_INLET + side] = dew_point_from_vapor_pressure(e);
+    out[PSYCHRO_ABSOLUTE_HUMIDITY_INLET + side] = 216.7f * e / (t + 273.15f);
+    out[PSYCHRO_ENTHALPY_INLET + side] = 1.006f * t + w * (2501.0f + 1.86f * t);
+  }
+  out[PSYCHRO_ENTHALPY_DELTA] = out[PSYCHRO_ENTHALPY_OUTLET] - out[PSYCHRO_ENTHALPY_INLET];
+}
+
+// Unscented transform of psychro_outputs over the levels with covariance P4 (4 x 4 packed, the
+// level block of the filter's P). Uses the filter's sigma points and weights
+// (hp_ukf_unscented.h). Gives the mean and variance of every output.
+inline void psychro_unscented(const float *levels, const float *P4, float p_hpa, float *mean, float *var) {
+  constexpr int n = 4;
+  using UT = UnscentedWeights<n>;
+  constexpr int n_sigma = UT::N_SIGMA;
+  float L[n * n];
+  ut_cholesky<n>(P4, L);
+  float chi[n * n_sigma];
+  ut_sigma_points<n>(levels, L, UT::SIGMA_SCALE, chi);
+  float y[n_sigma][PSYCHRO_OUTPUT_COUNT];
+  for (int k = 0; k < n_sigma; k++) {
+    float xk[n];
+    for (int i = 0; i < n; i++)
+      xk[i] = chi[i * n_sigma + k];
+    psychro_outputs(xk, p_hpa, y[k]);
+  }
+  for (int o = 0; o < PSYCHRO_OUTPUT_COUNT; o++) {
+    float m = UT::WM0 * y[0][o];
+    for (int k = 1; k < n_sigma; k++)
+      m += UT::WM * y[k][o];
+    float d0 = y[0][o] - m;
+    float v = UT::WC0 * d0 * d0;
+    for (int k = 1; k < n_sigma; k++) {
+      float d = y[k][o] - m;
+      v += UT::WC * d * d;
+    }
+    mean[o] = m;
+    var[o] = v;
+  }
+}
+
+}  // namespace hp_ukf
+}  // namespace esphome
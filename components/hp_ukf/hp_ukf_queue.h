@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace hp_ukf {
+
+// One input sample: millis() time of the reading, measurement channel (0..3) and value.
+struct TimedMeasurement {
+  uint32_t t_ms;
+  uint8_t channel;
+  float value;
+};
+
+// Wrap-safe ordering of millis() timestamps.
+inline bool time_before(uint32_t a, uint32_t b) { return static_cast<int32_t>(a - b) < 0; }
+
+// Stable insertion sort by time (arrays here hold at most a few dozen entries).
+inline void sort_by_time(TimedMeasurement *m, int count) {
+  for (int i = 1; i < count; i++) {
+    TimedMeasurement v = m[i];
+    int j = i - 1;
+    while (j >= 0 && time_before(v.t_ms, m[j].t_ms)) {
+      m[j + 1] = m[j];
+      j--;
+    }
+    m[j + 1] = v;
+  }
+}
+
+// Fixed-capacity FIFO of measurements, no heap. push() drops the oldest entry when full and
+// returns false so the caller can count the loss.
+template<int CAP> class MeasurementRing {
+ public:
+  static constexpr int CAPACITY = CAP;
+
+  bool push(const TimedMeasurement &m) {
+    bool fits = count_ < CAP;
+    if (!fits) {
+      head_ = (head_ + 1) % CAP;
+      count_--;
+    }
+    buf_[(head_ + count_) % CAP] = m;
+    count_++;
+    return fits;
+  }
+  const TimedMeasurement &operator[](int i) const { return buf_[(head_ + i) % CAP]; }
+  int size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  void clear() {
+    head_ = 0;
+    count_ = 0;
+  }
+
+ protected:
+  TimedMeasurement buf_[CAP]{};
+  int head_{0};
+  int count_{0};
+};
+
+// Time-ordered fusion with rollback (`measurement_queue:`), no heap. Filter is the filter type and
+// Extra the state that rolls back with it (the control model state). The caller owns the live
+// filter, its Extra and the time filter_ms it refers to.
+template<class Filter, class Extra, int CAP> class MeasurementQueue {
+ public:
+  static constexpr int CAPACITY = CAP;
+
+  // Queues a sample; false (counted as dropped) if the oldest pending sample was overwritten.
+  bool push(const TimedMeasurement &m) {
+    if (pending_.push(m))
+      return true;
+    dropped_++;
+    return false;
+  }
+
+  // The filter as it is at filter_ms becomes the rollback point; the replay history restarts.
+  void checkpoint(const Filter &filter, const Extra &extra, uint32_t filter_ms) {
+    checkpoint_ = filter;
+    extra_checkpoint_ = extra;
+    checkpoint_ms_ = filter_ms;
+    history_.clear();
+  }
+
+  // Fuses the pending samples in time order: step(t_ms, z, mask) once per timestamp, which must
+  // predict the filter to t_ms, update it and advance filter_ms (HpUkfComponent::filter_step_()).
+  // A sample older than filter_ms restores the checkpoint and replays everything fused since then.
+  // Samples older than now_ms - window_ms become final: the checkpoint moves past them and later
+  // arrivals older than the checkpoint are dropped. Returns the number of replayed samples, or
+  // -1 without a rollback.
+  template<class Step>
+  int process(Filter &filter, Extra &extra, uint32_t &filter_ms, uint32_t now_ms, uint32_t window_ms, Step step) {
+    TimedMeasurement batch[2 * CAP];
+    int count = 0;
+    for (int i = 0; i < pending_.size(); i++)
+      batch[count++] = pending_[i];
+    pending_.clear();
+    if (count == 0)
+      return -1;
+    sort_by_time(batch, count);
+
+    int replayed = -1;
+    if (time_before(batch[0].t_ms, filter_ms)) {
+      filter = checkpoint_;
+      extra = extra_checkpoint_;
+      filter_ms = checkpoint_ms_;
+      replayed = history_.size();
+      for (int i = 0; i < history_.size(); i++)
+        batch[count++] = history_[i];
+      history_.clear();
+      sort_by_time(batch, count);
+      replays_++;
+    }
+
+    uint32_t t_final = now_ms - window_ms;
+    int i = 0;
+    for (; i < count && time_before(batch[i].t_ms, filter_ms); i++)
+      dropped_++;
+    while (i < count) {
+      uint32_t t = batch[i].t_ms;
+      float z[Filter::M];
+      bool mask[Filter::M];
+      for (int c = 0; c < Filter::M; c++) {
+        z[c] = NAN;
+        mask[c] = false;
+      }
+      int end = i;
+      for (; end < count && batch[end].t_ms == t; end++) {
+        z[batch[end].channel] = batch[end].value;
+        mask[batch[end].channel] = true;
+      }
+      // Checkpoint once everything fused so far is final, or when the history would overflow.
+      bool state_final = !time_before(t_final, filter_ms) && time_before(t_final, t);
+      if ((state_final && checkpoint_ms_ != filter_ms) || history_.size() + (end - i) > CAP)
+        this->checkpoint(filter, extra, filter_ms);
+      step(t, z, mask);
+      for (; i < end; i++)
+        history_.push(batch[i]);
+    }
+    if (!time_before(t_final, filter_ms))
+      this->checkpoint(filter, extra, filter_ms);
+    return replayed;
+  }
+
+  uint32_t get_replays() const { return replays_; }
+  // Samples lost to a full pending ring or older than the checkpoint.
+  uint32_t get_dropped() const { return dropped_; }
+  // Rollback point: every sample up to checkpoint_ms is final in it.
+  const Filter &get_checkpoint() const { return checkpoint_; }
+  const Extra &get_extra_checkpoint() const { return extra_checkpoint_; }
+  uint32_t get_checkpoint_ms() const { return checkpoint_ms_; }
+
+ protected:
+  MeasurementRing<CAP> pending_;
+  MeasurementRing<CAP> history_;
+  Filter checkpoint_;
+  Extra extra_checkpoint_;
+  uint32_t checkpoint_ms_{0};
+  uint32_t replays_{0};
+  uint32_t dropped_{0};
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace hp_ukf {
+
+// Min/mean/max of an unsigned sample (microseconds or CPU cycles) over one summary window.
+struct RunningStat {
+  uint32_t min{UINT32_MAX};
+  uint32_t max{0};
+  uint64_t sum{0};
+  uint32_t count{0};
+
+  void add(uint32_t v) {
+    if (v < min)
+      min = v;
+    if (v > max)
+      max = v;
+    sum += v;
+    count++;
+  }
+  uint32_t mean() const { return count ? static_cast<uint32_t>(sum / count) : 0; }
+  uint32_t min_or_zero() const { return count ? min : 0; }
+  void reset() { *this = RunningStat{}; }
+};
+
+// Instrumentation counters, compiled in only with USE_HP_UKF_STATS (the `stats:` config block).
+// Timings are reset after each summary; event counters and the heap low-water mark are totals
+// since boot.
+struct HpUkfStats {
+  RunningStat predict_us;  // separate predict only
+  RunningStat update_us;   // separate update only
+  RunningStat step_us;     // whole filter step, any mode
+  RunningStat step_cycles;
+  uint32_t steps{0};
+  uint32_t nan_events{0};    // non-finite input samples and non-finite states after a step
+  uint32_t clamp_events{0};  // dt clamped to 1 h and SR downdates skipped
+  uint32_t heap_min_free{UINT32_MAX};
+
+  void reset_window() {
+    predict_us.reset();
+    update_us.reset();
+    step_us.reset();
+    step_cycles.reset();
+  }
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
@@ -1,212 +1,321 @@
 #include "hp_ukf_ukf.h"
+#include "hp_ukf_kernels.h"
 #include <cmath>
 #include <algorithm>
 
 namespace esphome {
 namespace hp_ukf {
 
-void HpUkfFilter::set_state_dimension(int n) {
-  n_ = (n == 4 || n == 8) ? n : 8;
-  update_weights();
-  // Default process noise (from EM-converged log copy-paste).
-  for (int i = 0; i < n_ * n_; i++)
-    Q_[i] = 0.0f;
-  Q_[0 * n_ + 0] = 0.02255297f;   // T_in °C²
-  Q_[1 * n_ + 1] = 0.03863900f;   // RH_in %²
-  Q_[2 * n_ + 2] = 0.03064128f;   // T_out °C²
-  Q_[3 * n_ + 3] = 0.04204632f;   // RH_out %²
-  if (n_ >= 8) {
-    Q_[4 * n_ + 4] = 0.004649542f;  // dT_in
-    Q_[5 * n_ + 5] = 0.005577928f;  // dT_out
-    Q_[6 * n_ + 6] = 0.007255317f;  // dRH_in
-    Q_[7 * n_ + 7] = 0.007194013f;  // dRH_out
-  }
-  // Default measurement noise (from EM-converged log copy-paste).
-  for (int i = 0; i < M * M; i++)
-    R_[i] = 0.0f;
-  R_[0 * M + 0] = 0.1317456f;    // T_in °C²
-  R_[1 * M + 1] = 0.2825074f;    // RH_in %²
-  R_[2 * M + 2] = 0.001090135f;  // T_out °C²
-  R_[3 * M + 3] = 0.0002252902f; // RH_out %²
+// Collect indices of available measurements; returns their count.
+static int available_indices(const bool *mask, int count, int *idx) {
+  int m_avail = 0;
+  for (int i = 0; i < count; i++) {
+    if (mask[i]) {
+      idx[m_avail] = i;
+      m_avail++;
+    }
+  }
+  return m_avail;
 }
 
-void HpUkfFilter::update_weights() {
-  lambda_ = alpha_ * alpha_ * (n_ + kappa_) - n_;
-  float nlam = n_ + lambda_;
-  wm0_ = lambda_ / nlam;
-  wc0_ = lambda_ / nlam + (1.0f - alpha_ * alpha_ + beta_);
-  wm_ = 0.5f / nlam;
-  wc_ = 0.5f / nlam;
+template<int NX, int NZ>
+HpUkfFilterT<NX, NZ>::HpUkfFilterT() {
+  for (int i = 0; i < N; i++)
+    Q_[packed_index(i, i)] = DEFAULT_Q_DIAG[i];
+  for (int i = 0; i < M; i++)
+    R_[i * M + i] = DEFAULT_R_DIAG[i];
 }
 
-void HpUkfFilter::set_state(const float *x) {
-  for (int i = 0; i < n_; i++)
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::set_state(const float *x) {
+  for (int i = 0; i < N; i++)
     x_[i] = x[i];
 }
 
-void HpUkfFilter::set_covariance(const float *P) {
-  for (int i = 0; i < n_ * n_; i++)
-    P_[i] = P[i];
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::set_covariance(const float *P) {
+  for (int i = 0; i < N; i++)
+    for (int j = i; j < N; j++)
+      P_[packed_index(i, j)] = P[i * N + j];
+  p_stale_ = false;
+  if (mode_ == FILTER_MODE_SR_UKF)
+    ut_cholesky<N>(P_, S_);
+  else if (mode_ == FILTER_MODE_LINEAR_KF)
+    project_channel_blocks();
+  else if (mode_ == FILTER_MODE_UD)
+    ud_factor();
 }
 
-void HpUkfFilter::set_initial_state(const float *x, const float *P) {
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::set_filter_mode(FilterMode mode) {
+  if (mode == mode_)
+    return;
+  get_covariance_packed();  // bring P_ up to date before leaving SR or UD mode
+  mode_ = mode;
+  if (mode_ == FILTER_MODE_SR_UKF)
+    ut_cholesky<N>(P_, S_);
+  else if (mode_ == FILTER_MODE_LINEAR_KF)
+    project_channel_blocks();
+  else if (mode_ == FILTER_MODE_UD)
+    ud_factor();
+}
+
+template<int NX, int NZ>
+const float *HpUkfFilterT<NX, NZ>::get_covariance_packed() const {
+  if (p_stale_ && mode_ == FILTER_MODE_UD) {
+    // P = U*D*U^T: P_ij = sum_{k >= j} U_ik * D_k * U_jk for i <= j (U_kk = 1).
+    for (int i = 0; i < N; i++)
+      for (int j = i; j < N; j++) {
+        float s = 0.0f;
+        for (int k = j; k < N; k++) {
+          float u_ik = (k == i) ? 1.0f : UD_[packed_index(i, k)];
+          float u_jk = (k == j) ? 1.0f : UD_[packed_index(j, k)];
+          s += u_ik * UD_[packed_index(k, k)] * u_jk;
+        }
+        P_[packed_index(i, j)] = s;
+      }
+    p_stale_ = false;
+  } else if (p_stale_) {
+    constexpr int dim = N;
+    for (int i = 0; i < dim; i++)
+      for (int j = i; j < dim; j++) {
+        float s = 0.0f;
+        for (int k = 0; k <= i; k++)
+          s += S_[i * dim + k] * S_[j * dim + k];
+        P_[packed_index(i, j)] = s;
+      }
+    p_stale_ = false;
+  }
+  return P_;
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::get_covariance(float *P) const {
+  const float *Pp = get_covariance_packed();
+  for (int i = 0; i < N; i++)
+    for (int j = 0; j < N; j++)
+      P[i * N + j] = Pp[packed_index(i, j)];
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::set_initial_state(const float *x, const float *P) {
   set_state(x);
   set_covariance(P);
 }
 
-void HpUkfFilter::set_process_noise(const float *Q) {
-  for (int i = 0; i < n_ * n_; i++)
-    Q_[i] = Q[i];
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::set_process_noise(const float *Q) {
+  for (int i = 0; i < N; i++)
+    for (int j = i; j < N; j++)
+      Q_[packed_index(i, j)] = Q[i * N + j];
 }
 
-void HpUkfFilter::set_measurement_noise(const float *R) {
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::set_measurement_noise(const float *R) {
   for (int i = 0; i < M * M; i++)
     R_[i] = R[i];
 }
 
-void HpUkfFilter::get_process_noise_diag(float *q_diag) const {
-  for (int i = 0; i < n_; i++)
-    q_diag[i] = Q_[i * n_ + i];
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::get_process_noise_diag(float *q_diag) const {
+  for (int i = 0; i < N; i++)
+    q_diag[i] = Q_[packed_index(i, i)];
 }
 
-void HpUkfFilter::get_measurement_noise_diag(float *r_diag) const {
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::get_measurement_noise_diag(float *r_diag) const {
   for (int i = 0; i < M; i++)
     r_diag[i] = R_[i * M + i];
 }
 
-void HpUkfFilter::state_transition(const float *x_in, float dt, float *x_out) const {
-  x_out[0] = x_in[0] + (n_ >= 8 ? x_in[4] * dt : 0.0f);   // T_in
-  x_out[1] = x_in[1] + (n_ >= 8 ? x_in[6] * dt : 0.0f);   // RH_in
-  x_out[2] = x_in[2] + (n_ >= 8 ? x_in[5] * dt : 0.0f);   // T_out
-  x_out[3] = x_in[3] + (n_ >= 8 ? x_in[7] * dt : 0.0f);   // RH_out
-  if (n_ >= 8) {
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::state_transition(const float *x_in, float dt, float *x_out) const {
+  if constexpr (N >= 8) {
+    x_out[0] = x_in[0] + x_in[4] * dt;  // T_in
+    x_out[1] = x_in[1] + x_in[6] * dt;  // RH_in
+    x_out[2] = x_in[2] + x_in[5] * dt;  // T_out
+    x_out[3] = x_in[3] + x_in[7] * dt;  // RH_out
     x_out[4] = x_in[4];  // dT_in
     x_out[5] = x_in[5];  // dT_out
     x_out[6] = x_in[6];  // dRH_in
     x_out[7] = x_in[7];  // dRH_out
+  } else {
+    for (int i = 0; i < N; i++)
+      x_out[i] = x_in[i];
   }
 }
 
-void HpUkfFilter::cholesky_factor(int dim, const float *A, float *L) const {
-  for (int i = 0; i < dim * dim; i++)
-    L[i] = 0.0f;
-  for (int i = 0; i < dim; i++) {
-    for (int j = 0; j <= i; j++) {
-      float s = A[i * dim + j];
-      for (int k = 0; k < j; k++)
-        s -= L[i * dim + k] * L[j * dim + k];
-      if (i == j)
-        L[i * dim + j] = (s > 1e-10f) ? std::sqrt(s) : 1e-5f;
-      else
-        L[i * dim + j] = s / (L[j * dim + j] + 1e-10f);
-    }
-  }
+// Sigma points from the Cholesky factor of P (hp_ukf_unscented.h).
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::sigma_points(float *chi) const {
+  float L[N * N];
+  ut_cholesky<N>(P_, L);
+  ut_sigma_points<N>(x_, L, SIGMA_SCALE, chi);
 }
 
-// chi: (2n+1) columns, each column length n. Stored row-major as chi[n * (2*n+1)].
-// Sigma points use (n+lambda)*P = L*L^T, then x +/- L columns.
-void HpUkfFilter::sigma_points(int dim, float *chi) const {
-  float P_scaled[N_MAX * N_MAX];
-  float scale = dim + lambda_;
-  for (int i = 0; i < dim * dim; i++)
-    P_scaled[i] = scale * P_[i];
-  float L[N_MAX * N_MAX];
-  cholesky_factor(dim, P_scaled, L);
-  for (int i = 0; i < dim; i++)
-    chi[i * (2 * dim + 1)] = x_[i];
-  for (int j = 0; j < dim; j++) {
-    for (int i = 0; i < dim; i++) {
-      chi[i * (2 * dim + 1) + j + 1] = x_[i] + L[i * dim + j];
-      chi[i * (2 * dim + 1) + dim + 1 + j] = x_[i] - L[i * dim + j];
-    }
-  }
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::predict(float dt) {
+  dt = std::max(1e-6f, std::min(dt, 3600.0f));
+  if (mode_ == FILTER_MODE_LINEAR_KF)
+    predict_linear(dt);
+  else if (mode_ == FILTER_MODE_UD)
+    predict_ud(dt);
+  else if (mode_ == FILTER_MODE_SR_UKF)
+    predict_sr(dt);
+  else
+    predict_ukf(dt);
 }
 
-void HpUkfFilter::predict(float dt) {
-  dt = std::max(1e-6f, std::min(dt, 3600.0f));
-  int dim = n_;
-  int n_sigma = 2 * dim + 1;
-  float chi[N_MAX * (2 * N_MAX + 1)];
-  sigma_points(dim, chi);
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::predict_ukf(float dt) {
+  constexpr int dim = N;
+  constexpr int n_sigma = N_SIGMA;
+  float chi[N * (2 * N + 1)];
+  sigma_points(chi);
 
-  float x_pred[N_MAX];
-  for (int i = 0; i < dim; i++)
-    x_pred[i] = wm0_ * chi[i * n_sigma];
-  for (int k = 1; k < n_sigma; k++) {
-    float x_prop[N_MAX];
+  // Propagate sigma points in place.
+  for (int k = 0; k < n_sigma; k++) {
+    float x_prop[N];
     for (int i = 0; i < dim; i++)
       x_prop[i] = chi[i * n_sigma + k];
-    float x_out[N_MAX];
+    float x_out[N];
     state_transition(x_prop, dt, x_out);
     for (int i = 0; i < dim; i++)
-      x_pred[i] += wm_ * x_out[i];
+      chi[i * n_sigma + k] = x_out[i];
+  }
+  for (int i = 0; i < dim; i++) {
+    float *row = &chi[i * n_sigma];
+    float acc = WM0 * row[0];
+    for (int k = 1; k < n_sigma; k++)
+      acc += WM * row[k];
+    x_[i] = acc;
+    for (int k = 0; k < n_sigma; k++)
+      row[k] -= acc;
   }
-  for (int i = 0; i < dim; i++)
-    x_[i] = x_pred[i];
 
-  float P_pred[N_MAX * N_MAX];
-  for (int i = 0; i < dim * dim; i++)
-    P_pred[i] = 0.0f;
-  for (int k = 0; k < n_sigma; k++) {
-    float x_prop[N_MAX];
-    for (int i = 0; i < dim; i++)
-      x_prop[i] = chi[i * n_sigma + k];
-    float x_out[N_MAX];
-    state_transition(x_prop, dt, x_out);
-    float w = (k == 0) ? wc0_ : wc_;
-    for (int i = 0; i < dim; i++)
-      for (int j = 0; j < dim; j++)
-        P_pred[i * dim + j] += w * (x_out[i] - x_[i]) * (x_out[j] - x_[j]);
+  // P = Q + sum_k w_k * dx_k * dx_k^T, upper triangle only. chi rows now hold the deviations,
+  // so the sum over sigma points is a contiguous dot product per packed entry.
+  static_assert((N_SIGMA - 1) % 4 == 0, "dot product is unrolled by four");
+  float Q_scaled[N_PACKED];
+  const float *Q = Q_;
+  if (q_scale_ != 1.0f) {
+    for (int i = 0; i < N_PACKED; i++)
+      Q_scaled[i] = q_scale_ * Q_[i];
+    Q = Q_scaled;
   }
-  for (int i = 0; i < dim * dim; i++)
-    P_[i] = P_pred[i] + Q_[i];
+  HpUkfKernels::weighted_gram_packed(chi, dim, n_sigma, WC0, WC, Q, P_);
 }
 
-void HpUkfFilter::update(const float *z, const bool *mask) {
-  int dim = n_;
-  int m_avail = 0;
-  int idx[M];
-  for (int i = 0; i < M; i++) {
-    if (mask[i]) {
-      idx[m_avail] = i;
-      m_avail++;
-    }
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::predict_update(float dt, const float *z, const bool *mask) {
+  dt = std::max(1e-6f, std::min(dt, 3600.0f));
+  if (mode_ != FILTER_MODE_UKF) {
+    // Linear KF, UD and SR-UKF do not refactor P in update, so there is nothing to share.
+    predict(dt);
+    update(z, mask);
+    return;
   }
+  predict_ukf(dt);
+  bool gated[M];
+  for (int i = 0; i < M; i++)
+    gated[i] = mask[i];
+  if (gate_.enabled())
+    gate_measurements(z, gated);
+  int idx[M];
+  int m_avail = available_indices(gated, M, idx);
   if (m_avail == 0)
     return;
+  if (sequential_update_) {
+    update_sequential(z, idx, m_avail);
+    return;
+  }
+  // P_ now holds the propagated sigma-point covariance plus Q. H only selects states, so the
+  // measurement statistics a redrawn sigma set would give are slices of it: z_pred = x[idx],
+  // Pzz = P[idx, idx], Pxz = P[:, idx]. This skips the second Cholesky and sigma matrix.
+  constexpr int dim = N;
+  float z_pred_avail[M];
+  float Pzz[M * M];
+  float Pxz[N * M];
+  for (int i = 0; i < m_avail; i++) {
+    z_pred_avail[i] = x_[idx[i]];
+    for (int j = 0; j < m_avail; j++)
+      Pzz[i * m_avail + j] = P_[packed_index(idx[i], idx[j])];
+  }
+  for (int i = 0; i < dim; i++)
+    for (int j = 0; j < m_avail; j++)
+      Pxz[i * m_avail + j] = P_[packed_index(i, idx[j])];
+  correct_ukf(z, idx, m_avail, z_pred_avail, Pzz, Pxz);
+}
 
-  int n_sigma = 2 * dim + 1;
-  float chi[N_MAX * (2 * N_MAX + 1)];
-  sigma_points(dim, chi);
-
-  float z_pred[M];
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::update(const float *z, const bool *mask) {
+  bool gated[M];
   for (int i = 0; i < M; i++)
-    z_pred[i] = wm0_ * chi[i * n_sigma];
-  for (int k = 1; k < n_sigma; k++) {
-    float w = wm_;
-    for (int i = 0; i < M; i++)
-      z_pred[i] += w * chi[i * n_sigma + k];
-  }
+    gated[i] = mask[i];
+  if (gate_.enabled())
+    gate_measurements(z, gated);
+  int idx[M];
+  int m_avail = available_indices(gated, M, idx);
+  if (m_avail == 0)
+    return;
+  if (mode_ == FILTER_MODE_LINEAR_KF)
+    update_linear(z, idx, m_avail);
+  else if (mode_ == FILTER_MODE_UD)
+    update_ud(z, idx, m_avail);
+  else if (mode_ == FILTER_MODE_SR_UKF)
+    update_sr(z, idx, m_avail);
+  else if (sequential_update_)
+    update_sequential(z, idx, m_avail);
+  else
+    update_ukf(z, idx, m_avail);
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::update_ukf(const float *z, const int *idx, int m_avail) {
+  constexpr int dim = N;
+  constexpr int n_sigma = N_SIGMA;
+  float chi[N * (2 * N + 1)];
+  sigma_points(chi);
 
-  float z_avail[4];
   float z_pred_avail[4];
   for (int i = 0; i < m_avail; i++) {
-    z_avail[i] = z[idx[i]];
-    z_pred_avail[i] = z_pred[idx[i]];
+    const float *row = &chi[idx[i] * n_sigma];
+    float acc = WM0 * row[0];
+    for (int k = 1; k < n_sigma; k++)
+      acc += WM * row[k];
+    z_pred_avail[i] = acc;
   }
 
+  // Deviations in place, one row per state: measured rows from z_pred, the others from x.
+  // Pxz is then a weighted dot product of contiguous rows, and Pzz is its rows idx[].
+  float center[N];
+  for (int i = 0; i < dim; i++)
+    center[i] = x_[i];
+  for (int i = 0; i < m_avail; i++)
+    center[idx[i]] = z_pred_avail[i];
+  for (int i = 0; i < dim; i++)
+    for (int k = 0; k < n_sigma; k++)
+      chi[i * n_sigma + k] -= center[i];
+
+  float Pxz[N * 4];
+  HpUkfKernels::weighted_cross(chi, dim, n_sigma, idx, m_avail, WC0, WC, Pxz);
   float Pzz[4 * 4];
-  for (int i = 0; i < m_avail * m_avail; i++)
-    Pzz[i] = 0.0f;
-  for (int k = 0; k < n_sigma; k++) {
-    float w = (k == 0) ? wc0_ : wc_;
-    float dz[4];
-    for (int i = 0; i < m_avail; i++)
-      dz[i] = chi[idx[i] * n_sigma + k] - z_pred_avail[i];
-    for (int i = 0; i < m_avail; i++)
-      for (int j = 0; j < m_avail; j++)
-        Pzz[i * m_avail + j] += w * dz[i] * dz[j];
-  }
+  for (int i = 0; i < m_avail; i++)
+    for (int j = 0; j < m_avail; j++)
+      Pzz[i * m_avail + j] = Pxz[idx[i] * m_avail + j];
+
+  correct_ukf(z, idx, m_avail, z_pred_avail, Pzz, Pxz);
+}
+
+// Gain, state correction, Joseph-form covariance update and EM from measurement statistics:
+// z_pred (m_avail), Pzz before R (m_avail x m_avail, modified) and Pxz (n x m_avail).
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::correct_ukf(const float *z, const int *idx, int m_avail, const float *z_pred_avail,
+                                       float *Pzz, const float *Pxz) {
+  constexpr int dim = N;
+  float z_avail[4];
+  for (int i = 0; i < m_avail; i++)
+    z_avail[i] = z[idx[i]];
   // Save Pzz prior (before adding R) for EM R adaptation.
   float Pzz_prior_ii[4];
   for (int i = 0; i < m_avail; i++)
@@ -214,21 +323,6 @@ void HpUkfFilter::update(const float *z, const bool *mask) {
   for (int i = 0; i < m_avail; i++)
     Pzz[i * m_avail + i] += R_[idx[i] * M + idx[i]];
 
-  float Pxz[N_MAX * 4];
-  for (int i = 0; i < dim * m_avail; i++)
-    Pxz[i] = 0.0f;
-  for (int k = 0; k < n_sigma; k++) {
-    float w = (k == 0) ? wc0_ : wc_;
-    float dx[N_MAX], dz[4];
-    for (int i = 0; i < dim; i++)
-      dx[i] = chi[i * n_sigma + k] - x_[i];
-    for (int i = 0; i < m_avail; i++)
-      dz[i] = chi[idx[i] * n_sigma + k] - z_pred_avail[i];
-    for (int i = 0; i < dim; i++)
-      for (int j = 0; j < m_avail; j++)
-        Pxz[i * m_avail + j] += w * dx[i] * dz[j];
-  }
-
   // Pzz^{-1} via Gauss-Jordan (m_avail x m_avail)
   float Pzz_inv[4 * 4];
   for (int i = 0; i < m_avail; i++)
@@ -271,18 +365,456 @@ void HpUkfFilter::update(const float *z, const bool *mask) {
     }
   }
 
-  float K[N_MAX * 4];
+  float K[N * 4];
+  HpUkfKernels::mat_mul(Pxz, Pzz_inv, dim, m_avail, m_avail, K);
+
+  float innov[4];
+  for (int i = 0; i < m_avail; i++)
+    innov[i] = z_avail[i] - z_pred_avail[i];
+  float corr[N];
+  HpUkfKernels::mat_mul(K, innov, dim, m_avail, 1, corr);
+  for (int i = 0; i < dim; i++)
+    x_[i] += corr[i];
+
+  // Joseph form: P = (I - K*H)*P*(I - K*H)' + K*R*K'. H selects the states idx[], so
+  // (I - K*H)*P = P - K*P[idx, :] and the product with (I - K*H)' subtracts A[:, idx]*K'.
+  // A is not symmetric and is formed in full; the result is, so only its packed upper
+  // triangle is computed, as A + (K*R - A[:, idx])*K'.
+  float A[N * N];
+  float P_idx[4 * N];
   for (int i = 0; i < dim; i++)
-    for (int j = 0; j < m_avail; j++) {
-      K[i * m_avail + j] = 0.0f;
+    for (int j = 0; j < dim; j++)
+      A[i * dim + j] = P_[packed_index(i, j)];
+  for (int r = 0; r < m_avail; r++)
+    for (int j = 0; j < dim; j++)
+      P_idx[r * dim + j] = P_[packed_index(idx[r], j)];
+  HpUkfKernels::mat_mul_add(K, P_idx, dim, m_avail, dim, -1.0f, A);
+  float C[N * 4];
+  for (int i = 0; i < dim; i++)
+    for (int s = 0; s < m_avail; s++) {
+      float acc = 0.0f;
       for (int r = 0; r < m_avail; r++)
-        K[i * m_avail + j] += Pxz[i * m_avail + r] * Pzz_inv[r * m_avail + j];
+        acc += K[i * m_avail + r] * R_[idx[r] * M + idx[s]];
+      C[i * m_avail + s] = acc - A[i * dim + idx[s]];
     }
+  HpUkfKernels::sym_update_packed(A, dim, C, K, m_avail, P_);
 
-  float innov[4];
+  if (em_enabled_)
+    em_adapt(idx, m_avail, innov, Pzz_prior_ii, corr);
+}
+
+// Sequential scalar update. H selects states, so the sigma-point statistics are z_pred = x[c],
+// Pzz = P[c][c] and Pxz = P[:, c]; with diagonal R the batch update equals one scalar update
+// per available channel. EM sees the same prior innovations and total correction as the batch.
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::update_sequential(const float *z, const int *idx, int m_avail) {
+  constexpr int dim = N;
+  float innov_prior[M];
+  float Pzz_prior_ii[M];
+  float x_prior[N];
+  for (int i = 0; i < m_avail; i++) {
+    innov_prior[i] = z[idx[i]] - x_[idx[i]];
+    Pzz_prior_ii[i] = P_[packed_index(idx[i], idx[i])];
+  }
+  for (int i = 0; i < dim; i++)
+    x_prior[i] = x_[i];
+
+  for (int i = 0; i < m_avail; i++) {
+    int c = idx[i];
+    float r_meas = R_[c * M + c];
+    float s = P_[packed_index(c, c)] + r_meas;
+    if (!(s > 0.0f))
+      continue;  // only reachable with a non-positive R from set_measurement_noise
+    float p[N], k[N];
+    for (int j = 0; j < dim; j++) {
+      p[j] = P_[packed_index(j, c)];
+      k[j] = p[j] / s;
+    }
+    float innov = z[c] - x_[c];
+    for (int j = 0; j < dim; j++)
+      x_[j] += k[j] * innov;
+    // Rank-1 correction P -= k*p' (the Joseph form for H = e_c with this gain reduces to it).
+    // Entries with p[a] == 0 or p[b] == 0 (other channels) stay exactly unchanged.
+    int q = 0;
+    for (int a = 0; a < dim; a++)
+      for (int b = a; b < dim; b++, q++)
+        P_[q] -= k[a] * p[b];
+  }
+
+  if (em_enabled_) {
+    float corr[N];
+    for (int i = 0; i < dim; i++)
+      corr[i] = x_[i] - x_prior[i];
+    em_adapt(idx, m_avail, innov_prior, Pzz_prior_ii, corr);
+  }
+}
+
+template<int NX, int NZ>
+float HpUkfFilterT<NX, NZ>::channel_variance(int c) const {
+  if (mode_ == FILTER_MODE_SR_UKF) {
+    float s = 0.0f;
+    for (int k = 0; k <= c; k++)
+      s += S_[c * N + k] * S_[c * N + k];
+    return s;
+  }
+  if (mode_ == FILTER_MODE_UD) {
+    float s = UD_[packed_index(c, c)];
+    for (int k = c + 1; k < N; k++) {
+      float u = UD_[packed_index(c, k)];
+      s += u * u * UD_[packed_index(k, k)];
+    }
+    return s;
+  }
+  return P_[packed_index(c, c)];
+}
+
+// z_pred = x[c] and Pzz_cc = P_cc + R_cc for every mode (H selects states), so the gate needs
+// no sigma points and runs before any update path.
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::gate_measurements(const float *z, bool *mask) {
+  float innov[M], s[M], add[M];
+  for (int c = 0; c < M; c++) {
+    innov[c] = mask[c] ? z[c] - x_[c] : 0.0f;
+    s[c] = mask[c] ? channel_variance(c) + R_[c * M + c] : 0.0f;
+  }
+  float scale = gate_.check(innov, s, mask, add);
+  bool reset = scale > 1.0f;
+  for (int c = 0; c < M; c++)
+    reset = reset || add[c] > 0.0f;
+  if (reset)
+    soft_reset(scale, add);
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::soft_reset(float scale, const float *add) {
+  get_covariance_packed();  // SR and UD: bring P_ up to date, it is refactored below
+  for (int i = 0; i < N_PACKED; i++)
+    P_[i] *= scale;
+  for (int c = 0; c < M; c++)
+    if (add[c] > 0.0f)
+      P_[packed_index(c, c)] += add[c];
+  if (mode_ == FILTER_MODE_SR_UKF)
+    ut_cholesky<N>(P_, S_);
+  else if (mode_ == FILTER_MODE_UD)
+    ud_factor();
+}
+
+// EM auto-tune: R adaptation then Q adaptation (diagonal, with forgetting factors).
+// innov/pzz_prior_ii are per available measurement (Pzz before adding R); corr is the state correction.
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::em_adapt(const int *idx, int m_avail, const float *innov, const float *pzz_prior_ii,
+                                    const float *corr) {
+  constexpr int dim = N;
+  for (int i = 0; i < m_avail; i++) {
+    int g = idx[i];
+    float lambda_r = (g <= 1) ? em_lambda_r_inlet_ : em_lambda_r_outlet_;
+    float r_est = innov[i] * innov[i] - pzz_prior_ii[i];
+    if (r_est < R_MIN)
+      r_est = R_MIN;
+    r_est *= (1.0f + em_inflation_);
+    float r_old = R_[g * M + g];
+    R_[g * M + g] = lambda_r * r_old + (1.0f - lambda_r) * r_est;
+    if (R_[g * M + g] < R_MIN)
+      R_[g * M + g] = R_MIN;
+  }
+  for (int j = 0; j < dim; j++) {
+    float q_est = corr[j] * corr[j] / q_scale_;  // per nominal step
+    if (q_est < Q_MIN)
+      q_est = Q_MIN;
+    q_est *= (1.0f + em_inflation_);
+    float &q = Q_[packed_index(j, j)];
+    q = em_lambda_q_ * q + (1.0f - em_lambda_q_) * q_est;
+    if (q < Q_MIN)
+      q = Q_MIN;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Linear KF (FILTER_MODE_LINEAR_KF). F(dt) adds rate*dt to each channel and H selects
+// states 0..3, so channel c only couples to RATE_INDEX[c]. P_ keeps the packed layout (so
+// get_covariance() is unchanged) but only the 2x2 blocks {c, RATE_INDEX[c]} are touched.
+// Only the diagonals of Q and R are used.
+// ---------------------------------------------------------------------------
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::project_channel_blocks() {
+  constexpr int dim = N;
+  int channel[N];
+  for (int i = 0; i < dim; i++)
+    channel[i] = i;
+  if constexpr (dim >= 8) {
+    for (int c = 0; c < M; c++)
+      channel[RATE_INDEX[c]] = c;
+  }
+  for (int i = 0; i < dim; i++)
+    for (int j = i; j < dim; j++)
+      if (channel[i] != channel[j])
+        P_[packed_index(i, j)] = 0.0f;
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::predict_linear(float dt) {
+  constexpr int dim = N;
+  for (int c = 0; c < M; c++) {
+    float &Ppp = P_[packed_index(c, c)];
+    if constexpr (dim < 8) {
+      Ppp += q_scale_ * Q_[packed_index(c, c)];
+      continue;
+    }
+    int r = RATE_INDEX[c];
+    float &Ppr = P_[packed_index(c, r)];
+    float &Prr = P_[packed_index(r, r)];
+    x_[c] += x_[r] * dt;
+    // P = F*P*F' + Q with F = [1 dt; 0 1] on the block.
+    Ppp += dt * (2.0f * Ppr + dt * Prr) + q_scale_ * Q_[packed_index(c, c)];
+    Ppr += dt * Prr;
+    Prr += q_scale_ * Q_[packed_index(r, r)];
+  }
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::update_linear(const float *z, const int *idx, int m_avail) {
+  constexpr int dim = N;
+  float innov[M];
+  float Pzz_prior_ii[M];
+  float corr[N];
+  for (int i = 0; i < dim; i++)
+    corr[i] = 0.0f;
+  for (int i = 0; i < m_avail; i++) {
+    int c = idx[i];
+    float r_meas = R_[c * M + c];
+    float &Ppp = P_[packed_index(c, c)];
+    float s = Ppp + r_meas;
+    float kp = Ppp / s;
+    innov[i] = z[c] - x_[c];
+    Pzz_prior_ii[i] = Ppp;
+    corr[c] = kp * innov[i];
+    x_[c] += corr[c];
+    // Closed forms of the Joseph update on the block (exact for a scalar update):
+    // Ppp' = kp*R, Ppr' = kr*R, Prr' = Prr - kr*Ppr.
+    if constexpr (dim >= 8) {
+      int r = RATE_INDEX[c];
+      float &Ppr = P_[packed_index(c, r)];
+      float &Prr = P_[packed_index(r, r)];
+      float kr = Ppr / s;
+      corr[r] = kr * innov[i];
+      x_[r] += corr[r];
+      Prr -= kr * Ppr;
+      Ppr = kr * r_meas;
+    }
+    Ppp = kp * r_meas;
+  }
+
+  if (em_enabled_)
+    em_adapt(idx, m_avail, innov, Pzz_prior_ii, corr);
+}
+
+// ---------------------------------------------------------------------------
+// Square-root UKF (FILTER_MODE_SR_UKF): S_ is lower triangular with P = S_*S_^T.
+// Only the diagonals of Q and R are used (defaults and EM keep them diagonal).
+// ---------------------------------------------------------------------------
+
+// Householder QR of A (rows x dim, row-major, destroyed). Writes lower-triangular L with
+// L*L^T = A^T*A, i.e. L = R^T for A = Q*R, with a non-negative diagonal.
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::qr_lower_factor(int rows, int dim, float *A, float *L) {
+  for (int k = 0; k < dim && k < rows; k++) {
+    float norm2 = 0.0f;
+    for (int r = k; r < rows; r++)
+      norm2 += A[r * dim + k] * A[r * dim + k];
+    if (norm2 <= 0.0f)
+      continue;
+    float akk = A[k * dim + k];
+    float alpha = (akk > 0.0f) ? -std::sqrt(norm2) : std::sqrt(norm2);
+    // Householder vector v = A[k.., k] - alpha * e_k, stored in column k; v^T v = 2 * (norm2 - alpha * akk).
+    float vtv = 2.0f * (norm2 - alpha * akk);
+    A[k * dim + k] = akk - alpha;
+    for (int j = k + 1; j < dim; j++) {
+      float s = 0.0f;
+      for (int r = k; r < rows; r++)
+        s += A[r * dim + k] * A[r * dim + j];
+      float f = 2.0f * s / vtv;
+      for (int r = k; r < rows; r++)
+        A[r * dim + j] -= f * A[r * dim + k];
+    }
+    A[k * dim + k] = alpha;
+  }
+  for (int i = 0; i < dim; i++) {
+    bool have_row = i < rows;
+    float sign = (have_row && A[i * dim + i] < 0.0f) ? -1.0f : 1.0f;
+    for (int j = 0; j < dim; j++)
+      L[j * dim + i] = (have_row && j >= i) ? sign * A[i * dim + j] : 0.0f;
+  }
+}
+
+// Rank-1 update (sign > 0) or downdate (sign < 0) of lower-triangular L: L*L^T +/- v*v^T.
+// v is destroyed. Returns false (L unchanged) if a downdate would make the matrix indefinite.
+template<int NX, int NZ>
+bool HpUkfFilterT<NX, NZ>::cholesky_rank1(int dim, float *L, float *v, float sign) {
+  if (sign < 0.0f) {
+    // Dry run on a copy of v: the pivots only depend on the original diagonal and v, so a
+    // failing downdate is detected before L is touched (no scratch copy of L needed).
+    float w[N];
+    for (int i = 0; i < dim; i++)
+      w[i] = v[i];
+    for (int k = 0; k < dim; k++) {
+      if (w[k] == 0.0f)
+        continue;
+      float lkk = L[k * dim + k];
+      float r2 = lkk * lkk - w[k] * w[k];
+      if (!(r2 > 0.0f))
+        return false;
+      float r = std::sqrt(r2);
+      float c = lkk / r;
+      float s = w[k] / r;
+      for (int i = k + 1; i < dim; i++)
+        w[i] = c * w[i] - s * L[i * dim + k];
+    }
+  }
+  for (int k = 0; k < dim; k++) {
+    if (v[k] == 0.0f)
+      continue;
+    float lkk = L[k * dim + k];
+    float r = std::sqrt(lkk * lkk + sign * v[k] * v[k]);
+    float c = lkk / r;
+    float s = v[k] / r;
+    L[k * dim + k] = r;
+    for (int i = k + 1; i < dim; i++) {
+      float l_old = L[i * dim + k];
+      L[i * dim + k] = c * l_old + sign * s * v[i];
+      v[i] = c * v[i] - s * l_old;
+    }
+  }
+  return true;
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::predict_sr(float dt) {
+  constexpr int dim = N;
+  constexpr int n_sigma = N_SIGMA;
+  float chi[N * (2 * N + 1)];
+  ut_sigma_points<N>(x_, S_, SIGMA_SCALE, chi);
+
+  // Propagate sigma points in place.
+  for (int k = 0; k < n_sigma; k++) {
+    float x_prop[N];
+    for (int i = 0; i < dim; i++)
+      x_prop[i] = chi[i * n_sigma + k];
+    float x_out[N];
+    state_transition(x_prop, dt, x_out);
+    for (int i = 0; i < dim; i++)
+      chi[i * n_sigma + k] = x_out[i];
+  }
+  for (int i = 0; i < dim; i++) {
+    float acc = WM0 * chi[i * n_sigma];
+    for (int k = 1; k < n_sigma; k++)
+      acc += WM * chi[i * n_sigma + k];
+    x_[i] = acc;
+  }
+
+  // S = qr([sqrt(wc) * (Y_k - x) for k >= 1, sqrt(Q)]), then rank-1 correction for the central point.
+  {
+    float A[(2 * N + N) * N];
+    int rows = 0;
+    float sw = std::sqrt(WC);
+    for (int k = 1; k < n_sigma; k++, rows++)
+      for (int i = 0; i < dim; i++)
+        A[rows * dim + i] = sw * (chi[i * n_sigma + k] - x_[i]);
+    for (int j = 0; j < dim; j++, rows++)
+      for (int i = 0; i < dim; i++)
+        A[rows * dim + i] = (i == j) ? std::sqrt(std::max(q_scale_ * Q_[packed_index(j, j)], 0.0f)) : 0.0f;
+    qr_lower_factor(rows, dim, A, S_);
+  }
+
+  float d0[N];
+  float sw0 = std::sqrt(std::abs(WC0));
+  for (int i = 0; i < dim; i++)
+    d0[i] = sw0 * (chi[i * n_sigma] - x_[i]);
+  if (!cholesky_rank1(dim, S_, d0, WC0 < 0.0f ? -1.0f : 1.0f))
+    sr_downdate_failures_++;
+  p_stale_ = true;
+}
+
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::update_sr(const float *z, const int *idx, int m_avail) {
+  constexpr int dim = N;
+  constexpr int n_sigma = N_SIGMA;
+  float chi[N * (2 * N + 1)];
+  ut_sigma_points<N>(x_, S_, SIGMA_SCALE, chi);
+
+  float z_pred[M];
+  for (int i = 0; i < m_avail; i++) {
+    const float *row = &chi[idx[i] * n_sigma];
+    float acc = WM0 * row[0];
+    for (int k = 1; k < n_sigma; k++)
+      acc += WM * row[k];
+    z_pred[i] = acc;
+  }
+
+  // Sz = qr([sqrt(wc) * (Z_k - z) for k >= 1, sqrt(R)]), then rank-1 correction for the central point.
+  float Sz[M * M];
+  {
+    float A[(2 * N + M) * M];
+    int rows = 0;
+    float sw = std::sqrt(WC);
+    for (int k = 1; k < n_sigma; k++, rows++)
+      for (int i = 0; i < m_avail; i++)
+        A[rows * m_avail + i] = sw * (chi[idx[i] * n_sigma + k] - z_pred[i]);
+    for (int j = 0; j < m_avail; j++, rows++)
+      for (int i = 0; i < m_avail; i++)
+        A[rows * m_avail + i] = (i == j) ? std::sqrt(R_[idx[j] * M + idx[j]]) : 0.0f;
+    qr_lower_factor(rows, m_avail, A, Sz);
+  }
+  float dz0[M];
+  float sw0 = std::sqrt(std::abs(WC0));
   for (int i = 0; i < m_avail; i++)
-    innov[i] = z_avail[i] - z_pred_avail[i];
-  float corr[N_MAX];
+    dz0[i] = sw0 * (chi[idx[i] * n_sigma] - z_pred[i]);
+  if (!cholesky_rank1(m_avail, Sz, dz0, WC0 < 0.0f ? -1.0f : 1.0f))
+    sr_downdate_failures_++;
+
+  // Pxz and the Pzz diagonal before R (for EM).
+  float Pxz[N * M];
+  float Pzz_prior_ii[M];
+  for (int i = 0; i < dim * m_avail; i++)
+    Pxz[i] = 0.0f;
+  for (int i = 0; i < m_avail; i++)
+    Pzz_prior_ii[i] = 0.0f;
+  for (int k = 0; k < n_sigma; k++) {
+    float w = (k == 0) ? WC0 : WC;
+    float dz[M];
+    for (int i = 0; i < m_avail; i++) {
+      dz[i] = chi[idx[i] * n_sigma + k] - z_pred[i];
+      Pzz_prior_ii[i] += w * dz[i] * dz[i];
+    }
+    for (int i = 0; i < dim; i++) {
+      float dx = w * (chi[i * n_sigma + k] - x_[i]);
+      for (int j = 0; j < m_avail; j++)
+        Pxz[i * m_avail + j] += dx * dz[j];
+    }
+  }
+
+  // K = Pxz * (Sz*Sz^T)^{-1}: per state row, forward then back substitution.
+  float K[N * M];
+  for (int i = 0; i < dim; i++) {
+    float y[M];
+    for (int j = 0; j < m_avail; j++) {
+      float acc = Pxz[i * m_avail + j];
+      for (int l = 0; l < j; l++)
+        acc -= Sz[j * m_avail + l] * y[l];
+      y[j] = acc / Sz[j * m_avail + j];
+    }
+    for (int j = m_avail - 1; j >= 0; j--) {
+      float acc = y[j];
+      for (int l = j + 1; l < m_avail; l++)
+        acc -= Sz[l * m_avail + j] * K[i * m_avail + l];
+      K[i * m_avail + j] = acc / Sz[j * m_avail + j];
+    }
+  }
+
+  float innov[M];
+  for (int i = 0; i < m_avail; i++)
+    innov[i] = z[idx[i]] - z_pred[i];
+  float corr[N];
   for (int i = 0; i < dim; i++) {
     float dx = 0.0f;
     for (int j = 0; j < m_avail; j++)
@@ -291,64 +823,171 @@ void HpUkfFilter::update(const float *z, const bool *mask) {
     x_[i] += dx;
   }
 
-  // Joseph form: P = (I - K*H)*P*(I - K*H)' + K*R*K'
-  // H for available measurements: H_avail has rows idx[0..m_avail-1] = identity rows.
-  // (I - K*H) for reduced: I - K*H_avail, H_avail is m_avail x n, rows are unit vectors for idx[].
-  float IKH[N_MAX * N_MAX];
-  for (int i = 0; i < dim * dim; i++)
-    IKH[i] = (i % (dim + 1) == 0) ? 1.0f : 0.0f;
-  for (int i = 0; i < dim; i++)
-    for (int j = 0; j < m_avail; j++)
-      IKH[i * dim + idx[j]] -= K[i * m_avail + j];
-  float P_new[N_MAX * N_MAX];
-  for (int i = 0; i < dim; i++)
-    for (int j = 0; j < dim; j++) {
-      P_new[i * dim + j] = 0.0f;
-      for (int r = 0; r < dim; r++)
-        P_new[i * dim + j] += IKH[i * dim + r] * P_[r * dim + j];
+  // P = P - (K*Sz)*(K*Sz)^T as m_avail rank-1 downdates of S.
+  for (int j = 0; j < m_avail; j++) {
+    float u[N];
+    for (int i = 0; i < dim; i++) {
+      float acc = 0.0f;
+      for (int l = j; l < m_avail; l++)
+        acc += K[i * m_avail + l] * Sz[l * m_avail + j];
+      u[i] = acc;
     }
-  float P_tmp[N_MAX * N_MAX];
-  for (int i = 0; i < dim; i++)
-    for (int j = 0; j < dim; j++) {
-      P_tmp[i * dim + j] = 0.0f;
-      for (int r = 0; r < dim; r++)
-        P_tmp[i * dim + j] += P_new[i * dim + r] * IKH[j * dim + r];
+    if (!cholesky_rank1(dim, S_, u, -1.0f))
+      sr_downdate_failures_++;
+  }
+  p_stale_ = true;
+
+  if (em_enabled_)
+    em_adapt(idx, m_avail, innov, Pzz_prior_ii, corr);
+}
+
+// ---------------------------------------------------------------------------
+// UD filter (FILTER_MODE_UD): P = U*D*U^T with U unit upper triangular. The model is the
+// same linear one as FILTER_MODE_LINEAR_KF (F(dt) adds rate*dt, H selects states 0..3) but
+// the full coupling of P is kept. Only the diagonals of Q and R are used.
+// ---------------------------------------------------------------------------
+
+// UD_ from P_ (upper UD decomposition, last column first). Non-positive pivots are clamped
+// like ut_cholesky does.
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::ud_factor() {
+  constexpr int dim = N;
+  for (int j = dim - 1; j >= 0; j--) {
+    float d = P_[packed_index(j, j)];
+    for (int k = j + 1; k < dim; k++) {
+      float u = UD_[packed_index(j, k)];
+      d -= u * u * UD_[packed_index(k, k)];
     }
-  for (int i = 0; i < dim; i++)
-    for (int j = 0; j < dim; j++) {
-      float KRK = 0.0f;
-      for (int r = 0; r < m_avail; r++)
-        for (int s = 0; s < m_avail; s++)
-          KRK += K[i * m_avail + r] * R_[idx[r] * M + idx[s]] * K[j * m_avail + s];
-      P_[i * dim + j] = P_tmp[i * dim + j] + KRK;
+    if (!(d > 1e-10f))
+      d = 1e-10f;
+    UD_[packed_index(j, j)] = d;
+    float inv_d = 1.0f / d;
+    for (int i = 0; i < j; i++) {
+      float s = P_[packed_index(i, j)];
+      for (int k = j + 1; k < dim; k++)
+        s -= UD_[packed_index(i, k)] * UD_[packed_index(k, k)] * UD_[packed_index(j, k)];
+      UD_[packed_index(i, j)] = s * inv_d;
     }
+  }
+  p_stale_ = false;
+}
 
-  // EM auto-tune: R adaptation then Q adaptation (diagonal, with forgetting factors).
-  if (em_enabled_) {
-    for (int i = 0; i < m_avail; i++) {
-      int g = idx[i];
-      float lambda_r = (g <= 1) ? em_lambda_r_inlet_ : em_lambda_r_outlet_;
-      float r_est = innov[i] * innov[i] - Pzz_prior_ii[i];
-      if (r_est < R_MIN)
-        r_est = R_MIN;
-      r_est *= (1.0f + em_inflation_);
-      float r_old = R_[g * M + g];
-      R_[g * M + g] = lambda_r * r_old + (1.0f - lambda_r) * r_est;
-      if (R_[g * M + g] < R_MIN)
-        R_[g * M + g] = R_MIN;
+// Thornton time update: P = (F*U) * D * (F*U)^T + Q = W * diag(D, Q) * W^T with W = [F*U | I],
+// re-factored by modified weighted Gram-Schmidt on the rows of W (last row first).
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::predict_ud(float dt) {
+  constexpr int dim = N;
+  constexpr int cols = 2 * N;
+  float W[N * 2 * N];
+  float Dw[2 * N];
+  for (int i = 0; i < dim; i++) {
+    for (int k = 0; k < dim; k++) {
+      W[i * cols + k] = (k == i) ? 1.0f : (k > i ? UD_[packed_index(i, k)] : 0.0f);
+      W[i * cols + dim + k] = (k == i) ? 1.0f : 0.0f;
+    }
+    Dw[i] = UD_[packed_index(i, i)];
+    Dw[dim + i] = std::max(q_scale_ * Q_[packed_index(i, i)], 0.0f);
+  }
+  if constexpr (dim >= 8) {
+    // Row c of F*U is row c of U plus dt times row RATE_INDEX[c]; F*x likewise.
+    for (int c = 0; c < M; c++) {
+      int r = RATE_INDEX[c];
+      for (int k = r; k < dim; k++)
+        W[c * cols + k] += dt * W[r * cols + k];
+      x_[c] += dt * x_[r];
+    }
+  }
+
+  for (int i = dim - 1; i >= 0; i--) {
+    float *wi = &W[i * cols];
+    float dwi[2 * N];
+    float d = 0.0f;
+    for (int k = 0; k < cols; k++) {
+      dwi[k] = Dw[k] * wi[k];
+      d += wi[k] * dwi[k];
+    }
+    if (!(d > 1e-10f))
+      d = 1e-10f;
+    UD_[packed_index(i, i)] = d;
+    float inv_d = 1.0f / d;
+    for (int j = 0; j < i; j++) {
+      float *wj = &W[j * cols];
+      float s = 0.0f;
+      for (int k = 0; k < cols; k++)
+        s += wj[k] * dwi[k];
+      float u = s * inv_d;
+      UD_[packed_index(j, i)] = u;
+      for (int k = 0; k < cols; k++)
+        wj[k] -= u * wi[k];
+    }
+  }
+  p_stale_ = true;
+}
+
+// Bierman measurement update, one scalar per available channel (H = e_c). EM sees the prior
+// innovations, prior P_cc and the total correction, as in the batch update.
+template<int NX, int NZ>
+void HpUkfFilterT<NX, NZ>::update_ud(const float *z, const int *idx, int m_avail) {
+  constexpr int dim = N;
+  float innov_prior[M];
+  float Pzz_prior_ii[M];
+  float x_prior[N];
+  for (int i = 0; i < m_avail; i++) {
+    int c = idx[i];
+    innov_prior[i] = z[c] - x_[c];
+    // P_cc = sum_{k >= c} U_ck^2 * D_k
+    float pcc = UD_[packed_index(c, c)];
+    for (int k = c + 1; k < dim; k++) {
+      float u = UD_[packed_index(c, k)];
+      pcc += u * u * UD_[packed_index(k, k)];
     }
+    Pzz_prior_ii[i] = pcc;
+  }
+  for (int i = 0; i < dim; i++)
+    x_prior[i] = x_[i];
+
+  for (int i = 0; i < m_avail; i++) {
+    int c = idx[i];
+    // f = U^T * e_c (zero before c), g = D * f. Columns j < c are untouched by the update.
+    float f[N], g[N];
     for (int j = 0; j < dim; j++) {
-      float q_est = corr[j] * corr[j];
-      if (q_est < Q_MIN)
-        q_est = Q_MIN;
-      q_est *= (1.0f + em_inflation_);
-      float q_old = Q_[j * dim + j];
-      Q_[j * dim + j] = em_lambda_q_ * q_old + (1.0f - em_lambda_q_) * q_est;
-      if (Q_[j * dim + j] < Q_MIN)
-        Q_[j * dim + j] = Q_MIN;
+      f[j] = (j < c) ? 0.0f : (j == c ? 1.0f : UD_[packed_index(c, j)]);
+      g[j] = UD_[packed_index(j, j)] * f[j];
     }
+    float alpha = R_[c * M + c];
+    if (!(alpha > 0.0f))
+      continue;  // only reachable with a non-positive R from set_measurement_noise
+    float gamma = 1.0f / alpha;
+    for (int j = c; j < dim; j++) {
+      float beta = alpha;
+      alpha += f[j] * g[j];
+      float lambda = -f[j] * gamma;
+      gamma = 1.0f / alpha;
+      UD_[packed_index(j, j)] *= beta * gamma;
+      for (int k = 0; k < j; k++) {
+        float &u = UD_[packed_index(k, j)];
+        float u_old = u;
+        u = u_old + g[k] * lambda;
+        g[k] += g[j] * u_old;
+      }
+    }
+    // g now holds the unnormalized gain: K = g / alpha.
+    float dz = (z[c] - x_[c]) * gamma;
+    for (int j = 0; j < dim; j++)
+      x_[j] += g[j] * dz;
+  }
+  p_stale_ = true;
+
+  if (em_enabled_) {
+    float corr[N];
+    for (int i = 0; i < dim; i++)
+      corr[i] = x_[i] - x_prior[i];
+    em_adapt(idx, m_avail, innov_prior, Pzz_prior_ii, corr);
   }
 }
 
+template class HpUkfFilterT<4>;
+template class HpUkfFilterT<8>;
+
 }  // namespace hp_ukf
 }  // namespace esphome
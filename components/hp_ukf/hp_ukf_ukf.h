@@ -1,24 +1,85 @@
 #pragma once
 
+#include <cstdint>
+#include "hp_ukf_gate.h"
+#include "hp_ukf_unscented.h"
+
 namespace esphome {
 namespace hp_ukf {
 
-// Time-discrete Unscented Kalman Filter for heat pump inlet/outlet state.
-// State (n=8): [T_in, RH_in, T_out, RH_out, dT_in, dT_out, dRH_in, dRH_out].
-// Measurements (m=4): [T_in, RH_in, T_out, RH_out].
-// Supports n=4 (no derivatives) or n=8 (with all derivatives).
-class HpUkfFilter {
- public:
-  static constexpr int N_MAX = 8;
-  static constexpr int M = 4;
+// Covariance representation used by the filter.
+// FILTER_MODE_UKF: full covariance P, refactored (Cholesky) for every sigma point draw.
+// FILTER_MODE_SR_UKF: square-root UKF; keeps lower-triangular S with P = S*S^T and updates it
+//   with QR and rank-1 Cholesky up/downdates, so P stays PSD without refactorization.
+// FILTER_MODE_LINEAR_KF: exact linear Kalman filter for the constant-velocity model. Each
+//   measured channel and its rate form an independent 2x2 block of P (cross-channel terms are
+//   zero for diagonal P0, Q and R), so predict/update are closed-form per block.
+// FILTER_MODE_UD: linear Kalman filter on P = U*D*U^T (U unit upper triangular, D diagonal),
+//   with Thornton's time update and Bierman's scalar measurement update. Keeps the full
+//   coupling of P and stays PSD in float without a Joseph form or square roots.
+enum FilterMode {
+  FILTER_MODE_UKF = 0,
+  FILTER_MODE_SR_UKF,
+  FILTER_MODE_LINEAR_KF,
+  FILTER_MODE_UD,
+};
 
-  HpUkfFilter() = default;
+// Default noise diagonals (from EM-converged log copy-paste), shared by HpUkfFilterT and
+// HpUkfFixedFilterT. Q follows the state order, R the measurement order.
+constexpr float DEFAULT_Q_DIAG[8] = {
+    0.02255297f,   // T_in °C²
+    0.03863900f,   // RH_in %²
+    0.03064128f,   // T_out °C²
+    0.04204632f,   // RH_out %²
+    0.004649542f,  // dT_in
+    0.005577928f,  // dT_out
+    0.007255317f,  // dRH_in
+    0.007194013f,  // dRH_out
+};
+constexpr float DEFAULT_R_DIAG[4] = {
+    0.1317456f,     // T_in °C²
+    0.2825074f,     // RH_in %²
+    0.001090135f,   // T_out °C²
+    0.0002252902f,  // RH_out %²
+};
 
-  // Configure state dimension: 4 (no derivatives) or 8 (with dT_in, dT_out, dRH_in, dRH_out).
-  void set_state_dimension(int n);
-  int get_state_dimension() const { return n_; }
+// Time-discrete Unscented Kalman Filter for heat pump inlet/outlet state.
+// State (N=8): [T_in, RH_in, T_out, RH_out, dT_in, dT_out, dRH_in, dRH_out].
+// Measurements (M=4): [T_in, RH_in, T_out, RH_out].
+// N=4 (no derivatives) or N=8 (with all derivatives) is a template parameter, so storage is
+// sized exactly, weights are constexpr and the derivative branches compile away.
+// hp_ukf_ukf.cpp instantiates HpUkfFilterT<4> and HpUkfFilterT<8>.
+template<int NX, int NZ = 4> class HpUkfFilterT {
+  static_assert(NX == 4 || NX == 8, "HP-UKF state dimension must be 4 or 8");
+  static_assert(NZ == 4, "HP-UKF measures exactly T_in, RH_in, T_out, RH_out");
 
-  // Set initial state and covariance. Call once before first predict/update.
+ public:
+  static constexpr int N = NX;
+  static constexpr int M = NZ;
+  // P and Q are symmetric and stored packed: upper triangle row by row, N*(N+1)/2 floats.
+  static constexpr int N_PACKED = N * (N + 1) / 2;
+  static constexpr int packed_index(int i, int j) {
+    return ut_packed_index<N>(i, j);
+  }
+
+  // Sets the default process/measurement noise (DEFAULT_Q_DIAG, DEFAULT_R_DIAG).
+  HpUkfFilterT();
+
+  static constexpr int get_state_dimension() { return N; }
+
+  // Select covariance representation (see FilterMode). The current covariance is converted,
+  // so it may be called before or after set_initial_state.
+  // LINEAR_KF drops covariance terms outside the per-channel position/rate blocks.
+  void set_filter_mode(FilterMode mode);
+  FilterMode get_filter_mode() const { return mode_; }
+
+  // UKF mode: process available measurements one at a time as scalar updates on P (exact
+  // for the state-selecting H and diagonal R). No Pzz inverse; each channel is a rank-1
+  // Joseph correction and masked channels cost nothing.
+  void set_sequential_update(bool enable) { sequential_update_ = enable; }
+  bool get_sequential_update() const { return sequential_update_; }
+
+  // Set initial state and covariance (full N x N, upper triangle is used). Call once before first predict/update.
   void set_state(const float *x);
   void set_covariance(const float *P);
   void set_initial_state(const float *x, const float *P);
@@ -29,14 +90,41 @@ class HpUkfFilter {
   // Update with measurement z[4] and mask (true = measurement available).
   void update(const float *z, const bool *mask);
 
-  // Current state and covariance (read-only).
-  const float *get_state() const { return x_; }
-  const float *get_covariance() const { return P_; }
+  // predict(dt) followed by update(z, mask) in one pass. In UKF mode the update reuses the
+  // statistics of the propagated sigma points (with Q added) instead of redrawing sigma points
+  // from the predicted P, saving one Cholesky factorization and the second sigma matrix.
+  void predict_update(float dt, const float *z, const bool *mask);
 
-  // Optional: set process/measurement noise (defaults set in .cpp).
+  // Current state and covariance. In SR mode P is rebuilt from S on demand.
+  // get_covariance expands to a full N x N matrix; get_covariance_packed returns the N_PACKED
+  // storage (see packed_index).
+  const float *get_state() const { return x_; }
+  void get_covariance(float *P) const;
+  const float *get_covariance_packed() const;
+
+  // SR mode: number of rank-1 downdates skipped because they would make P indefinite.
+  // Skipping keeps S valid (P slightly conservative) instead of clamping pivots silently.
+  uint32_t get_sr_downdate_failures() const { return sr_downdate_failures_; }
+
+  // Innovation gate (see HpUkfInnovationGate): channels with NIS above sigma^2 are dropped
+  // before the gain is applied and excluded from EM; persistent rejections and a high mean NIS
+  // soft-reset P. sigma 0 (default) disables both.
+  void set_innovation_gate(float sigma) { gate_.set_threshold(sigma * sigma); }
+  void set_gate_max_rejections(uint16_t n) { gate_.set_max_rejections(n); }
+  void set_divergence_nis(float nis) { gate_.set_divergence_nis(nis); }
+  uint32_t get_rejected_count() const { return gate_.get_rejected_count(); }
+  uint32_t get_reset_count() const { return gate_.get_reset_count(); }
+
+  // Optional: set process/measurement noise (defaults set in .cpp). Full matrices; Q is symmetric
+  // and only its upper triangle is used.
   void set_process_noise(const float *Q);
   void set_measurement_noise(const float *R);
 
+  // Q is the process noise of one nominal step. A caller that steps at a varying interval sets
+  // dt / nominal before predict so a long step adds the noise of the whole gap (EM keeps
+  // estimating Q per nominal step). Default 1.
+  void set_process_noise_scale(float scale) { q_scale_ = scale; }
+
   // EM auto-tune: separate forgetting factors for Q and for R (inlet vs outlet).
   void enable_em_autotune(bool enable) { em_enabled_ = enable; }
   void set_em_lambda_q(float v) { em_lambda_q_ = v; }
@@ -48,40 +136,77 @@ class HpUkfFilter {
   float get_em_lambda_r_inlet() const { return em_lambda_r_inlet_; }
   float get_em_lambda_r_outlet() const { return em_lambda_r_outlet_; }
 
-  // Getters for diagonal Q and R (for sensor exposure). q_diag has n_ elements, r_diag has M.
+  // Getters for diagonal Q and R (for sensor exposure). q_diag has N elements, r_diag has M.
   void get_process_noise_diag(float *q_diag) const;
   void get_measurement_noise_diag(float *r_diag) const;
 
  private:
-  int n_{8};
-  float x_[N_MAX]{};
-  float P_[N_MAX * N_MAX]{};
-  float Q_[N_MAX * N_MAX]{};
+  FilterMode mode_{FILTER_MODE_UKF};
+  bool sequential_update_{false};
+  float x_[N]{};
+  // In SR mode P_ is a cache of S_*S_^T, refreshed lazily by get_covariance().
+  mutable float P_[N_PACKED]{};
+  mutable bool p_stale_{false};
+  float S_[N * N]{};
+  // UD mode: packed like P_, diagonal slots hold D and the strict upper triangle holds U.
+  float UD_[N_PACKED]{};
+  uint32_t sr_downdate_failures_{0};
+  float Q_[N_PACKED]{};
   float R_[M * M]{};
+  float q_scale_{1.0f};
+  HpUkfInnovationGate gate_;
 
   bool em_enabled_{false};
   float em_lambda_q_{0.995f};
   float em_lambda_r_inlet_{0.998f};
   float em_lambda_r_outlet_{0.98f};
   float em_inflation_{0.5f};
+  // Rate state for each measured channel: T_in->dT_in, RH_in->dRH_in, T_out->dT_out, RH_out->dRH_out.
+  static constexpr int RATE_INDEX[M] = {4, 6, 5, 7};
   static constexpr float R_MIN = 1e-6f;
   static constexpr float Q_MIN = 1e-10f;
 
-  // UKF parameters: alpha, beta, kappa -> lambda = alpha^2 * (n + kappa) - n
-  // alpha must be >= 1 (or kappa large) so lambda >= 0; else weights are invalid and P becomes non-PSD -> NaN state
-  float alpha_{1.0f};
-  float beta_{2.0f};
-  float kappa_{0.0f};
-  float lambda_{0.0f};
-  float wm0_{0.0f};
-  float wc0_{0.0f};
-  float wm_{0.0f};
-  float wc_{0.0f};
-
-  void update_weights();
+  // UKF weights (hp_ukf_unscented.h).
+  using UT = UnscentedWeights<N>;
+  static constexpr float WM0 = UT::WM0;
+  static constexpr float WC0 = UT::WC0;
+  static constexpr float WM = UT::WM;
+  static constexpr float WC = UT::WC;
+  static constexpr float SIGMA_SCALE = UT::SIGMA_SCALE;
+  static constexpr int N_SIGMA = UT::N_SIGMA;
+
   void state_transition(const float *x_in, float dt, float *x_out) const;
-  void cholesky_factor(int dim, const float *A, float *L) const;
-  void sigma_points(int dim, float *chi) const;
+  void sigma_points(float *chi) const;
+  void em_adapt(const int *idx, int m_avail, const float *innov, const float *pzz_prior_ii, const float *corr);
+  // Prior P_cc of a measured channel in the current representation.
+  float channel_variance(int c) const;
+  // Runs the innovation gate on mask (in place); applies a soft reset if it asks for one.
+  void gate_measurements(const float *z, bool *mask);
+  // P = scale * P + diag(add) on the measured channels, refactored for SR and UD.
+  void soft_reset(float scale, const float *add);
+
+  // Standard UKF (FILTER_MODE_UKF). idx lists the m_avail available measurement indices.
+  void predict_ukf(float dt);
+  void update_ukf(const float *z, const int *idx, int m_avail);
+  void correct_ukf(const float *z, const int *idx, int m_avail, const float *z_pred_avail, float *Pzz,
+                   const float *Pxz);
+  void update_sequential(const float *z, const int *idx, int m_avail);
+
+  // Linear KF on per-channel 2x2 blocks (FILTER_MODE_LINEAR_KF).
+  void predict_linear(float dt);
+  void update_linear(const float *z, const int *idx, int m_avail);
+  void project_channel_blocks();
+
+  // Square-root UKF helpers (FILTER_MODE_SR_UKF).
+  void predict_sr(float dt);
+  void update_sr(const float *z, const int *idx, int m_avail);
+  static void qr_lower_factor(int rows, int dim, float *A, float *L);
+  static bool cholesky_rank1(int dim, float *L, float *v, float sign);
+
+  // UD helpers (FILTER_MODE_UD). Only the diagonals of Q and R are used.
+  void ud_factor();
+  void predict_ud(float dt);
+  void update_ud(const float *z, const int *idx, int m_avail);
 };
 
 }  // namespace hp_ukf
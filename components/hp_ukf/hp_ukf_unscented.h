@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cmath>
+
+namespace esphome {
+namespace hp_ukf {
+
+// Unscented transform pieces shared by HpUkfFilterT and psychro_unscented (no ESPHome headers).
+// Matrices are row-major; symmetric inputs are packed like HpUkfFilterT::P (upper triangle row
+// by row, see ut_packed_index).
+
+// Compile-time constant square root (Newton iteration) for constexpr sigma point scaling.
+constexpr float constexpr_sqrt(float v, float guess = 1.0f, int iter = 0) {
+  return (iter >= 32 || v <= 0.0f) ? (v <= 0.0f ? 0.0f : guess)
+                                    : constexpr_sqrt(v, 0.5f * (guess + v / guess), iter + 1);
+}
+
+template<int N> constexpr int ut_packed_index(int i, int j) {
+  return i <= j ? i * N - i * (i - 1) / 2 + (j - i) : j * N - j * (j - 1) / 2 + (i - j);
+}
+
+// Sigma point weights for dimension N: alpha, beta, kappa -> lambda = alpha^2 * (n + kappa) - n.
+// alpha must be >= 1 (or kappa large) so lambda >= 0; else weights are invalid and P becomes
+// non-PSD -> NaN state.
+template<int N> struct UnscentedWeights {
+  static constexpr float ALPHA = 1.0f;
+  static constexpr float BETA = 2.0f;
+  static constexpr float KAPPA = 0.0f;
+  static constexpr float LAMBDA = ALPHA * ALPHA * (N + KAPPA) - N;
+  static constexpr float WM0 = LAMBDA / (N + LAMBDA);
+  static constexpr float WC0 = LAMBDA / (N + LAMBDA) + (1.0f - ALPHA * ALPHA + BETA);
+  static constexpr float WM = 0.5f / (N + LAMBDA);
+  static constexpr float WC = 0.5f / (N + LAMBDA);
+  static constexpr float SIGMA_SCALE = constexpr_sqrt(N + LAMBDA);  // sqrt(n + lambda)
+  static constexpr int N_SIGMA = 2 * N + 1;
+  static_assert(LAMBDA >= 0.0f, "UKF weights require lambda >= 0");
+};
+
+// Lower-triangular L (full N x N) with L*L^T = A, A packed. A non-positive pivot becomes 1e-5
+// so the factor stays usable.
+template<int N> void ut_cholesky(const float *A, float *L) {
+  // One reciprocal per column instead of a divide per element.
+  float inv_diag[N];
+  for (int i = 0; i < N * N; i++)
+    L[i] = 0.0f;
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j <= i; j++) {
+      float s = A[ut_packed_index<N>(j, i)];
+      for (int k = 0; k < j; k++)
+        s -= L[i * N + k] * L[j * N + k];
+      if (i == j) {
+        float d = (s > 1e-10f) ? std::sqrt(s) : 1e-5f;
+        L[i * N + j] = d;
+        inv_diag[j] = 1.0f / (d + 1e-10f);
+      } else {
+        L[i * N + j] = s * inv_diag[j];
+      }
+    }
+  }
+}
+
+// chi: (2n+1) columns, each column length n. Stored row-major as chi[n * (2*n+1)]:
+// x, then x + scale * L columns, then x - scale * L columns.
+template<int N> void ut_sigma_points(const float *x, const float *L, float scale, float *chi) {
+  for (int i = 0; i < N; i++)
+    chi[i * (2 * N + 1)] = x[i];
+  for (int j = 0; j < N; j++) {
+    for (int i = 0; i < N; i++) {
+      float d = scale * L[i * N + j];
+      chi[i * (2 * N + 1) + j + 1] = x[i] + d;
+      chi[i * (2 * N + 1) + N + 1 + j] = x[i] - d;
+    }
+  }
+}
+
+}  // namespace hp_ukf
+}  // namespace esphome
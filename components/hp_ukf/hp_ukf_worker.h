@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace esphome {
+namespace hp_ukf {
+
+// Concurrency layer of `worker_task`: the main loop produces measurements and consumes
+// estimates, the worker task does the opposite. Each direction has exactly one producer and
+// one consumer, so plain atomics suffice (no locks on the main loop). The thread itself is a
+// FreeRTOS task on ESP32 and a std::thread elsewhere, so the same code runs on a host.
+
+// Bounded FIFO. push() only from the producer, pop() only from the consumer.
+template<typename T, int CAP> class SpscRing {
+  static_assert(CAP > 0 && (CAP & (CAP - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  bool push(const T &v) {
+    uint32_t head = head_.load(std::memory_order_relaxed);
+    if (head - tail_.load(std::memory_order_acquire) >= CAP)
+      return false;
+    buf_[head & (CAP - 1)] = v;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+  bool pop(T &v) {
+    uint32_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire))
+      return false;
+    v = buf_[tail & (CAP - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T buf_[CAP];
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+};
+
+// Latest-value exchange (triple buffer): the producer fills write_buffer() and publish()es it,
+// the consumer takes the newest published value with consume() and reads read_buffer(). Neither
+// side ever waits, and the consumer never sees a partly written value; intermediate values the
+// consumer did not pick up are overwritten.
+template<typename T> class SpscSnapshot {
+ public:
+  T &write_buffer() { return buf_[back_]; }
+  void publish() { back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX; }
+
+  // True if a value was published since the last consume(); read_buffer() then holds it.
+  bool consume() {
+    if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0)
+      return false;
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+  const T &read_buffer() const { return buf_[front_]; }
+
+ private:
+  static constexpr uint8_t INDEX = 0x03;
+  static constexpr uint8_t FRESH = 0x04;
+  T buf_[3]{};
+  std::atomic<uint8_t> middle_{1};
+  uint8_t back_{0};   // producer only
+  uint8_t front_{2};  // consumer only
+};
+
+// Worker thread with a wake-up signal: notify() from the main loop, wait() in the worker.
+// Notifications collapse, so the worker must drain its input queue after each wake-up.
+class WorkerThread {
+ public:
+  using Entry = void (*)(void *arg);
+
+#ifdef USE_ESP32
+  // core is clamped to the available cores; stack_size in bytes.
+  bool start(const char *name, uint32_t stack_size, int priority, int core, Entry entry, void *arg) {
+    if (core >= portNUM_PROCESSORS)
+      core = portNUM_PROCESSORS - 1;
+    return xTaskCreatePinnedToCore(entry, name, stack_size, arg, priority, &task_, core) == pdPASS;
+  }
+  void notify() {
+    if (task_ != nullptr)
+      xTaskNotifyGive(task_);
+  }
+  void wait() { ulTaskNotifyTake(pdTRUE, portMAX_DELAY); }
+
+ private:
+  TaskHandle_t task_{nullptr};
+#else
+  // Host build: name, stack size, priority and core are ignored. The thread runs until the
+  // process exits (like the FreeRTOS task), so it is detached.
+  bool start(const char * /*name*/, uint32_t /*stack_size*/, int /*priority*/, int /*core*/, Entry entry,
+             void *arg) {
+    std::thread(entry, arg).detach();
+    return true;
+  }
+  void notify() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_ = true;
+    }
+    cv_.notify_one();
+  }
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_; });
+    pending_ = false;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool pending_{false};
+#endif
+};
+
+}  // namespace hp_ukf
+}  // namespace esphome
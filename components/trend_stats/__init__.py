@@ -0,0 +1,84 @@
+"""Sliding-window trend statistics external component for ESPHome."""
+
+import esphome.config_validation as cv
+import esphome.codegen as cg
+from esphome.const import (
+    CONF_DURATION,
+    CONF_ID,
+    CONF_SENSOR,
+    STATE_CLASS_MEASUREMENT,
+    UNIT_PERCENT,
+)
+from esphome.components import sensor
+
+DEPENDENCIES = ["sensor"]
+
+trend_stats_ns = cg.esphome_ns.namespace("trend_stats")
+TrendStatsComponent = trend_stats_ns.class_("TrendStatsComponent", cg.Component)
+TrendCounter = trend_stats_ns.enum("TrendCounter")
+
+CONF_USE_RAW_STATE = "use_raw_state"
+CONF_WINDOWS = "windows"
+CONF_PUBLISH_INTERVAL = "publish_interval"
+CONF_DATAPOINTS = "datapoints"
+CONF_REVERSAL_RATE = "reversal_rate"
+CONF_DOUBLE_REVERSAL_RATE = "double_reversal_rate"
+CONF_NON_REVERSAL_RATE = "non_reversal_rate"
+CONF_FLATLINE_RATE = "flatline_rate"
+
+MAX_WINDOWS = 4
+
+RATE_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_PERCENT,
+    accuracy_decimals=2,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+
+# (key, counter, schema)
+WINDOW_SENSORS = [
+    (
+        CONF_DATAPOINTS,
+        TrendCounter.TREND_DATAPOINTS,
+        sensor.sensor_schema(accuracy_decimals=0, state_class=STATE_CLASS_MEASUREMENT),
+    ),
+    (CONF_REVERSAL_RATE, TrendCounter.TREND_REVERSALS, RATE_SCHEMA),
+    (CONF_DOUBLE_REVERSAL_RATE, TrendCounter.TREND_DOUBLE_REVERSALS, RATE_SCHEMA),
+    (CONF_NON_REVERSAL_RATE, TrendCounter.TREND_NON_REVERSALS, RATE_SCHEMA),
+    (CONF_FLATLINE_RATE, TrendCounter.TREND_FLATLINES, RATE_SCHEMA),
+]
+
+WINDOW_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_DURATION): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(min=cv.TimePeriod(seconds=1))
+        ),
+        cv.Optional(CONF_PUBLISH_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+        **{cv.Optional(key): schema for key, _, schema in WINDOW_SENSORS},
+    }
+)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(TrendStatsComponent),
+        cv.Required(CONF_SENSOR): cv.use_id(sensor.Sensor),
+        cv.Optional(CONF_USE_RAW_STATE, default=True): cv.boolean,
+        cv.Required(CONF_WINDOWS): cv.All(
+            cv.ensure_list(WINDOW_SCHEMA), cv.Length(min=1, max=MAX_WINDOWS)
+        ),
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    source = await cg.get_variable(config[CONF_SENSOR])
+    cg.add(var.set_source(source))
+    cg.add(var.set_use_raw_state(config[CONF_USE_RAW_STATE]))
+    for i, window in enumerate(config[CONF_WINDOWS]):
+        cg.add(var.add_window(window[CONF_DURATION], window[CONF_PUBLISH_INTERVAL]))
+        for key, counter, _ in WINDOW_SENSORS:
+            if key in window:
+                sens = await sensor.new_sensor(window[key])
+                cg.add(var.set_window_sensor(i, counter, sens))
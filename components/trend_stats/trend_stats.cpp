@@ -0,0 +1,99 @@
+#include "trend_stats.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <cmath>
+
+namespace esphome {
+namespace trend_stats {
+
+static const char *const TAG = "trend_stats";
+
+static const char *counter_to_string(int c) {
+  switch (c) {
+    case TREND_DATAPOINTS:
+      return "datapoints";
+    case TREND_REVERSALS:
+      return "reversal rate";
+    case TREND_DOUBLE_REVERSALS:
+      return "double reversal rate";
+    case TREND_NON_REVERSALS:
+      return "non-reversal rate";
+    case TREND_FLATLINES:
+      return "flatline rate";
+    default:
+      return "?";
+  }
+}
+
+void TrendStatsComponent::add_window(uint32_t duration_ms, uint32_t publish_interval_ms) {
+  windows_.emplace_back();
+  windows_.back().counts.set_duration(duration_ms);
+  windows_.back().publish_interval_ms = publish_interval_ms;
+}
+
+void TrendStatsComponent::set_window_sensor(int window, TrendCounter counter, sensor::Sensor *s) {
+  if (window >= 0 && window < (int) windows_.size() && counter < TREND_COUNTER_COUNT)
+    windows_[window].sensors[counter] = s;
+}
+
+void TrendStatsComponent::setup() {
+  if (source_ == nullptr) {
+    ESP_LOGE(TAG, "No source sensor");
+    this->mark_failed();
+    return;
+  }
+  uint32_t now = millis();
+  for (auto &w : windows_)
+    w.counts.advance(now);
+  if (use_raw_) {
+    source_->add_on_raw_state_callback([this](float value) { this->on_value_(value); });
+  } else {
+    source_->add_on_state_callback([this](float value) { this->on_value_(value); });
+  }
+  // windows_ is not resized after codegen, so the element pointers stay valid.
+  for (auto &w : windows_) {
+    Window *wp = &w;
+    this->set_interval(w.publish_interval_ms, [this, wp]() { this->publish_window_(*wp); });
+  }
+}
+
+void TrendStatsComponent::on_value_(float value) {
+  uint8_t hits = classifier_.classify(value);
+  if (hits == 0)
+    return;
+  uint32_t now = millis();
+  for (auto &w : windows_)
+    w.counts.add(now, hits);
+}
+
+// Rates are in % of the datapoints in the window; NaN while the window is empty.
+void TrendStatsComponent::publish_window_(Window &w) {
+  w.counts.advance(millis());
+  uint32_t n = w.counts.sum(TREND_DATAPOINTS);
+  for (int c = 0; c < TREND_COUNTER_COUNT; c++) {
+    sensor::Sensor *s = w.sensors[c];
+    if (s == nullptr)
+      continue;
+    if (c == TREND_DATAPOINTS) {
+      s->publish_state((float) n);
+    } else {
+      s->publish_state(n > 0 ? 100.0f * (float) w.counts.sum((TrendCounter) c) / (float) n : NAN);
+    }
+  }
+}
+
+void TrendStatsComponent::dump_config() {
+  ESP_LOGCONFIG(TAG, "Trend stats:");
+  ESP_LOGCONFIG(TAG, "  Source: %s state", use_raw_ ? "raw" : "filtered");
+  for (size_t i = 0; i < windows_.size(); i++) {
+    const Window &w = windows_[i];
+    ESP_LOGCONFIG(TAG, "  Window %u: %u ms (%d buckets), published every %u ms", (unsigned) i,
+                  (unsigned) w.counts.get_duration(), TrendWindow::BUCKETS, (unsigned) w.publish_interval_ms);
+    for (int c = 0; c < TREND_COUNTER_COUNT; c++)
+      if (w.sensors[c] != nullptr)
+        ESP_LOGCONFIG(TAG, "    %s", counter_to_string(c));
+  }
+}
+
+}  // namespace trend_stats
+}  // namespace esphome
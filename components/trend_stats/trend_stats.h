@@ -0,0 +1,43 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/components/sensor/sensor.h"
+#include "trend_stats_window.h"
+#include <vector>
+
+namespace esphome {
+namespace trend_stats {
+
+// Trend statistics of one source sensor over several sliding windows. Every value is classified
+// once and counted into all windows; each window publishes its sensors together on its own
+// interval.
+class TrendStatsComponent : public Component {
+ public:
+  void set_source(sensor::Sensor *source) { source_ = source; }
+  void set_use_raw_state(bool use_raw) { use_raw_ = use_raw; }
+  // Windows are added in order; set_window_sensor() refers to them by that index.
+  void add_window(uint32_t duration_ms, uint32_t publish_interval_ms);
+  void set_window_sensor(int window, TrendCounter counter, sensor::Sensor *s);
+
+  void setup() override;
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::DATA; }
+
+ protected:
+  struct Window {
+    TrendWindow counts;
+    uint32_t publish_interval_ms;
+    sensor::Sensor *sensors[TREND_COUNTER_COUNT]{};
+  };
+
+  void on_value_(float value);
+  void publish_window_(Window &w);
+
+  sensor::Sensor *source_{nullptr};
+  bool use_raw_{true};
+  TrendClassifier classifier_;
+  std::vector<Window> windows_;
+};
+
+}  // namespace trend_stats
+}  // namespace esphome
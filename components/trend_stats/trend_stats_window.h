@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace trend_stats {
+
+// Trend classification and bucketed sliding-window counters (no ESPHome headers, so host tools
+// can use them).
+
+enum TrendCounter : uint8_t {
+  TREND_DATAPOINTS = 0,
+  TREND_REVERSALS,
+  TREND_DOUBLE_REVERSALS,
+  TREND_NON_REVERSALS,
+  TREND_FLATLINES,
+  TREND_COUNTER_COUNT,
+};
+
+// Same rules as the trend_stats.yaml lambda. classify() returns a bit mask (1 << TrendCounter)
+// of the counters the value increments; NaN increments nothing.
+struct TrendClassifier {
+  float previous{NAN};
+  int8_t trend{0};  // -1 down, 0 neutral, 1 up
+  bool reversal_pending{false};
+
+  uint8_t classify(float x) {
+    if (std::isnan(x))
+      return 0;
+    uint8_t hits = 1u << TREND_DATAPOINTS;
+    if (std::isnan(previous)) {
+      previous = x;
+      trend = 0;
+      return hits;
+    }
+    if (x == previous)
+      return hits | (1u << TREND_FLATLINES);
+    int8_t current = x > previous ? 1 : -1;
+    if (trend != 0 && current != trend) {
+      hits |= 1u << TREND_REVERSALS;
+      if (reversal_pending) {
+        hits |= 1u << TREND_DOUBLE_REVERSALS;
+        reversal_pending = false;
+      } else {
+        reversal_pending = true;
+      }
+    } else {
+      if (trend != 0)
+        hits |= 1u << TREND_NON_REVERSALS;
+      reversal_pending = false;
+    }
+    previous = x;
+    trend = current;
+    return hits;
+  }
+};
+
+// Counts over the last BUCKETS buckets of duration / BUCKETS each (the newest bucket is partly
+// filled, so the covered span is between duration - 1 bucket and duration). Running sums make
+// add() and sum() O(1); a bucket leaves the sums when it is reused. Per-bucket counters are
+// 16 bit and saturate, so memory is fixed at ~630 bytes per window.
+class TrendWindow {
+ public:
+  static constexpr int BUCKETS = 60;
+
+  void set_duration(uint32_t duration_ms) {
+    bucket_ms_ = duration_ms / BUCKETS > 0 ? duration_ms / BUCKETS : 1;
+  }
+  uint32_t get_duration() const { return bucket_ms_ * BUCKETS; }
+
+  void add(uint32_t now_ms, uint8_t hits) {
+    this->advance(now_ms);
+    uint16_t *bucket = counts_[head_];
+    for (int c = 0; c < TREND_COUNTER_COUNT; c++) {
+      if ((hits & (1u << c)) != 0 && bucket[c] != UINT16_MAX) {
+        bucket[c]++;
+        sums_[c]++;
+      }
+    }
+  }
+
+  // Retires the buckets that ended before now_ms. Wrap-safe for millis().
+  void advance(uint32_t now_ms) {
+    if (!started_) {
+      started_ = true;
+      head_start_ms_ = now_ms;
+      return;
+    }
+    uint32_t elapsed = now_ms - head_start_ms_;
+    if (elapsed < bucket_ms_)
+      return;
+    uint32_t steps = elapsed / bucket_ms_;
+    if (steps >= static_cast<uint32_t>(BUCKETS)) {
+      this->clear();
+      started_ = true;
+      head_start_ms_ = now_ms - elapsed % bucket_ms_;
+      return;
+    }
+    for (uint32_t s = 0; s < steps; s++) {
+      head_ = head_ + 1 < BUCKETS ? head_ + 1 : 0;
+      for (int c = 0; c < TREND_COUNTER_COUNT; c++) {
+        sums_[c] -= counts_[head_][c];
+        counts_[head_][c] = 0;
+      }
+    }
+    head_start_ms_ += steps * bucket_ms_;
+  }
+
+  uint32_t sum(TrendCounter c) const { return sums_[c]; }
+
+  void clear() {
+    for (auto &bucket : counts_)
+      for (auto &count : bucket)
+        count = 0;
+    for (auto &s : sums_)
+      s = 0;
+    head_ = 0;
+    started_ = false;
+  }
+
+ protected:
+  uint16_t counts_[BUCKETS][TREND_COUNTER_COUNT]{};
+  uint32_t sums_[TREND_COUNTER_COUNT]{};
+  uint32_t head_start_ms_{0};
+  uint32_t bucket_ms_{1000};
+  uint8_t head_{0};
+  bool started_{false};
+};
+
+}  // namespace trend_stats
+}  // namespace esphome
@@ -0,0 +1,84 @@
+// Recorded input traces for the host tools (hp_ukf_tune, hp_ukf_fixed_check).
+//
+// Formats:
+//   CSV   t_ms,t_in,rh_in,t_out,rh_out per line; a header line is allowed, an empty field or
+//         "nan" marks a missing sample. t_ms is any monotonic millisecond clock.
+//   .bin  packed little-endian records {uint32_t t_ms; float z[4];} with NaN for missing.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace hp_ukf_tools {
+
+constexpr int TRACE_CHANNELS = 4;
+
+struct Sample {
+  uint32_t t_ms;
+  float z[TRACE_CHANNELS];
+};
+
+inline bool ends_with(const char *s, const char *suffix) {
+  size_t n = strlen(s), k = strlen(suffix);
+  return n >= k && strcmp(s + n - k, suffix) == 0;
+}
+
+inline bool load_trace(const char *path, std::vector<Sample> &out) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == nullptr) {
+    fprintf(stderr, "cannot read %s\n", path);
+    return false;
+  }
+  if (ends_with(path, ".bin")) {
+    unsigned char rec[4 + 4 * TRACE_CHANNELS];
+    while (fread(rec, sizeof(rec), 1, fp) == 1) {
+      Sample s;
+      memcpy(&s.t_ms, rec, 4);
+      memcpy(s.z, rec + 4, 4 * TRACE_CHANNELS);
+      out.push_back(s);
+    }
+  } else {
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+      char *p = line;
+      char *end = nullptr;
+      unsigned long t = strtoul(p, &end, 10);
+      if (end == p || *end != ',')
+        continue;  // header or malformed line
+      Sample s;
+      s.t_ms = static_cast<uint32_t>(t);
+      p = end + 1;
+      for (int c = 0; c < TRACE_CHANNELS; c++) {
+        float v = strtof(p, &end);
+        s.z[c] = (end == p) ? NAN : v;
+        p = end;
+        while (*p != '\0' && *p != ',')
+          p++;
+        if (*p == ',')
+          p++;
+      }
+      out.push_back(s);
+    }
+  }
+  fclose(fp);
+  if (out.empty())
+    fprintf(stderr, "%s: no samples\n", path);
+  return !out.empty();
+}
+
+// dt in seconds between two trace rows as HpUkfComponent::filter_step_() computes it:
+// 0 if the timestamp did not advance (update only), otherwise clamped to [1e-6, 3600].
+inline float step_dt(uint32_t from_ms, uint32_t to_ms) {
+  int32_t elapsed_ms = static_cast<int32_t>(to_ms - from_ms);
+  if (elapsed_ms <= 0)
+    return 0.0f;
+  float dt_s = elapsed_ms / 1000.0f;
+  return dt_s < 1e-6f ? 1e-6f : (dt_s > 3600.0f ? 3600.0f : dt_s);
+}
+
+}  // namespace hp_ukf_tools
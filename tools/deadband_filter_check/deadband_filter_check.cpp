@@ -0,0 +1,311 @@
+// Host-side check of the deadband filters (components/deadband_filter/deadband.h, no ESPHome
+// headers).
+//
+// 1. DDF against the ddf.yaml lambda, transcribed below with its static variables moved into a
+//    struct and its double literals kept: the outputs must agree to float rounding.
+// 2. DDF and DRDF on noisy channels (synthetic steps and ramps with known truth, or the four
+//    channels of a recorded trace): RMS error against the truth (synthetic only) and the share
+//    of samples on which the output changes, compared with the raw signal. DDF is reported
+//    only: its band grows with every reversal outside it, so it trades accuracy for fewer
+//    changes.
+// 3. P2Quantile against the exact quantile of a heavy-tailed stream, and how many samples each
+//    DRDF sizing (EMA without and with fast start, P² quantile) needs before its band stays
+//    within 25 % of its final width on heavy-tailed noise (Gaussian with 3 % outliers at 8x).
+//
+// Build and run (see Makefile):
+//   make -C tools/deadband_filter_check check
+//   tools/deadband_filter_check/deadband_filter_check [TRACE(.csv|.bin)] [--samples N]
+//
+// Exits non-zero if DDF departs from the lambda, DRDF (either sizing) is further from the truth
+// than the raw signal, P² is off by more than 5 %, a fast-start band is not within 0.75-1.33x of its
+// final width after 50 samples, or the quantile band takes more than 500 samples to settle.
+
+#include "deadband_filter/deadband.h"
+#include "hp_ukf_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using esphome::deadband_filter::DEADBAND_MODE_DDF;
+using esphome::deadband_filter::DEADBAND_MODE_DRDF;
+using esphome::deadband_filter::DEADBAND_MODE_DRDF_QUANTILE;
+using esphome::deadband_filter::P2Quantile;
+using esphome::deadband_filter::DeadbandMode;
+using esphome::deadband_filter::DeadbandParams;
+using esphome::deadband_filter::DeadbandState;
+using esphome::deadband_filter::deadband_step;
+
+namespace {
+
+// ddf.yaml, one instance per channel.
+struct LambdaDdf {
+  float upper_bound = NAN;
+  float lower_bound = NAN;
+  float previous_value = NAN;
+  int trend = 0;
+  float deadband_size = 0.0;
+  float contraction_factor = 0.998;
+
+  float operator()(float x) {
+    float current_value = x;
+    if (std::isnan(upper_bound) || std::isnan(lower_bound)) {
+      upper_bound = current_value + deadband_size / 2.0;
+      lower_bound = current_value - deadband_size / 2.0;
+      previous_value = current_value;
+      trend = 0;
+      return (upper_bound + lower_bound) / 2.0;
+    }
+    int current_trend = 0;
+    if (current_value > previous_value) {
+      current_trend = 1;
+    } else if (current_value < previous_value) {
+      current_trend = -1;
+    } else {
+      current_trend = trend;
+    }
+    bool trend_reversed = (trend != 0 && current_trend != 0 && trend != current_trend);
+    bool upper_exceeded = current_value > upper_bound;
+    bool lower_exceeded = current_value < lower_bound;
+    if (trend_reversed) {
+      if (upper_exceeded) {
+        upper_bound = current_value;
+        deadband_size = upper_bound - lower_bound;
+      } else if (lower_exceeded) {
+        lower_bound = current_value;
+        deadband_size = upper_bound - lower_bound;
+      } else {
+        float center = (upper_bound + lower_bound) / 2.0;
+        float current_deadband = upper_bound - lower_bound;
+        deadband_size = current_deadband * contraction_factor;
+        upper_bound = center + deadband_size / 2.0;
+        lower_bound = center - deadband_size / 2.0;
+      }
+    } else {
+      if (upper_exceeded || lower_exceeded) {
+        if (upper_exceeded) {
+          float excess = current_value - upper_bound;
+          upper_bound = current_value;
+          lower_bound += excess;
+        } else if (lower_exceeded) {
+          float excess = lower_bound - current_value;
+          lower_bound = current_value;
+          upper_bound -= excess;
+        }
+      }
+    }
+    previous_value = current_value;
+    trend = current_trend;
+    return (upper_bound + lower_bound) / 2.0;
+  }
+};
+
+struct Channel {
+  std::vector<float> raw;
+  std::vector<float> truth;  // empty for recorded traces
+};
+
+// 1 s samples: a slow ramp with occasional steps plus Gaussian noise of sigma.
+Channel synthetic_channel(int count, float sigma, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> noise(0.0f, sigma);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  Channel ch;
+  float level = 20.0f;
+  for (int k = 0; k < count; k++) {
+    if (u(rng) < 0.002f)
+      level += (u(rng) - 0.5f) * 40.0f * sigma;
+    float t = level + 5.0f * sigma * std::sin(6.2831853f * k / 3600.0f);
+    ch.truth.push_back(t);
+    ch.raw.push_back(t + noise(rng));
+  }
+  return ch;
+}
+
+struct Stats {
+  double rms;
+  double changes;
+};
+
+Stats measure(const std::vector<float> &out, const Channel &ch) {
+  double se = 0.0;
+  long n = 0, changes = 0;
+  for (size_t k = 0; k < out.size(); k++) {
+    if (!ch.truth.empty() && k >= ch.truth.size() / 10) {  // skip the learning phase
+      double e = out[k] - ch.truth[k];
+      se += e * e;
+      n++;
+    }
+    if (k > 0 && out[k] != out[k - 1])
+      changes++;
+  }
+  return {n > 0 ? std::sqrt(se / n) : NAN, out.size() > 1 ? double(changes) / (out.size() - 1) : 0.0};
+}
+
+std::vector<float> run(const DeadbandParams &p, const std::vector<float> &raw, std::vector<float> *widths = nullptr) {
+  DeadbandState s;
+  P2Quantile q;
+  q.set_quantile(p.quantile);
+  std::vector<float> out;
+  out.reserve(raw.size());
+  for (float x : raw) {
+    out.push_back(deadband_step(p, s, x, &q));
+    if (widths != nullptr)
+      widths->push_back(s.width);
+  }
+  return out;
+}
+
+// Gaussian noise of sigma with a share of outliers at 8 sigma, around a constant.
+std::vector<float> heavy_tailed(int count, float sigma, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> noise(0.0f, sigma);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::vector<float> out;
+  for (int k = 0; k < count; k++)
+    out.push_back(20.0f + (u(rng) < 0.03f ? 8.0f : 1.0f) * noise(rng));
+  return out;
+}
+
+// First sample after which the width stays within 25 % of its final value.
+size_t settle_samples(const std::vector<float> &widths) {
+  float final_width = widths.back();
+  size_t k = widths.size();
+  while (k > 0 && std::fabs(widths[k - 1] - final_width) <= 0.25f * final_width)
+    k--;
+  return k;
+}
+
+bool check_quantile_and_fast_start() {
+  bool ok = true;
+  std::vector<float> stream = heavy_tailed(200000, 1.0f, 7);
+  for (float p : {0.5f, 0.9f, 0.99f}) {
+    P2Quantile q;
+    q.set_quantile(p);
+    std::vector<float> abs_dev;
+    for (float x : stream) {
+      abs_dev.push_back(std::fabs(x - 20.0f));
+      q.add(abs_dev.back());
+    }
+    std::sort(abs_dev.begin(), abs_dev.end());
+    float exact = abs_dev[(size_t) std::ceil(p * abs_dev.size()) - 1];
+    float rel = std::fabs(q.get() - exact) / exact;
+    printf("P2 quantile %.2f: %.4f, exact %.4f (%.2f %%)\n", p, q.get(), exact, 100.0f * rel);
+    ok = ok && rel <= 0.05f;
+  }
+
+  std::vector<float> noise = heavy_tailed(20000, 0.1f, 11);
+  struct Sizing {
+    const char *name;
+    DeadbandMode mode;
+    bool fast_start;
+  } sizings[] = {
+      {"ema", DEADBAND_MODE_DRDF, false},
+      {"ema fast start", DEADBAND_MODE_DRDF, true},
+      {"quantile", DEADBAND_MODE_DRDF_QUANTILE, false},
+      {"quantile fast start", DEADBAND_MODE_DRDF_QUANTILE, true},
+  };
+  printf("heavy-tailed noise, %zu samples:\n", noise.size());
+  for (const Sizing &z : sizings) {
+    DeadbandParams p;
+    p.mode = z.mode;
+    p.fast_start = z.fast_start;
+    std::vector<float> widths;
+    std::vector<float> out = run(p, noise, &widths);
+    Channel ch;
+    ch.raw = noise;
+    Stats st = measure(out, ch);
+    size_t settle = settle_samples(widths);
+    printf("  %-20s final width %.4f, settles after %5zu samples, changes %5.2f %%, width/final at", z.name,
+           widths.back(), settle, 100.0 * st.changes);
+    for (size_t k : {25, 50, 100, 200})
+      printf(" %zu: %.2f", k, widths[k - 1] / widths.back());
+    printf("\n");
+    float early = widths[49] / widths.back();
+    if (z.fast_start && (early < 0.75f || early > 1.33f))
+      ok = false;
+    if (z.mode == DEADBAND_MODE_DRDF_QUANTILE && settle > 500)
+      ok = false;
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *trace_path = nullptr;
+  int samples = 50000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = std::max(10, atoi(argv[++i]));
+    } else if (argv[i][0] != '-' && trace_path == nullptr) {
+      trace_path = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [TRACE(.csv|.bin)] [--samples N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<Channel> channels;
+  if (trace_path != nullptr) {
+    std::vector<hp_ukf_tools::Sample> trace;
+    if (!hp_ukf_tools::load_trace(trace_path, trace))
+      return 2;
+    channels.resize(hp_ukf_tools::TRACE_CHANNELS);
+    for (const auto &s : trace)
+      for (int c = 0; c < hp_ukf_tools::TRACE_CHANNELS; c++)
+        if (std::isfinite(s.z[c]))
+          channels[c].raw.push_back(s.z[c]);
+  } else {
+    const float sigmas[] = {0.05f, 0.1f, 0.5f, 2.0f};
+    for (int c = 0; c < 4; c++)
+      channels.push_back(synthetic_channel(samples, sigmas[c], 100 + c));
+  }
+
+  DeadbandParams ddf;
+  ddf.mode = DEADBAND_MODE_DDF;
+  DeadbandParams drdf;
+  drdf.mode = DEADBAND_MODE_DRDF;
+  DeadbandParams drdf_q;
+  drdf_q.mode = DEADBAND_MODE_DRDF_QUANTILE;
+
+  bool ok = true;
+  for (size_t c = 0; c < channels.size(); c++) {
+    const Channel &ch = channels[c];
+    if (ch.raw.empty())
+      continue;
+    std::vector<float> out_ddf = run(ddf, ch.raw);
+    std::vector<float> out_drdf = run(drdf, ch.raw);
+    std::vector<float> out_drdf_q = run(drdf_q, ch.raw);
+
+    LambdaDdf ref;
+    double max_diff = 0.0;
+    for (size_t k = 0; k < ch.raw.size(); k++) {
+      float r = ref(ch.raw[k]);
+      double d = std::fabs(double(out_ddf[k]) - r);
+      max_diff = std::max(max_diff, d);
+      if (d > 1e-6 * (1.0 + std::fabs(r)))
+        ok = false;
+    }
+
+    Stats raw = measure(ch.raw, ch);
+    Stats a = measure(out_ddf, ch);
+    Stats b = measure(out_drdf, ch);
+    Stats bq = measure(out_drdf_q, ch);
+    printf("channel %zu: %zu samples, DDF vs lambda max |diff| %.2e\n", c, ch.raw.size(), max_diff);
+    printf("  %-5s rms %8.4f  changes %5.1f %%\n", "raw", raw.rms, 100.0 * raw.changes);
+    printf("  %-5s rms %8.4f  changes %5.1f %%\n", "ddf", a.rms, 100.0 * a.changes);
+    printf("  %-5s rms %8.4f  changes %5.1f %%\n", "drdf", b.rms, 100.0 * b.changes);
+    printf("  %-5s rms %8.4f  changes %5.1f %%  (drdf_quantile)\n", "drdfq", bq.rms, 100.0 * bq.changes);
+    if (!ch.truth.empty() && (b.rms > raw.rms || bq.rms > raw.rms))
+      ok = false;
+  }
+  if (trace_path == nullptr)
+    ok = check_quantile_and_fast_start() && ok;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
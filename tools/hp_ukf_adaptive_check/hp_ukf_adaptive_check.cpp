@@ -0,0 +1,187 @@
+// Host check of the adaptive step interval (HpUkfAdaptiveScheduler, no ESPHome headers).
+//
+// A synthetic 1 Hz trace (known truth, noise at the default R) holds steady for most of six hours
+// with two active periods: a compressor start (T_out +10 °C, RH_out -15 % over 5 min) and a
+// defrost (T_out -8 °C in 1 min, back over 5 min). The filter replays it polled every second,
+// once stepping on every poll and once through the scheduler with the component's call
+// sequence (process noise scaled to the step). The report gives per run:
+//   steps     filter steps (the publish count follows it)
+//   rms       RMS error of the held (last published) levels against the truth, steady and
+//             active seconds apart
+//   react     seconds from the start of each active period until the scheduler is back at
+//             min_interval
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_adaptive_check check
+//
+// Exits non-zero if adaptive saves less than half of the steps, if its active RMS is more than
+// 25 % above the fixed rate, or if it reacts later than 5 s.
+
+#include "hp_ukf/hp_ukf_adaptive.h"
+#include "hp_ukf/hp_ukf_ukf.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::FilterMode;
+using esphome::hp_ukf::HpUkfAdaptiveScheduler;
+using esphome::hp_ukf::HpUkfFilterT;
+
+namespace {
+
+constexpr int N = 8;
+constexpr int M = 4;
+constexpr int SAMPLES = 6 * 3600;
+constexpr int START_AT = 3600;
+constexpr int DEFROST_AT = 4 * 3600;
+constexpr uint32_t MIN_MS = 1000;
+constexpr uint32_t MAX_MS = 30000;
+constexpr float RATE_T = 0.01f;
+constexpr float RATE_RH = 0.02f;
+constexpr float SIGMA = 4.0f;
+
+struct Trace {
+  std::vector<float> truth;  // SAMPLES x M
+  std::vector<float> z;      // SAMPLES x M
+  std::vector<bool> active;  // truth is moving (outlet ramp or defrost)
+};
+
+float ramp(int k, int from, int len) { return k < from ? 0.0f : (k >= from + len ? 1.0f : (float) (k - from) / len); }
+
+Trace make_trace(unsigned seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> gauss(0.0f, 1.0f);
+  Trace tr;
+  tr.truth.resize(SAMPLES * M);
+  tr.z.resize(SAMPLES * M);
+  tr.active.assign(SAMPLES, false);
+  for (int k = 0; k < SAMPLES; k++) {
+    float *x = &tr.truth[k * M];
+    x[0] = 21.0f + 0.3f * ramp(k, START_AT, 1800);
+    x[1] = 45.0f - 2.0f * ramp(k, START_AT, 1800);
+    x[2] = 22.0f + 10.0f * ramp(k, START_AT, 300) - 8.0f * (ramp(k, DEFROST_AT, 60) - ramp(k, DEFROST_AT + 60, 300));
+    x[3] = 45.0f - 15.0f * ramp(k, START_AT, 300);
+    tr.active[k] = (k >= START_AT && k < START_AT + 300) || (k >= DEFROST_AT && k < DEFROST_AT + 360);
+    for (int c = 0; c < M; c++)
+      tr.z[k * M + c] = x[c] + std::sqrt(esphome::hp_ukf::DEFAULT_R_DIAG[c]) * gauss(rng);
+  }
+  return tr;
+}
+
+struct Result {
+  long steps = 0;
+  double rms_steady = 0.0;
+  double rms_active = 0.0;
+  int react_start = -1;
+  int react_defrost = -1;
+  uint32_t surprises = 0;
+};
+
+Result run(FilterMode mode, bool adaptive, const Trace &tr) {
+  HpUkfFilterT<N> f;
+  f.set_filter_mode(mode);
+  float x0[N] = {};
+  float P0[N * N] = {};
+  for (int c = 0; c < M; c++)
+    x0[c] = tr.z[c];
+  for (int i = 0; i < N; i++)
+    P0[i * N + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+  HpUkfAdaptiveScheduler<N> sched;
+  sched.configure(MIN_MS, MAX_MS, RATE_T, RATE_RH, SIGMA);
+
+  Result res;
+  double sq_steady = 0.0, sq_active = 0.0;
+  long n_steady = 0, n_active = 0;
+  uint32_t last_ms = 0;
+  for (int k = 0; k < SAMPLES; k++) {
+    uint32_t now_ms = k * 1000u;
+    const float *z = &tr.z[k * M];
+    bool mask[M] = {true, true, true, true};
+    bool step = true;
+    if (adaptive) {
+      float r_diag[M];
+      f.get_measurement_noise_diag(r_diag);
+      step = sched.due(now_ms, f.get_state(), f.get_covariance_packed(), r_diag, z, mask);
+    }
+    if (step) {
+      float dt = (now_ms - last_ms) / 1000.0f;
+      if (dt > 0.0f) {
+        if (adaptive)
+          f.set_process_noise_scale(sched.process_noise_scale(dt));
+        f.predict(dt);
+        last_ms = now_ms;
+      }
+      f.update(z, mask);
+      res.steps++;
+    }
+    if (adaptive && sched.get_interval() == MIN_MS) {
+      if (res.react_start < 0 && k >= START_AT)
+        res.react_start = k - START_AT;
+      if (res.react_defrost < 0 && k >= DEFROST_AT)
+        res.react_defrost = k - DEFROST_AT;
+    }
+    const float *x = f.get_state();
+    for (int c = 0; c < M; c++) {
+      double e = x[c] - tr.truth[k * M + c];
+      if (k < 60)
+        continue;
+      if (tr.active[k]) {
+        sq_active += e * e;
+        n_active++;
+      } else {
+        sq_steady += e * e;
+        n_steady++;
+      }
+    }
+  }
+  res.rms_steady = std::sqrt(sq_steady / (double) n_steady);
+  res.rms_active = std::sqrt(sq_active / (double) n_active);
+  res.surprises = sched.get_surprises();
+  return res;
+}
+
+}  // namespace
+
+int main() {
+  const struct {
+    const char *name;
+    FilterMode mode;
+  } modes[] = {
+      {"ukf", esphome::hp_ukf::FILTER_MODE_UKF},
+      {"linear_kf", esphome::hp_ukf::FILTER_MODE_LINEAR_KF},
+  };
+  Trace tr = make_trace(1);
+  printf("%d s trace, min_interval %u ms, max_interval %u ms, rates %.3f °C/s %.3f %%/s, %.0f sigma\n", SAMPLES,
+         (unsigned) MIN_MS, (unsigned) MAX_MS, RATE_T, RATE_RH, SIGMA);
+  printf("%-10s %-9s %7s %11s %11s %13s %9s\n", "mode", "schedule", "steps", "rms_steady", "rms_active",
+         "react (s)", "early");
+
+  bool ok = true;
+  for (const auto &m : modes) {
+    Result fixed = run(m.mode, false, tr);
+    Result adaptive = run(m.mode, true, tr);
+    printf("%-10s %-9s %7ld %11.4f %11.4f %13s %9s\n", m.name, "fixed", fixed.steps, fixed.rms_steady,
+           fixed.rms_active, "-", "-");
+    printf("%-10s %-9s %7ld %11.4f %11.4f %6d / %4d %9u\n", m.name, "adaptive", adaptive.steps, adaptive.rms_steady,
+           adaptive.rms_active, adaptive.react_start, adaptive.react_defrost, (unsigned) adaptive.surprises);
+    if (adaptive.steps * 2 > fixed.steps) {
+      printf("FAIL %s: adaptive runs %ld of %ld steps\n", m.name, adaptive.steps, fixed.steps);
+      ok = false;
+    }
+    if (adaptive.rms_active > 1.25 * fixed.rms_active) {
+      printf("FAIL %s: active RMS %.4f vs %.4f at the fixed rate\n", m.name, adaptive.rms_active, fixed.rms_active);
+      ok = false;
+    }
+    for (int react : {adaptive.react_start, adaptive.react_defrost}) {
+      if (react < 0 || react > 5) {
+        printf("FAIL %s: back at min_interval after %d s\n", m.name, react);
+        ok = false;
+      }
+    }
+  }
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
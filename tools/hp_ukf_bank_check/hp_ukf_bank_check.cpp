@@ -0,0 +1,130 @@
+// Host check of the structure-of-arrays filter bank (HpUkfFilterBank, no ESPHome headers).
+//
+// UNITS synthetic 1 Hz traces (one per unit, different phase, noise and missing samples) are
+// replayed once through the bank and once through one HpUkfFilterT per unit in linear_kf mode,
+// with the component's call sequences (the bank takes z/mask as [channel][unit] with 0 for a
+// missing sample). For N = 8 and N = 4 the report gives, over all units and samples, the max
+// difference of every state and of its variance relative to the per-unit filter.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_bank_check check
+//
+// Exits non-zero if any state differs by more than TOLERANCE * (1 + |x|) or any variance by
+// more than TOLERANCE relative, or if a value is not finite.
+
+#include "hp_ukf/hp_ukf_bank.h"
+#include "hp_ukf/hp_ukf_ukf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::HpUkfFilterBank;
+using esphome::hp_ukf::HpUkfFilterT;
+
+namespace {
+
+constexpr int UNITS = 3;
+constexpr int M = 4;
+constexpr int SAMPLES = 4 * 3600;
+constexpr double TOLERANCE = 1e-5;
+const char *const STATE_NAMES[8] = {"T_in", "RH_in", "T_out", "RH_out", "dT_in", "dT_out", "dRH_in", "dRH_out"};
+
+// SAMPLES x M readings of one unit; NaN marks a missing sample (2 %, plus a 10 min T_out gap).
+std::vector<float> unit_trace(int unit) {
+  std::mt19937 rng(100 + unit);
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::vector<float> z(SAMPLES * M);
+  for (int k = 0; k < SAMPLES; k++) {
+    float phase = 6.2831853f * k / (900.0f + 300.0f * unit);
+    float *s = &z[k * M];
+    s[0] = 21.0f + unit + 0.5f * std::sin(phase) + noise(rng);
+    s[1] = 45.0f + 2.0f * std::cos(phase) + 4.0f * noise(rng);
+    s[2] = 35.0f + 8.0f * std::sin(phase) + noise(rng);
+    s[3] = 25.0f - 5.0f * std::sin(phase) + 4.0f * noise(rng);
+    for (int c = 0; c < M; c++)
+      if (u(rng) < 0.02f)
+        s[c] = NAN;
+    if (k >= 3600 * (unit + 1) && k < 3600 * (unit + 1) + 600)
+      s[2] = NAN;
+  }
+  return z;
+}
+
+template<int NX> bool run(const std::vector<std::vector<float>> &traces) {
+  HpUkfFilterBank<UNITS, NX> bank;
+  HpUkfFilterT<NX> ref[UNITS];
+  for (int k = 0; k < UNITS; k++) {
+    float x0[NX] = {};
+    float P0[NX * NX] = {};
+    for (int c = 0; c < M; c++)
+      x0[c] = std::isfinite(traces[k][c]) ? traces[k][c] : 20.0f;
+    for (int i = 0; i < NX; i++)
+      P0[i * NX + i] = 1.0f;
+    ref[k].set_filter_mode(esphome::hp_ukf::FILTER_MODE_LINEAR_KF);
+    ref[k].set_initial_state(x0, P0);
+    bank.set_initial_state(k, x0, P0);
+  }
+
+  double max_dx[NX] = {}, max_dp[NX] = {};
+  bool finite = true;
+  for (int s = 0; s < SAMPLES; s++) {
+    float z[M * UNITS];
+    uint8_t mask[M * UNITS];
+    if (s > 0)
+      bank.predict(1.0f);
+    for (int k = 0; k < UNITS; k++) {
+      const float *zk = &traces[k][s * M];
+      bool mk[M];
+      for (int c = 0; c < M; c++) {
+        mk[c] = std::isfinite(zk[c]);
+        z[c * UNITS + k] = mk[c] ? zk[c] : 0.0f;
+        mask[c * UNITS + k] = mk[c] ? 1 : 0;
+      }
+      if (s > 0)
+        ref[k].predict(1.0f);
+      ref[k].update(zk, mk);
+    }
+    bank.update(z, mask);
+
+    for (int k = 0; k < UNITS; k++) {
+      const float *x = ref[k].get_state();
+      const float *P = ref[k].get_covariance_packed();
+      for (int i = 0; i < NX; i++) {
+        float xb = bank.get_state(k, i);
+        float pb = bank.get_variance(k, i);
+        float p = P[HpUkfFilterT<NX>::packed_index(i, i)];
+        finite = finite && std::isfinite(xb) && std::isfinite(pb);
+        max_dx[i] = std::max(max_dx[i], std::fabs((double) xb - x[i]) / (1.0 + std::fabs(x[i])));
+        max_dp[i] = std::max(max_dp[i], std::fabs((double) pb - p) / p);
+      }
+    }
+  }
+
+  printf("\nN=%d, %d units x %d samples\n", NX, UNITS, SAMPLES);
+  printf("%-8s %14s %14s\n", "state", "dx/(1+|x|)", "dP/P");
+  bool ok = finite;
+  for (int i = 0; i < NX; i++) {
+    bool pass = max_dx[i] <= TOLERANCE && max_dp[i] <= TOLERANCE;
+    printf("%-8s %14.3e %14.3e%s\n", STATE_NAMES[i], max_dx[i], max_dp[i], pass ? "" : "  FAIL");
+    ok = ok && pass;
+  }
+  if (!finite)
+    printf("FAIL: non-finite bank state\n");
+  return ok;
+}
+
+}  // namespace
+
+int main() {
+  std::vector<std::vector<float>> traces;
+  for (int k = 0; k < UNITS; k++)
+    traces.push_back(unit_trace(k));
+  bool ok = run<8>(traces);
+  ok = run<4>(traces) && ok;
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
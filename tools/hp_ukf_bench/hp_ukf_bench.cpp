@@ -0,0 +1,543 @@
+// Host-side microbenchmark for HpUkfFilterT<4> and HpUkfFilterT<8> (no ESPHome headers).
+//
+// Benchmarks predict(), update() and the fused predict_update() for every filter mode (plus the
+// sequential scalar update as ukf_seq), n=4 and n=8, every
+// measurement mask combination and EM auto-tune on/off. Reports ns/op, an estimated FLOP count
+// per call and the peak stack usage of each call.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_bench
+//   tools/hp_ukf_bench/hp_ukf_bench --csv bench.csv
+//   tools/hp_ukf_bench/hp_ukf_bench --baseline bench.csv --tolerance 10
+//
+// With --baseline the run exits non-zero if any case got slower or needs more
+// stack than the tolerance (percent) allows, or produced a non-finite state,
+// so it can gate changes before flashing real devices.
+
+#include "hp_ukf/hp_ukf_ukf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+#include <ucontext.h>
+
+using esphome::hp_ukf::FilterMode;
+using esphome::hp_ukf::HpUkfFilterT;
+
+namespace {
+
+using Filter4 = HpUkfFilterT<4>;
+using Filter8 = HpUkfFilterT<8>;
+
+constexpr int M = Filter8::M;
+
+struct ModeInfo {
+  FilterMode mode;
+  const char *name;
+  bool sequential;  // set_sequential_update (UKF mode only)
+};
+
+const ModeInfo MODES[] = {
+    {esphome::hp_ukf::FILTER_MODE_UKF, "ukf", false},
+    {esphome::hp_ukf::FILTER_MODE_UKF, "ukf_seq", true},
+    {esphome::hp_ukf::FILTER_MODE_SR_UKF, "sr_ukf", false},
+    {esphome::hp_ukf::FILTER_MODE_LINEAR_KF, "linear_kf", false},
+    {esphome::hp_ukf::FILTER_MODE_UD, "ud", false},
+};
+
+enum Op { OP_PREDICT, OP_UPDATE, OP_FUSED };
+
+const char *const OP_NAMES[] = {"predict", "update", "fused"};
+
+struct BenchCase {
+  const char *mode;
+  int n;
+  bool em;
+  int mask_bits;  // bit i set = measurement i available
+  const char *op;
+};
+
+struct BenchResult {
+  BenchCase c;
+  double ns_per_op;
+  double flops;
+  size_t stack_bytes;
+  bool finite;
+};
+
+// ---------------------------------------------------------------------------
+// FLOP estimates (multiply, add, divide, sqrt each count as one) derived from
+// the loop structure in hp_ukf_ukf.cpp and hp_ukf_kernels.h. Keep in sync when
+// either changes.
+// ---------------------------------------------------------------------------
+
+// Square-root mode: Householder QR of a rows x dim compound matrix.
+double qr_flops(int rows, int dim) { return 2.0 * dim * dim * (rows - dim / 3.0) + 2.0 * dim * rows; }
+
+// Rank-1 Cholesky update/downdate of a dim x dim factor.
+double rank1_flops(int dim) { return dim * 6.0 + 2.0 * dim * (dim - 1); }
+
+double predict_sr_flops(int n) {
+  int ns = 2 * n + 1;
+  double st = (n >= 8) ? 4.0 : 0.0;
+  double f = 3.0 * n * n;                    // sigma points from S
+  f += ns * st + ns * 2.0 * n;               // propagate and mean
+  f += (ns - 1) * 2.0 * n + n;               // compound matrix
+  f += qr_flops(3 * n, n) + rank1_flops(n);  // QR and central point
+  return f;
+}
+
+double update_sr_flops(int n, int m, bool em) {
+  if (m == 0)
+    return 0.0;
+  int ns = 2 * n + 1;
+  double f = 3.0 * n * n;                          // sigma points from S
+  f += ns * 2.0 * m;                               // z_pred
+  f += (ns - 1) * 2.0 * m + m;                     // compound matrix
+  f += qr_flops(2 * n + m, m) + rank1_flops(m);    // Sz
+  f += ns * (3.0 * m + 2.0 * n + 2.0 * n * m);     // Pxz and Pzz diagonal
+  f += n * 2.0 * m * (m + 1);                      // triangular solves for K
+  f += m + 2.0 * n * m;                            // innovation and correction
+  f += m * (n * (m + 1.0) + rank1_flops(n));       // U = K*Sz and downdates
+  if (em)
+    f += 8.0 * m + 7.0 * n;
+  return f;
+}
+
+double sigma_points_flops(int n) {
+  double chol = n * (n + 1) * (n + 1) / 3.0;  // inner products + sqrt/divide
+  return n * n + chol + 2.0 * n * n;          // scale, factor, x +/- L
+}
+
+double predict_flops(int n) {
+  int ns = 2 * n + 1;
+  double st = (n >= 8) ? 8.0 : 0.0;  // state_transition
+  double packed = n * (n + 1) / 2.0;
+  double f = sigma_points_flops(n) + ns * st;
+  f += n * 3.0 * ns;               // mean and deviations
+  f += packed * (2.0 * ns + 3.0);  // weighted_gram_packed + Q
+  return f;
+}
+
+// correct_ukf: shared by update() and the fused step once z_pred, Pzz and Pxz are known.
+double correct_ukf_flops(int n, int m, bool em) {
+  double packed = n * (n + 1) / 2.0;
+  double f = m;                            // Pzz + R
+  f += m * (2.0 * m + 4.0 * m * (m - 1));  // Gauss-Jordan inverse
+  f += 2.0 * n * m * m;                    // K = Pxz * Pzz^-1
+  f += m + 2.0 * n * m + n;                // innovation and correction
+  f += 2.0 * n * n * m;                    // A = P - K*P[idx, :]
+  f += n * m * (2.0 * m + 1.0);            // C = K*R - A[:, idx]
+  f += packed * 2.0 * m;                   // A + C*K', upper triangle
+  if (em)
+    f += 8.0 * m + 7.0 * n;
+  return f;
+}
+
+double update_flops(int n, int m, bool em) {
+  if (m == 0)
+    return 0.0;
+  int ns = 2 * n + 1;
+  double f = sigma_points_flops(n);
+  f += m * 2.0 * ns;              // z_pred
+  f += n * ns;                    // deviations
+  f += n * m * (2.0 * ns + 1.0);  // Pxz (Pzz is its rows idx[])
+  return f + correct_ukf_flops(n, m, em);
+}
+
+// Linear KF mode: closed-form 2x2 block per channel.
+double predict_linear_flops(int n) { return n >= 8 ? M * 11.0 : M * 1.0; }
+
+double update_linear_flops(int n, int m, bool em) {
+  double f = m * ((n >= 8) ? 15.0 : 6.0);
+  if (em && m > 0)
+    f += 8.0 * m + 7.0 * n;
+  return f;
+}
+
+// UD mode: Thornton MWGS on the n x 2n matrix [F*U | I], then Bierman per channel
+// (worst case: channel 0, whose update touches every column of U).
+double predict_ud_flops(int n) {
+  double f = (n >= 8) ? M * (n + 1.0) : 0.0;           // F*U and F*x
+  f += n * 6.0 * n + n * (n - 1) / 2.0 * (8.0 * n + 1);  // norms, projections, divides
+  return f;
+}
+
+double update_ud_flops(int n, int m, bool em) {
+  if (m == 0)
+    return 0.0;
+  double f = m * 3.0 * n;                                  // prior P_cc for EM
+  f += m * (n + 6.0 * n + 2.0 * n * (n - 1) + 2.0 * n + 3.0);
+  if (em)
+    f += n + 8.0 * m + 7.0 * n;
+  return f;
+}
+
+// Sequential scalar update: per channel gain, state correction and a
+// rank-1 correction of P (packed upper triangle).
+double update_seq_flops(int n, int m, bool em) {
+  double f = m * (2.0 + n + 2.0 * n + n * (n + 1.0));
+  if (em && m > 0)
+    f += n + 8.0 * m + 7.0 * n;
+  return f;
+}
+
+// Fused UKF step: predict, then correct_ukf on slices of the predicted P (no second sigma draw).
+double fused_flops(int n, int m, bool em) {
+  if (m == 0)
+    return predict_flops(n);
+  return predict_flops(n) + correct_ukf_flops(n, m, em);
+}
+
+double op_flops(const ModeInfo &mi, Op op, int n, int m, bool em) {
+  FilterMode mode = mi.mode;
+  if (mode == esphome::hp_ukf::FILTER_MODE_LINEAR_KF) {
+    if (op == OP_PREDICT)
+      return predict_linear_flops(n);
+    return (op == OP_FUSED ? predict_linear_flops(n) : 0.0) + update_linear_flops(n, m, em);
+  }
+  if (mode == esphome::hp_ukf::FILTER_MODE_UD) {
+    if (op == OP_PREDICT)
+      return predict_ud_flops(n);
+    return (op == OP_FUSED ? predict_ud_flops(n) : 0.0) + update_ud_flops(n, m, em);
+  }
+  if (mode == esphome::hp_ukf::FILTER_MODE_SR_UKF) {
+    if (op == OP_PREDICT)
+      return predict_sr_flops(n);
+    return (op == OP_FUSED ? predict_sr_flops(n) : 0.0) + update_sr_flops(n, m, em);
+  }
+  if (op == OP_PREDICT)
+    return predict_flops(n);
+  if (mi.sequential)
+    return (op == OP_FUSED ? predict_flops(n) : 0.0) + update_seq_flops(n, m, em);
+  return op == OP_FUSED ? fused_flops(n, m, em) : update_flops(n, m, em);
+}
+
+// ---------------------------------------------------------------------------
+// Peak stack measurement: run the call on a painted private stack and find
+// the deepest byte that was overwritten.
+// ---------------------------------------------------------------------------
+
+constexpr size_t STACK_PROBE_BYTES = 256 * 1024;
+constexpr unsigned char STACK_PAINT = 0xA5;
+
+struct StackProbe {
+  void (*fn)(void *);
+  void *arg;
+};
+
+ucontext_t g_main_ctx;
+ucontext_t g_probe_ctx;
+StackProbe *g_probe = nullptr;
+
+void stack_trampoline() { g_probe->fn(g_probe->arg); }
+
+size_t measure_stack(void (*fn)(void *), void *arg) {
+  std::vector<unsigned char> stack(STACK_PROBE_BYTES, STACK_PAINT);
+  // Baseline: how much the trampoline itself uses.
+  auto run = [&](void (*f)(void *), void *a) -> size_t {
+    std::fill(stack.begin(), stack.end(), STACK_PAINT);
+    StackProbe probe{f, a};
+    g_probe = &probe;
+    getcontext(&g_probe_ctx);
+    g_probe_ctx.uc_stack.ss_sp = stack.data();
+    g_probe_ctx.uc_stack.ss_size = stack.size();
+    g_probe_ctx.uc_link = &g_main_ctx;
+    makecontext(&g_probe_ctx, stack_trampoline, 0);
+    swapcontext(&g_main_ctx, &g_probe_ctx);
+    size_t untouched = 0;
+    while (untouched < stack.size() && stack[untouched] == STACK_PAINT)
+      untouched++;
+    return stack.size() - untouched;
+  };
+  size_t empty = run([](void *) {}, nullptr);
+  size_t used = run(fn, arg);
+  return used > empty ? used - empty : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Filter setup and timed loops
+// ---------------------------------------------------------------------------
+
+volatile float g_sink;
+
+template<typename F> F make_filter(const ModeInfo &mi, bool em) {
+  constexpr int n = F::N;
+  F f;
+  f.set_filter_mode(mi.mode);
+  f.set_sequential_update(mi.sequential);
+  const float x_full[8] = {21.0f, 45.0f, 30.0f, 35.0f, 0.001f, 0.05f, -0.002f, -0.03f};
+  float x0[n];
+  std::copy(x_full, x_full + n, x0);
+  float P0[n * n] = {};
+  for (int i = 0; i < n; i++)
+    P0[i * n + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+  if (em) {
+    f.enable_em_autotune(true);
+    f.set_em_lambda_q(0.995f);
+    f.set_em_lambda_r_inlet(0.998f);
+    f.set_em_lambda_r_outlet(0.98f);
+    f.set_em_inflation(0.5f);
+  }
+  // A few ticks so the covariance has realistic off-diagonal structure.
+  const float z[M] = {21.02f, 44.9f, 30.3f, 34.8f};
+  const bool all[M] = {true, true, true, true};
+  for (int i = 0; i < 5; i++) {
+    f.predict(1.0f);
+    f.update(z, all);
+  }
+  return f;
+}
+
+void make_measurement(int mask_bits, float *z, bool *mask) {
+  const float zv[M] = {21.05f, 44.7f, 30.6f, 34.5f};
+  for (int i = 0; i < M; i++) {
+    z[i] = (mask_bits & (1 << i)) ? zv[i] : NAN;
+    mask[i] = (mask_bits & (1 << i)) != 0;
+  }
+}
+
+template<typename F> bool state_finite(const F &f) {
+  const float *x = f.get_state();
+  const float *P = f.get_covariance_packed();
+  constexpr int n = F::N;
+  for (int i = 0; i < n; i++)
+    if (!std::isfinite(x[i]))
+      return false;
+  for (int i = 0; i < F::N_PACKED; i++)
+    if (!std::isfinite(P[i]))
+      return false;
+  return true;
+}
+
+template<typename F> struct OpArgs {
+  F *f;
+  const float *z;
+  const bool *mask;
+  Op op;
+};
+
+template<typename F> void run_op(void *p) {
+  auto *a = static_cast<OpArgs<F> *>(p);
+  if (a->op == OP_UPDATE)
+    a->f->update(a->z, a->mask);
+  else if (a->op == OP_FUSED)
+    a->f->predict_update(1.0f, a->z, a->mask);
+  else
+    a->f->predict(1.0f);
+}
+
+// Filter is reset from a prototype every BATCH calls so long runs do not
+// drift into a different numeric regime (e.g. unbounded predict-only P).
+constexpr int BATCH = 256;
+
+template<typename F>
+double time_op(const F &proto, Op op, const float *z, const bool *mask, int iters, bool *finite) {
+  using clock = std::chrono::steady_clock;
+  std::vector<double> samples;
+  const int reps = 5;
+  *finite = true;
+  for (int r = 0; r < reps; r++) {
+    clock::duration total{0};
+    int done = 0;
+    while (done < iters) {
+      F f = proto;
+      int todo = std::min(BATCH, iters - done);
+      auto t0 = clock::now();
+      if (op == OP_UPDATE) {
+        for (int i = 0; i < todo; i++)
+          f.update(z, mask);
+      } else if (op == OP_FUSED) {
+        for (int i = 0; i < todo; i++)
+          f.predict_update(1.0f, z, mask);
+      } else {
+        for (int i = 0; i < todo; i++)
+          f.predict(1.0f);
+      }
+      total += clock::now() - t0;
+      done += todo;
+      g_sink = f.get_state()[0];
+      *finite = *finite && state_finite(f);
+    }
+    samples.push_back(std::chrono::duration<double, std::nano>(total).count() / iters);
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[reps / 2];
+}
+
+// All cases for one (mode, dimension, em) combination.
+template<typename F> void bench_dim(const ModeInfo &mi, bool em, int iters, std::vector<BenchResult> &results) {
+  constexpr int n = F::N;
+  F proto = make_filter<F>(mi, em);
+  float z[M];
+  bool mask[M];
+
+  // predict() does not depend on the mask; measure it once per (mode, n, em).
+  {
+    BenchCase c{mi.name, n, em, (1 << M) - 1, OP_NAMES[OP_PREDICT]};
+    bool finite;
+    double ns = time_op(proto, OP_PREDICT, nullptr, nullptr, iters, &finite);
+    F f = proto;
+    OpArgs<F> args{&f, nullptr, nullptr, OP_PREDICT};
+    size_t stack = measure_stack(run_op<F>, &args);
+    results.push_back(BenchResult{c, ns, op_flops(mi, OP_PREDICT, n, M, em), stack, finite});
+  }
+  for (Op op : {OP_UPDATE, OP_FUSED}) {
+    for (int bits = 0; bits < (1 << M); bits++) {
+      make_measurement(bits, z, mask);
+      int m = __builtin_popcount(bits);
+      BenchCase c{mi.name, n, em, bits, OP_NAMES[op]};
+      bool finite;
+      double ns = time_op(proto, op, z, mask, iters, &finite);
+      F f = proto;
+      OpArgs<F> args{&f, z, mask, op};
+      size_t stack = measure_stack(run_op<F>, &args);
+      results.push_back(BenchResult{c, ns, op_flops(mi, op, n, m, em), stack, finite});
+    }
+  }
+}
+
+std::string mask_str(int bits) {
+  std::string s;
+  for (int i = 0; i < M; i++)
+    s += (bits & (1 << i)) ? '1' : '0';
+  return s;
+}
+
+std::string case_key(const BenchCase &c) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%s,%d,%d,%s,%s", c.mode, c.n, c.em ? 1 : 0, mask_str(c.mask_bits).c_str(), c.op);
+  return buf;
+}
+
+struct BaselineRow {
+  double ns_per_op;
+  size_t stack_bytes;
+};
+
+std::map<std::string, BaselineRow> load_baseline(const char *path) {
+  std::map<std::string, BaselineRow> rows;
+  FILE *fp = fopen(path, "r");
+  if (fp == nullptr) {
+    fprintf(stderr, "cannot open baseline %s\n", path);
+    exit(2);
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), fp) != nullptr) {
+    int n, em;
+    char mode[16], mask[8], op[16];
+    double ns, flops;
+    unsigned long stack;
+    if (sscanf(line, "%15[a-z_],%d,%d,%7[01],%15[a-z],%lf,%lf,%lu", mode, &n, &em, mask, op, &ns, &flops,
+               &stack) != 8)
+      continue;  // header or malformed
+    char key[64];
+    snprintf(key, sizeof(key), "%s,%d,%d,%s,%s", mode, n, em, mask, op);
+    rows[key] = BaselineRow{ns, (size_t) stack};
+  }
+  fclose(fp);
+  return rows;
+}
+
+void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--iters N] [--csv FILE] [--baseline FILE] [--tolerance PCT]\n"
+          "  --iters N        calls per timed repetition (default 20000)\n"
+          "  --csv FILE       write results as CSV (usable as a later baseline)\n"
+          "  --baseline FILE  compare against a previous CSV; exit 1 on regression\n"
+          "  --tolerance PCT  allowed ns/op and stack growth vs baseline (default 10)\n",
+          argv0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int iters = 20000;
+  const char *csv_path = nullptr;
+  const char *baseline_path = nullptr;
+  double tolerance_pct = 10.0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+      iters = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+      csv_path = argv[++i];
+    } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance_pct = atof(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+
+  std::vector<BenchResult> results;
+  for (const ModeInfo &mi : MODES) {
+    for (int em = 0; em <= 1; em++)
+      bench_dim<Filter4>(mi, em != 0, iters, results);
+    for (int em = 0; em <= 1; em++)
+      bench_dim<Filter8>(mi, em != 0, iters, results);
+  }
+
+  printf("%-9s %-3s %-3s %-5s %-8s %10s %10s %9s %8s\n", "mode", "n", "em", "mask", "op", "ns/op", "flops", "MFLOP/s",
+         "stack");
+  for (const auto &r : results) {
+    double mflops = r.ns_per_op > 0.0 ? r.flops / r.ns_per_op * 1e3 : 0.0;
+    printf("%-9s %-3d %-3s %-5s %-8s %10.1f %10.0f %9.1f %8zu%s\n", r.c.mode, r.c.n, r.c.em ? "on" : "off",
+           mask_str(r.c.mask_bits).c_str(), r.c.op, r.ns_per_op, r.flops, mflops, r.stack_bytes,
+           r.finite ? "" : "  NON-FINITE");
+  }
+
+  if (csv_path != nullptr) {
+    FILE *fp = fopen(csv_path, "w");
+    if (fp == nullptr) {
+      fprintf(stderr, "cannot write %s\n", csv_path);
+      return 2;
+    }
+    fprintf(fp, "mode,n,em,mask,op,ns_per_op,flops,stack_bytes\n");
+    for (const auto &r : results)
+      fprintf(fp, "%s,%.1f,%.0f,%zu\n", case_key(r.c).c_str(), r.ns_per_op, r.flops, r.stack_bytes);
+    fclose(fp);
+  }
+
+  int failures = 0;
+  for (const auto &r : results) {
+    if (!r.finite) {
+      fprintf(stderr, "FAIL %s: non-finite state\n", case_key(r.c).c_str());
+      failures++;
+    }
+  }
+  if (baseline_path != nullptr) {
+    auto base = load_baseline(baseline_path);
+    for (const auto &r : results) {
+      auto it = base.find(case_key(r.c));
+      if (it == base.end())
+        continue;
+      double limit = it->second.ns_per_op * (1.0 + tolerance_pct / 100.0);
+      if (r.ns_per_op > limit) {
+        fprintf(stderr, "FAIL %s: %.1f ns/op vs baseline %.1f (+%.1f%%)\n", case_key(r.c).c_str(), r.ns_per_op,
+                it->second.ns_per_op, (r.ns_per_op / it->second.ns_per_op - 1.0) * 100.0);
+        failures++;
+      }
+      if (r.stack_bytes > it->second.stack_bytes * (1.0 + tolerance_pct / 100.0)) {
+        fprintf(stderr, "FAIL %s: stack %zu bytes vs baseline %zu\n", case_key(r.c).c_str(), r.stack_bytes,
+                it->second.stack_bytes);
+        failures++;
+      }
+    }
+  }
+  if (failures > 0) {
+    fprintf(stderr, "%d regression(s)\n", failures);
+    return 1;
+  }
+  return 0;
+}
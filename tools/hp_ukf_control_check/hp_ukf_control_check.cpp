@@ -0,0 +1,375 @@
+// Host check of the control-input feed-forward (HpUkfControlModel in hp_ukf_control.h, no ESPHome
+// headers).
+//
+// Model: offset() on a linear input and on a table (at, between and beyond its points, and a
+// single-point table); step() holding an input whose value is NaN, taking its first value as the
+// baseline without a kick, summing several inputs, and integrating a step of the offset to dg.
+//
+// Compressor step: the outlet follows a compressor frequency step 0 -> 50 Hz (gain 0.2 °C/Hz,
+// -0.4 %/Hz) with a 60 s time constant, sampled at 1 Hz with the filter's R. The 8-state filter
+// runs polled, as HpUkfComponent::filter_step_() does (feed-forward before the predict), once
+// without and once with `control:` at the matching gain and time constant. Reported: the peak and
+// RMS error of dT_out in the 150 s after the step, and the RMS T_out error.
+//
+// Queue: the same scenario, with several frequency changes and a sensor dropout (NaN), through
+// MeasurementQueue with delayed outlet samples (0.8-1.6 s) and 1 s processing with a 2 s window.
+// The control state is the queue's rollback state; each sample carries the input value at its
+// timestamp. After every process() call the checkpoint, including the control state, must equal
+// in-order fusion bit for bit.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_control_check check
+//   tools/hp_ukf_control_check/hp_ukf_control_check [--samples N]
+//
+// Exits non-zero if a model check fails, the feed-forward does not cut the peak dT_out error to
+// under --peak-ratio (default 0.5) of the run without it, or the queue departs from in-order
+// fusion.
+
+#include "hp_ukf/hp_ukf_control.h"
+#include "hp_ukf/hp_ukf_queue.h"
+#include "hp_ukf/hp_ukf_ukf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::DEFAULT_R_DIAG;
+using esphome::hp_ukf::HpUkfControlModel;
+using esphome::hp_ukf::HpUkfFilterT;
+using esphome::hp_ukf::MeasurementQueue;
+using esphome::hp_ukf::TimedMeasurement;
+using esphome::hp_ukf::time_before;
+
+namespace {
+
+using Filter = HpUkfFilterT<8>;
+using ControlState = HpUkfControlModel::State;
+
+constexpr int M = 4;
+constexpr float TAU_S = 60.0f;
+constexpr float GAIN_T = 0.2f;
+constexpr float GAIN_RH = -0.4f;
+constexpr uint32_t UPDATE_INTERVAL_MS = 1000;
+constexpr uint32_t QUEUE_WINDOW_MS = 2000;
+constexpr int QUEUE_SIZE = 16;
+constexpr uint32_t T0_MS = 100000;
+constexpr float BASE[M] = {21.0f, 45.0f, 30.0f, 40.0f};
+
+int failures = 0;
+
+void expect(bool cond, const char *what) {
+  if (!cond) {
+    printf("  FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+bool near(float a, float b) { return std::fabs(a - b) <= 1e-5f * (1.0f + std::fabs(b)); }
+
+bool check_model() {
+  int before = failures;
+  HpUkfControlModel model;
+  model.set_time_constant(TAU_S);
+  int lin = model.add_linear_input(GAIN_T, GAIN_RH);
+  int tab = model.add_linear_input(0.0f, 0.0f);
+  model.add_table_point(tab, 0.0f, 0.0f, 0.0f);
+  model.add_table_point(tab, 1.0f, 1.5f, -2.0f);
+  model.add_table_point(tab, 3.0f, 3.0f, -5.0f);
+  expect(model.size() == 2, "two inputs");
+
+  float g[2];
+  model.offset(lin, 50.0f, g);
+  expect(near(g[0], 10.0f) && near(g[1], -20.0f), "linear offset");
+  const float table_u[] = {-1.0f, 0.0f, 0.5f, 1.0f, 2.0f, 3.0f, 7.0f};
+  const float table_t[] = {0.0f, 0.0f, 0.75f, 1.5f, 2.25f, 3.0f, 3.0f};
+  const float table_rh[] = {0.0f, 0.0f, -1.0f, -2.0f, -3.5f, -5.0f, -5.0f};
+  for (int k = 0; k < 7; k++) {
+    model.offset(tab, table_u[k], g);
+    if (!near(g[0], table_t[k]) || !near(g[1], table_rh[k])) {
+      printf("  table at u=%.1f: %.4f %.4f, expected %.4f %.4f\n", table_u[k], g[0], g[1], table_t[k], table_rh[k]);
+      expect(false, "table interpolation");
+    }
+  }
+  HpUkfControlModel single;
+  int s = single.add_linear_input(1.0f, 1.0f);
+  single.add_table_point(s, 2.0f, 4.0f, -1.0f);
+  for (float u : {-5.0f, 2.0f, 9.0f}) {
+    single.offset(s, u, g);
+    expect(g[0] == 4.0f && g[1] == -1.0f, "single-point table is constant");
+  }
+
+  // First value: baseline, no kick, even after NaN readings and at a non-zero offset.
+  ControlState st;
+  float d_rate[2], d_level[2];
+  float u[2] = {NAN, NAN};
+  model.step(st, u, 1.0f, d_rate, d_level);
+  expect(d_rate[0] == 0.0f && d_rate[1] == 0.0f && d_level[0] == 0.0f, "no input, no feed-forward");
+  u[0] = 30.0f;
+  u[1] = 2.0f;
+  model.step(st, u, 1.0f, d_rate, d_level);
+  expect(d_rate[0] == 0.0f && d_rate[1] == 0.0f && st.ff[0] == 0.0f && st.ff[1] == 0.0f,
+         "first value sets the baseline without a kick");
+
+  // A change kicks by dg / tau (both inputs add up), then decays; NaN holds the last value.
+  u[0] = 40.0f;  // +2 °C, -4 %
+  u[1] = 3.0f;   // +0.75 °C, -1.5 %
+  float dt = 1.0f;
+  model.step(st, u, dt, d_rate, d_level);
+  float decay = TAU_S / (TAU_S + dt);
+  expect(near(st.ff[0], 2.75f / TAU_S * decay) && near(st.ff[1], -5.5f / TAU_S * decay), "kick of summed inputs");
+  expect(near(d_level[0], st.ff[0] * dt), "d_level is f * dt");
+  ControlState held = st, same = st;
+  float u_nan[2] = {NAN, NAN};
+  float r_held[2], l_held[2], r_same[2], l_same[2];
+  model.step(held, u_nan, dt, r_held, l_held);
+  model.step(same, u, dt, r_same, l_same);
+  expect(memcmp(&held, &same, sizeof(ControlState)) == 0 && r_held[0] == r_same[0] && l_held[1] == l_same[1],
+         "NaN holds the last value");
+  expect(near(held.ff[0], st.ff[0] * decay), "feed-forward decays");
+
+  // The integral of f after a step is ~dg (backward Euler: exactly dg in the limit).
+  ControlState integ;
+  float u_lin[2] = {0.0f, NAN};
+  model.step(integ, u_lin, dt, d_rate, d_level);
+  u_lin[0] = 50.0f;
+  double sum[2] = {0.0, 0.0};
+  for (int k = 0; k < 3000; k++) {
+    model.step(integ, u_lin, dt, d_rate, d_level);
+    sum[0] += d_level[0];
+    sum[1] += d_level[1];
+  }
+  expect(std::fabs(sum[0] - 10.0) < 0.01 && std::fabs(sum[1] + 20.0) < 0.02, "integral of f is dg");
+  printf("model: offsets, table interpolation, baseline, NaN hold, integral %.4f / %.4f (dg 10 / -20)%s\n",
+         sum[0], sum[1], failures == before ? "" : "  FAIL");
+  return failures == before;
+}
+
+// Outlet equilibrium for compressor frequency u (the truth the filter does not know).
+struct Plant {
+  float t_out = BASE[2], rh_out = BASE[3];
+  void advance(float u, float dt) {
+    float a = 1.0f - std::exp(-dt / TAU_S);
+    t_out += a * (BASE[2] + GAIN_T * u - t_out);
+    rh_out += a * (BASE[3] + GAIN_RH * u - rh_out);
+  }
+  float rate(float u) const { return (BASE[2] + GAIN_T * u - t_out) / TAU_S; }
+};
+
+// HpUkfComponent::filter_step_() with apply_control_() and without diagnostics.
+void step(Filter &f, ControlState &cs, const HpUkfControlModel *model, uint32_t &last_ms, uint32_t t_ms,
+          const float *z, const bool *mask, const float *u) {
+  int32_t elapsed_ms = static_cast<int32_t>(t_ms - last_ms);
+  float dt_s = std::max(1e-6f, std::min(elapsed_ms / 1000.0f, 3600.0f));
+  if (elapsed_ms > 0 && model != nullptr) {
+    float d_rate[2], d_level[2];
+    model->step(cs, u, dt_s, d_rate, d_level);
+    float x[Filter::N];
+    memcpy(x, f.get_state(), sizeof(x));
+    x[5] += d_rate[0];
+    x[7] += d_rate[1];
+    f.set_state(x);
+  }
+  if (elapsed_ms > 0) {
+    f.set_process_noise_scale(dt_s * 1000.0f / (float) UPDATE_INTERVAL_MS);
+    f.predict(dt_s);
+    last_ms = t_ms;
+  }
+  f.update(z, mask);
+}
+
+void init(Filter &f) {
+  float x0[Filter::N] = {BASE[0], BASE[1], BASE[2], BASE[3]};
+  float P0[Filter::N * Filter::N] = {};
+  for (int i = 0; i < Filter::N; i++)
+    P0[i * Filter::N + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+}
+
+HpUkfControlModel compressor_model() {
+  HpUkfControlModel model;
+  model.set_time_constant(TAU_S);
+  model.add_linear_input(GAIN_T, GAIN_RH);
+  return model;
+}
+
+struct StepError {
+  double peak = 0.0, rms = 0.0, level_rms = 0.0;
+};
+
+StepError compressor_step(bool with_control, int seconds) {
+  const int step_s = seconds / 2;
+  const int window_s = 150;
+  HpUkfControlModel model = compressor_model();
+  Filter f;
+  init(f);
+  ControlState cs;
+  Plant plant;
+  std::mt19937 rng(3);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  uint32_t last_ms = T0_MS;
+  StepError e;
+  double sum2 = 0.0, level2 = 0.0;
+  for (int k = 1; k <= seconds; k++) {
+    float u = k > step_s ? 50.0f : 0.0f;
+    plant.advance(u, 1.0f);
+    float truth[M] = {BASE[0], BASE[1], plant.t_out, plant.rh_out};
+    float z[M];
+    bool mask[M];
+    for (int c = 0; c < M; c++) {
+      z[c] = truth[c] + std::sqrt(DEFAULT_R_DIAG[c]) * noise(rng);
+      mask[c] = true;
+    }
+    step(f, cs, with_control ? &model : nullptr, last_ms, T0_MS + 1000u * k, z, mask, &u);
+    if (k > step_s && k <= step_s + window_s) {
+      double err = f.get_state()[5] - plant.rate(u);
+      e.peak = std::max(e.peak, std::fabs(err));
+      sum2 += err * err;
+      level2 += (double) (f.get_state()[2] - plant.t_out) * (f.get_state()[2] - plant.t_out);
+    }
+  }
+  e.rms = std::sqrt(sum2 / window_s);
+  e.level_rms = std::sqrt(level2 / window_s);
+  return e;
+}
+
+bool check_compressor_step(int seconds, double peak_ratio) {
+  StepError off = compressor_step(false, seconds);
+  StepError on = compressor_step(true, seconds);
+  bool ok = on.peak <= peak_ratio * off.peak && on.rms < off.rms;
+  printf("\ncompressor step 0 -> 50 Hz (T_out +10 °C, tau 60 s), 150 s after the step, N=8\n");
+  printf("  %-16s %14s %14s %14s\n", "control", "peak dT_out", "rms dT_out", "rms T_out");
+  printf("  %-16s %14.3f %14.3f %14.4f\n", "off", off.peak, off.rms, off.level_rms);
+  printf("  %-16s %14.3f %14.3f %14.4f%s\n", "on", on.peak, on.rms, on.level_rms, ok ? "" : "  FAIL");
+  printf("  peak %.0f %% lower, rms %.0f %% lower\n", 100.0 * (1.0 - on.peak / off.peak),
+         100.0 * (1.0 - on.rms / off.rms));
+  return ok;
+}
+
+struct Arrival {
+  uint32_t arrive_ms;
+  TimedMeasurement m;
+};
+
+// Compressor frequency at t (NaN while the sensor drops out).
+float frequency_at(uint32_t t_ms, int seconds) {
+  int s = static_cast<int>((t_ms - T0_MS) / 1000u);
+  if (s >= seconds / 2 && s < seconds / 2 + 30)
+    return NAN;
+  const float levels[] = {0.0f, 50.0f, 30.0f, 45.0f, 20.0f, 0.0f};
+  return levels[std::min(s * 6 / seconds, 5)];
+}
+
+// The queue step: the input value at the sample time, so a replay sees the same inputs.
+struct QueueStep {
+  Filter *f;
+  ControlState *cs;
+  const HpUkfControlModel *model;
+  uint32_t *last_ms;
+  int seconds;
+  void operator()(uint32_t t_ms, const float *z, const bool *mask) const {
+    float u = frequency_at(t_ms, seconds);
+    step(*f, *cs, model, *last_ms, t_ms, z, mask, &u);
+  }
+};
+
+bool check_queue(int seconds) {
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<uint32_t> jitter(0, 40);
+  std::uniform_int_distribution<uint32_t> inlet_delay(0, 200);
+  std::uniform_int_distribution<uint32_t> outlet_delay(800, 1600);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  const uint32_t phase[M] = {0, 130, 470, 820};
+  std::vector<Arrival> arrivals;
+  std::vector<TimedMeasurement> ordered;
+  Plant plant;
+  float u_held = 0.0f;
+  for (int k = 0; k < seconds; k++) {
+    float u = frequency_at(T0_MS + 1000u * k, seconds);
+    if (std::isfinite(u))
+      u_held = u;
+    plant.advance(u_held, 1.0f);
+    float truth[M] = {BASE[0], BASE[1], plant.t_out, plant.rh_out};
+    for (int c = 0; c < M; c++) {
+      TimedMeasurement m;
+      m.t_ms = T0_MS + 1000u * k + phase[c] + jitter(rng);
+      m.channel = static_cast<uint8_t>(c);
+      m.value = truth[c] + std::sqrt(DEFAULT_R_DIAG[c]) * noise(rng);
+      ordered.push_back(m);
+      arrivals.push_back({m.t_ms + (c <= 1 ? inlet_delay(rng) : outlet_delay(rng)), m});
+    }
+  }
+  std::stable_sort(arrivals.begin(), arrivals.end(),
+                   [](const Arrival &a, const Arrival &b) { return time_before(a.arrive_ms, b.arrive_ms); });
+  std::stable_sort(ordered.begin(), ordered.end(),
+                   [](const TimedMeasurement &a, const TimedMeasurement &b) { return time_before(a.t_ms, b.t_ms); });
+
+  HpUkfControlModel model = compressor_model();
+  Filter filter, ref;
+  init(filter);
+  init(ref);
+  ControlState cs, ref_cs;
+  uint32_t filter_ms = T0_MS, ref_ms = T0_MS;
+  size_t ref_next = 0;
+  MeasurementQueue<Filter, ControlState, QUEUE_SIZE> queue;
+  queue.checkpoint(filter, cs, filter_ms);
+  QueueStep qs{&filter, &cs, &model, &filter_ms, seconds};
+
+  int checks = 0, mismatches = 0;
+  bool kicked = false;
+  size_t a = 0;
+  uint32_t end_ms = arrivals.back().arrive_ms + UPDATE_INTERVAL_MS;
+  for (uint32_t now = T0_MS + UPDATE_INTERVAL_MS / 2; !time_before(end_ms, now); now += UPDATE_INTERVAL_MS) {
+    for (; a < arrivals.size() && time_before(arrivals[a].arrive_ms, now); a++)
+      queue.push(arrivals[a].m);
+    queue.process(filter, cs, filter_ms, now, QUEUE_WINDOW_MS, qs);
+    uint32_t cp_ms = queue.get_checkpoint_ms();
+    for (; ref_next < ordered.size() && !time_before(cp_ms, ordered[ref_next].t_ms); ref_next++) {
+      float z[M] = {NAN, NAN, NAN, NAN};
+      bool mask[M] = {false, false, false, false};
+      z[ordered[ref_next].channel] = ordered[ref_next].value;
+      mask[ordered[ref_next].channel] = true;
+      float u = frequency_at(ordered[ref_next].t_ms, seconds);
+      step(ref, ref_cs, &model, ref_ms, ordered[ref_next].t_ms, z, mask, &u);
+    }
+    kicked = kicked || ref_cs.ff[0] != 0.0f;
+    checks++;
+    const ControlState &ccs = queue.get_extra_checkpoint();
+    bool same = memcmp(queue.get_checkpoint().get_state(), ref.get_state(), sizeof(float) * Filter::N) == 0 &&
+                memcmp(queue.get_checkpoint().get_covariance_packed(), ref.get_covariance_packed(),
+                       sizeof(float) * Filter::N_PACKED) == 0 &&
+                memcmp(&ccs, &ref_cs, sizeof(ControlState)) == 0 && cp_ms == ref_ms;
+    if (!same && mismatches++ == 0)
+      printf("  first mismatch at checkpoint %u ms (ff %.6f vs %.6f)\n", (unsigned) (cp_ms - T0_MS), ccs.ff[0],
+             ref_cs.ff[0]);
+  }
+  bool ok = mismatches == 0 && kicked && queue.get_replays() > 0 && queue.get_dropped() == 0;
+  printf("\nqueue: %zu samples, %d checks, %d mismatch(es), %u replays, %u dropped%s\n", arrivals.size(), checks,
+         mismatches, (unsigned) queue.get_replays(), (unsigned) queue.get_dropped(), ok ? "" : "  FAIL");
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int seconds = 1800;
+  double peak_ratio = 0.5;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      seconds = std::max(600, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--peak-ratio") == 0 && i + 1 < argc) {
+      peak_ratio = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--samples N] [--peak-ratio R]\n", argv[0]);
+      return 2;
+    }
+  }
+  bool ok = check_model();
+  ok = check_compressor_step(seconds, peak_ratio) && ok;
+  ok = check_queue(seconds) && ok;
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+// Host check that event_driven mode runs the same filter as polled mode (no ESPHome headers).
+//
+// Four sensors report once per second, 50 ms apart (the four channels of one trace row arrive at
+// t, t + 50, t + 100 and t + 150 ms). The polled run reads all four at t + 150 ms and steps once
+// per update_interval (1 s); the event run steps on every sample with a single-channel update,
+// as HpUkfComponent::on_measurement_() does. Both scale Q by dt / update_interval before each
+// predict, as HpUkfComponent::filter_step_() does. After every row, once both have fused the
+// same readings, their priors at the next poll are compared for 8 and 4 states (after a 2 min
+// warm-up): the max state difference in units of the polled sigma,
+// max |x_ev - x_poll| / sqrt(P_poll_ii), and the max variance ratio, max(P_ev_ii / P_poll_ii,
+// P_poll_ii / P_ev_ii). The event run with one full Q per sample is reported for comparison;
+// it carries about four times the process noise of the polled run.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_event_check check
+//   tools/hp_ukf_event_check/hp_ukf_event_check [TRACE(.csv|.bin)] [--samples N]
+//
+// Exits non-zero if the dt-scaled event run differs by more than --tolerance sigma (default
+// 0.25), a variance ratio exceeds 1 + --p-tolerance (default 0.15), or a value is not finite.
+
+#include "hp_ukf/hp_ukf_ukf.h"
+#include "hp_ukf_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::HpUkfFilterT;
+using hp_ukf_tools::Sample;
+
+namespace {
+
+constexpr int M = 4;
+constexpr uint32_t UPDATE_INTERVAL_MS = 1000;
+constexpr uint32_t STAGGER_MS = 50;
+constexpr uint32_t WARMUP_MS = 120000;
+
+// 1 s rows of a slow heat pump cycle with sensor noise.
+std::vector<Sample> synthetic_trace(int count) {
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  std::vector<Sample> out;
+  for (int k = 0; k < count; k++) {
+    float phase = 6.2831853f * k / 1800.0f;
+    Sample s;
+    s.t_ms = 1000u * k;
+    s.z[0] = 21.0f + 0.5f * std::sin(phase) + 0.3f * noise(rng);
+    s.z[1] = 45.0f + 2.0f * std::cos(phase) + 0.5f * noise(rng);
+    s.z[2] = 35.0f + 4.0f * std::sin(phase) + 0.03f * noise(rng);
+    s.z[3] = 25.0f - 3.0f * std::sin(phase) + 0.015f * noise(rng);
+    out.push_back(s);
+  }
+  return out;
+}
+
+// HpUkfComponent::filter_step_() without control inputs and diagnostics.
+template<int NX> void step(HpUkfFilterT<NX> &f, uint32_t &last_ms, uint32_t t_ms, const float *z, const bool *mask,
+                           bool scale_q) {
+  int32_t elapsed_ms = static_cast<int32_t>(t_ms - last_ms);
+  float dt_s = hp_ukf_tools::step_dt(last_ms, t_ms);
+  if (elapsed_ms > 0) {
+    if (scale_q)
+      f.set_process_noise_scale(dt_s * 1000.0f / (float) UPDATE_INTERVAL_MS);
+    f.predict(dt_s);
+    last_ms = t_ms;
+  }
+  f.update(z, mask);
+}
+
+template<int NX> void prior(HpUkfFilterT<NX> &f, uint32_t &last_ms, uint32_t t_ms, bool scale_q) {
+  float dt_s = hp_ukf_tools::step_dt(last_ms, t_ms);
+  if (scale_q)
+    f.set_process_noise_scale(dt_s * 1000.0f / (float) UPDATE_INTERVAL_MS);
+  f.predict(dt_s);
+  last_ms = t_ms;
+}
+
+template<int NX> void init(HpUkfFilterT<NX> &f, const Sample &first) {
+  float x0[NX] = {};
+  float P0[NX * NX] = {};
+  for (int c = 0; c < M; c++)
+    x0[c] = std::isfinite(first.z[c]) ? first.z[c] : 20.0f;
+  for (int i = 0; i < NX; i++)
+    P0[i * NX + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+}
+
+struct Diff {
+  double max_dx = 0.0;
+  double max_log_p = 0.0;
+  bool finite = true;
+};
+
+template<int NX> Diff compare(const std::vector<Sample> &trace, bool scale_q) {
+  using Filter = HpUkfFilterT<NX>;
+  Filter polled, event;
+  init(polled, trace[0]);
+  init(event, trace[0]);
+  uint32_t t0 = trace[0].t_ms;
+  uint32_t polled_ms = t0, event_ms = t0;
+  Diff d;
+  for (const Sample &s : trace) {
+    // Event run: one callback per channel, at its own arrival time.
+    for (int c = 0; c < M; c++) {
+      if (!std::isfinite(s.z[c]))
+        continue;
+      float z[M] = {NAN, NAN, NAN, NAN};
+      bool mask[M] = {false, false, false, false};
+      z[c] = s.z[c];
+      mask[c] = true;
+      step(event, event_ms, s.t_ms + c * STAGGER_MS, z, mask, scale_q);
+    }
+    // Polled run: every reading of the row, taken once all four have arrived.
+    bool mask[M];
+    for (int c = 0; c < M; c++)
+      mask[c] = std::isfinite(s.z[c]);
+    step(polled, polled_ms, s.t_ms + (M - 1) * STAGGER_MS, s.z, mask, true);
+
+    if (s.t_ms - t0 < WARMUP_MS)
+      continue;
+    // Both have fused the same readings; compare their priors at the next poll.
+    uint32_t next_ms = s.t_ms + (M - 1) * STAGGER_MS + UPDATE_INTERVAL_MS;
+    Filter pp = polled, pe = event;
+    uint32_t pp_ms = polled_ms, pe_ms = event_ms;
+    prior(pp, pp_ms, next_ms, true);
+    prior(pe, pe_ms, next_ms, scale_q);
+    const float *xp = pp.get_state();
+    const float *xe = pe.get_state();
+    const float *Pp = pp.get_covariance_packed();
+    const float *Pe = pe.get_covariance_packed();
+    for (int i = 0; i < NX; i++) {
+      float vp = Pp[Filter::packed_index(i, i)];
+      float ve = Pe[Filter::packed_index(i, i)];
+      d.finite = d.finite && std::isfinite(xe[i]) && std::isfinite(ve) && ve > 0.0f;
+      if (!d.finite)
+        return d;
+      d.max_dx = std::max(d.max_dx, std::fabs((double) xe[i] - xp[i]) / std::sqrt((double) vp));
+      d.max_log_p = std::max(d.max_log_p, std::fabs(std::log((double) ve / vp)));
+    }
+  }
+  return d;
+}
+
+template<int NX> bool run(const std::vector<Sample> &trace, double tolerance, double p_tolerance) {
+  Diff scaled = compare<NX>(trace, true);
+  Diff unscaled = compare<NX>(trace, false);
+  printf("\nN=%d, %zu rows, event vs polled\n", NX, trace.size());
+  printf("%-12s %14s %14s\n", "Q per step", "max dx/sigma", "max P ratio");
+  bool pass = scaled.finite && scaled.max_dx <= tolerance && scaled.max_log_p <= std::log(1.0 + p_tolerance);
+  printf("%-12s %14.3f %14.3f%s\n", "dt-scaled", scaled.max_dx, std::exp(scaled.max_log_p), pass ? "" : "  FAIL");
+  printf("%-12s %14.3f %14.3f  (one full Q per sample, reference only)\n", "unscaled", unscaled.max_dx,
+         std::exp(unscaled.max_log_p));
+  return pass;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *trace_path = nullptr;
+  int samples = 3600;
+  double tolerance = 0.25;
+  double p_tolerance = 0.15;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = std::max(2, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--p-tolerance") == 0 && i + 1 < argc) {
+      p_tolerance = atof(argv[++i]);
+    } else if (argv[i][0] != '-' && trace_path == nullptr) {
+      trace_path = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [TRACE(.csv|.bin)] [--samples N] [--tolerance T] [--p-tolerance T]\n", argv[0]);
+      return 2;
+    }
+  }
+  std::vector<Sample> trace;
+  if (trace_path != nullptr) {
+    if (!hp_ukf_tools::load_trace(trace_path, trace))
+      return 2;
+  } else {
+    trace = synthetic_trace(samples);
+  }
+  bool ok = run<8>(trace, tolerance, p_tolerance);
+  ok = run<4>(trace, tolerance, p_tolerance) && ok;
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
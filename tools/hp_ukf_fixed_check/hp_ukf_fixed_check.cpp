@@ -0,0 +1,228 @@
+// Host-side accuracy check of the fixed-point backend (HpUkfFixedFilterT) against the float
+// filter (HpUkfFilterT) on a recorded or synthetic trace (no ESPHome headers).
+//
+// Both filters replay the trace with the component's call sequence. For every state the report
+// gives the max and RMS difference, and the max difference in units of the float filter's
+// standard deviation sqrt(P_ii). The float reference is linear_kf (the algorithm the fixed
+// backend implements); --mode ukf compares against the sigma-point filter instead.
+//
+// Without a trace a synthetic 1 Hz heat pump cycle is used in which T_out goes missing for
+// --outage hours (default 24) half way through: the fixed-point P block of that channel then
+// grows by dt^2 on every predict without an update, and has to stay finite and track the float
+// variance until the sensor comes back.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_fixed_check check
+//   tools/hp_ukf_fixed_check/hp_ukf_fixed_check trace.csv --tolerance 0.05
+//
+// Exits non-zero if any state differs by more than --tolerance sigma (default 0.05) after the
+// --skip warm-up rows, if either filter produced a non-finite state, or (synthetic trace) if the
+// T_out variance at the end of the outage differs from the float filter by more than 1 %.
+
+#include "hp_ukf/hp_ukf_fixed.h"
+#include "hp_ukf/hp_ukf_ukf.h"
+#include "hp_ukf_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::FilterMode;
+using esphome::hp_ukf::HpUkfFilterT;
+using esphome::hp_ukf::HpUkfFixedFilterT;
+using hp_ukf_tools::Sample;
+
+namespace {
+
+constexpr int M = 4;
+const char *const STATE_NAMES[8] = {"T_in", "RH_in", "T_out", "RH_out", "dT_in", "dT_out", "dRH_in", "dRH_out"};
+
+struct Options {
+  const char *trace_path = nullptr;
+  int n = 8;
+  FilterMode mode = esphome::hp_ukf::FILTER_MODE_LINEAR_KF;
+  int skip = 60;
+  double tolerance = 0.05;
+  int samples = 7200;
+  float outage_hours = 24.0f;
+};
+
+constexpr int OUTAGE_CHANNEL = 2;
+
+// 1 s samples of a defrost-like cycle with sensor noise and occasional missing readings;
+// OUTAGE_CHANNEL is missing for outage_s seconds after the first half.
+std::vector<Sample> synthetic_trace(int count, int outage_s) {
+  std::mt19937 rng(2024);
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::vector<Sample> out;
+  for (int k = 0; k < count + outage_s; k++) {
+    float phase = 6.2831853f * k / 900.0f;
+    Sample s;
+    s.t_ms = 1000u * k;
+    s.z[0] = 21.0f + 0.5f * std::sin(phase) + noise(rng);
+    s.z[1] = 45.0f + 2.0f * std::cos(phase) + 4.0f * noise(rng);
+    s.z[2] = 35.0f + 8.0f * std::sin(phase) + noise(rng);
+    s.z[3] = 25.0f - 5.0f * std::sin(phase) + 4.0f * noise(rng);
+    for (float &z : s.z)
+      if (u(rng) < 0.02f)
+        z = NAN;
+    if (k >= count / 2 && k < count / 2 + outage_s)
+      s.z[OUTAGE_CHANNEL] = NAN;
+    out.push_back(s);
+  }
+  return out;
+}
+
+template<typename F> void init_filter(F &f, FilterMode mode, const std::vector<Sample> &trace) {
+  constexpr int n = F::N;
+  f.set_filter_mode(mode);
+  float x0[n] = {20.0f, 50.0f, 20.0f, 50.0f};
+  for (int c = 0; c < M; c++) {
+    for (const Sample &s : trace) {
+      if (std::isfinite(s.z[c])) {
+        x0[c] = s.z[c];
+        break;
+      }
+    }
+  }
+  float P0[n * n] = {};
+  for (int i = 0; i < n; i++)
+    P0[i * n + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+}
+
+// outage_end: index of the first sample after the synthetic outage (0 = none).
+template<int NX> int run(const std::vector<Sample> &trace, const Options &opt, size_t outage_end) {
+  HpUkfFilterT<NX> ref;
+  HpUkfFixedFilterT<NX> fix;
+  init_filter(ref, opt.mode, trace);
+  init_filter(fix, opt.mode, trace);
+
+  double max_abs[NX] = {}, sum_sq[NX] = {}, max_sigma[NX] = {};
+  long count = 0;
+  bool finite = true;
+  double outage_ref = 0.0, outage_fix = 0.0;
+  uint32_t last_ms = trace[0].t_ms;
+  for (size_t k = 0; k < trace.size() && finite; k++) {
+    const Sample &s = trace[k];
+    float dt_s = hp_ukf_tools::step_dt(last_ms, s.t_ms);
+    if (dt_s > 0.0f) {
+      ref.predict(dt_s);
+      fix.predict(dt_s);
+      last_ms = s.t_ms;
+    }
+    if (outage_end > 0 && k == outage_end) {
+      int p = HpUkfFilterT<NX>::packed_index(OUTAGE_CHANNEL, OUTAGE_CHANNEL);
+      outage_ref = ref.get_covariance_packed()[p];
+      outage_fix = fix.get_covariance_packed()[p];
+    }
+    bool mask[M];
+    for (int c = 0; c < M; c++)
+      mask[c] = std::isfinite(s.z[c]);
+    ref.update(s.z, mask);
+    fix.update(s.z, mask);
+
+    const float *xr = ref.get_state();
+    const float *xf = fix.get_state();
+    const float *Pr = ref.get_covariance_packed();
+    for (int i = 0; i < NX; i++)
+      finite = finite && std::isfinite(xr[i]) && std::isfinite(xf[i]);
+    if (static_cast<int>(k) < opt.skip)
+      continue;
+    for (int i = 0; i < NX; i++) {
+      double d = std::fabs(static_cast<double>(xf[i]) - xr[i]);
+      double sigma = std::sqrt(std::max(static_cast<double>(Pr[HpUkfFilterT<NX>::packed_index(i, i)]), 1e-30));
+      max_abs[i] = std::max(max_abs[i], d);
+      sum_sq[i] += d * d;
+      max_sigma[i] = std::max(max_sigma[i], d / sigma);
+    }
+    count++;
+  }
+
+  // Final covariance diagonal: relative difference of the fixed-point variances.
+  const float *Pr = ref.get_covariance_packed();
+  const float *Pf = fix.get_covariance_packed();
+
+  printf("%zu samples, %ld compared, reference %s, n=%d\n\n", trace.size(), count,
+         opt.mode == esphome::hp_ukf::FILTER_MODE_LINEAR_KF ? "linear_kf" : "ukf", NX);
+  printf("%-8s %12s %12s %12s %12s\n", "state", "max |dx|", "rms dx", "max dx/sigma", "final dP/P");
+  bool ok = finite && count > 0;
+  for (int i = 0; i < NX; i++) {
+    int p = HpUkfFilterT<NX>::packed_index(i, i);
+    double rel_p = Pr[p] > 0.0f ? std::fabs(static_cast<double>(Pf[p]) - Pr[p]) / Pr[p] : 0.0;
+    double rms = count > 0 ? std::sqrt(sum_sq[i] / count) : 0.0;
+    bool pass = max_sigma[i] <= opt.tolerance;
+    printf("%-8s %12.3e %12.3e %12.4f %12.3e%s\n", STATE_NAMES[i], max_abs[i], rms, max_sigma[i], rel_p,
+           pass ? "" : "  FAIL");
+    ok = ok && pass;
+  }
+  if (outage_end > 0) {
+    double rel = std::fabs(outage_fix - outage_ref) / outage_ref;
+    bool pass = std::isfinite(outage_fix) && rel <= 0.01;
+    printf("\n%s variance after %.1f h missing: float %.4e, fixed %.4e (%.2e relative)%s\n",
+           STATE_NAMES[OUTAGE_CHANNEL], opt.outage_hours, outage_ref, outage_fix, rel, pass ? "" : "  FAIL");
+    ok = ok && pass;
+  }
+  if (!finite)
+    fprintf(stderr, "FAIL: non-finite state\n");
+  return ok ? 0 : 1;
+}
+
+void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [TRACE(.csv|.bin)] [--n 4|8] [--mode linear_kf|ukf] [--skip ROWS] [--tolerance SIGMA]"
+          " [--samples N] [--outage HOURS]\n",
+          argv0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      opt.n = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+      i++;
+      if (strcmp(argv[i], "ukf") == 0) {
+        opt.mode = esphome::hp_ukf::FILTER_MODE_UKF;
+      } else if (strcmp(argv[i], "linear_kf") != 0) {
+        usage(argv[0]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc) {
+      opt.skip = std::max(0, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      opt.tolerance = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      opt.samples = std::max(2, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--outage") == 0 && i + 1 < argc) {
+      opt.outage_hours = std::max(0.0f, static_cast<float>(atof(argv[++i])));
+    } else if (argv[i][0] != '-' && opt.trace_path == nullptr) {
+      opt.trace_path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (opt.n != 4 && opt.n != 8) {
+    usage(argv[0]);
+    return 2;
+  }
+  std::vector<Sample> trace;
+  size_t outage_end = 0;
+  if (opt.trace_path != nullptr) {
+    if (!hp_ukf_tools::load_trace(opt.trace_path, trace))
+      return 2;
+  } else {
+    int outage_s = static_cast<int>(opt.outage_hours * 3600.0f);
+    trace = synthetic_trace(opt.samples, outage_s);
+    outage_end = outage_s > 0 ? static_cast<size_t>(opt.samples / 2 + outage_s) : 0;
+  }
+  return opt.n == 8 ? run<8>(trace, opt, outage_end) : run<4>(trace, opt, outage_end);
+}
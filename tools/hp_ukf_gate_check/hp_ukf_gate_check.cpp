@@ -0,0 +1,216 @@
+// Host check of the innovation gate (HpUkfInnovationGate in HpUkfFilterT, no ESPHome headers).
+//
+// A synthetic 1 Hz trace (known truth, noise at the default R) gets single-sample glitches on
+// random channels every GLITCH_PERIOD samples and a persistent outlet temperature step (a
+// defrost) half way through. Every filter mode replays it with EM auto-tune, with and without
+// `innovation_gate`, and the report gives per mode:
+//   rms       RMS error of the four levels against the truth
+//   glitch    max error in the 10 s after a glitch
+//   r_t_in    EM-adapted R of T_in relative to the value on the clean trace
+//   step      seconds until T_out is back within 0.5 °C of the truth after the step
+//   rejected / resets   gate counters
+// A second run starts each mode with Q far too small and no EM (P collapses) on a clean trace
+// with a 1 °C T_in step inside the gate; only the divergence detector can speed up the catch-up.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_gate_check check
+//
+// Exits non-zero if the gate does not lower rms and glitch error in every mode, if a step takes
+// longer than max_rejections + 30 s to track, if the clean trace trips the gate, or if the
+// divergence reset does not lower the error of the overconfident filter.
+
+#include "hp_ukf/hp_ukf_ukf.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::FilterMode;
+using esphome::hp_ukf::HpUkfFilterT;
+
+namespace {
+
+constexpr int N = 8;
+constexpr int M = 4;
+constexpr int SAMPLES = 4 * 3600;
+constexpr int GLITCH_PERIOD = 300;
+constexpr int STEP_AT = SAMPLES / 2 + GLITCH_PERIOD / 2;
+constexpr float STEP_SIZE = 8.0f;
+constexpr float SMALL_STEP_SIZE = 1.0f;
+constexpr float GATE_SIGMA = 5.0f;
+constexpr int MAX_REJECTIONS = 5;
+
+struct Trace {
+  std::vector<float> truth;  // SAMPLES x M
+  std::vector<float> z;      // SAMPLES x M
+  std::vector<bool> glitch;  // sample carries a glitch
+};
+
+enum Change { NONE, STEP, SMALL_STEP };
+
+// STEP: T_out jumps by STEP_SIZE at STEP_AT (far outside the gate); SMALL_STEP: T_in jumps by
+// SMALL_STEP_SIZE (about 3 sigma of its noise, inside the gate).
+Trace make_trace(bool glitches, Change change, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> gauss(0.0f, 1.0f);
+  std::uniform_int_distribution<int> channel(0, M - 1);
+  Trace tr;
+  tr.truth.resize(SAMPLES * M);
+  tr.z.resize(SAMPLES * M);
+  tr.glitch.assign(SAMPLES, false);
+  for (int k = 0; k < SAMPLES; k++) {
+    float t = (float) k;
+    float *x = &tr.truth[k * M];
+    x[0] = 21.0f + 0.5f * std::sin(t / 1800.0f) + (change == SMALL_STEP && k >= STEP_AT ? SMALL_STEP_SIZE : 0.0f);
+    x[1] = 45.0f + 2.0f * std::sin(t / 2400.0f);
+    x[2] = 35.0f + 1.0f * std::sin(t / 1200.0f) + (change == STEP && k >= STEP_AT ? STEP_SIZE : 0.0f);
+    x[3] = 25.0f - 1.0f * std::sin(t / 1200.0f);
+    for (int c = 0; c < M; c++)
+      tr.z[k * M + c] = x[c] + std::sqrt(esphome::hp_ukf::DEFAULT_R_DIAG[c]) * gauss(rng);
+    if (glitches && k > 0 && k % GLITCH_PERIOD == 0) {
+      // I2C glitch: one reading far off (SHT3x error values sit near the range ends).
+      int c = channel(rng);
+      tr.z[k * M + c] = (c % 2 == 0) ? 130.0f : 0.0f;
+      tr.glitch[k] = true;
+    }
+  }
+  return tr;
+}
+
+struct Result {
+  double rms = 0.0;
+  double glitch_max = 0.0;
+  float r_t_in = 0.0f;
+  int step_s = -1;
+  uint32_t rejected = 0;
+  uint32_t resets = 0;
+  bool finite = true;
+};
+
+// overconfident: Q at 1e-8 of the default and no EM, so P collapses and the filter lags any
+// change (what the divergence detector is for).
+Result run(FilterMode mode, bool gate, const Trace &tr, bool overconfident = false) {
+  HpUkfFilterT<N> f;
+  f.set_filter_mode(mode);
+  float x0[N] = {};
+  float P0[N * N] = {};
+  for (int c = 0; c < M; c++)
+    x0[c] = tr.z[c];
+  for (int i = 0; i < N; i++)
+    P0[i * N + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+  if (overconfident) {
+    float Q[N * N] = {};
+    for (int i = 0; i < N; i++)
+      Q[i * N + i] = 1e-8f * esphome::hp_ukf::DEFAULT_Q_DIAG[i];
+    f.set_process_noise(Q);
+  } else {
+    f.enable_em_autotune(true);
+  }
+  if (gate) {
+    f.set_innovation_gate(GATE_SIGMA);
+    f.set_gate_max_rejections(MAX_REJECTIONS);
+    f.set_divergence_nis(4.0f);
+  }
+
+  Result res;
+  double sum_sq = 0.0;
+  long count = 0;
+  int since_glitch = 1000;
+  for (int k = 0; k < SAMPLES; k++) {
+    bool mask[M] = {true, true, true, true};
+    if (k > 0)
+      f.predict(1.0f);
+    f.update(&tr.z[k * M], mask);
+    const float *x = f.get_state();
+    since_glitch = tr.glitch[k] ? 0 : since_glitch + 1;
+    for (int c = 0; c < M; c++) {
+      if (!std::isfinite(x[c]))
+        res.finite = false;
+      double e = x[c] - tr.truth[k * M + c];
+      if (k >= 60) {
+        sum_sq += e * e;
+        count++;
+      }
+      if (since_glitch <= 10 && std::fabs(e) > res.glitch_max)
+        res.glitch_max = std::fabs(e);
+    }
+    if (k >= STEP_AT && res.step_s < 0 && std::fabs(x[2] - tr.truth[k * M + 2]) < 0.5f)
+      res.step_s = k - STEP_AT;
+    if (k == STEP_AT - 1) {
+      float r[M];
+      f.get_measurement_noise_diag(r);
+      res.r_t_in = r[0];
+    }
+  }
+  res.rms = std::sqrt(sum_sq / (double) count);
+  res.rejected = f.get_rejected_count();
+  res.resets = f.get_reset_count();
+  return res;
+}
+
+}  // namespace
+
+int main() {
+  const struct {
+    const char *name;
+    FilterMode mode;
+  } modes[] = {
+      {"ukf", esphome::hp_ukf::FILTER_MODE_UKF},
+      {"sr_ukf", esphome::hp_ukf::FILTER_MODE_SR_UKF},
+      {"linear_kf", esphome::hp_ukf::FILTER_MODE_LINEAR_KF},
+      {"ud", esphome::hp_ukf::FILTER_MODE_UD},
+  };
+  Trace clean = make_trace(false, NONE, 1);
+  Trace dirty = make_trace(true, STEP, 1);
+  Trace small_step = make_trace(false, SMALL_STEP, 1);
+  int glitches = 0;
+  for (bool g : dirty.glitch)
+    glitches += g ? 1 : 0;
+  printf("%d samples, %d glitches, %.0f °C T_out step at %d s, gate %.0f sigma\n", SAMPLES, glitches, STEP_SIZE,
+         STEP_AT, GATE_SIGMA);
+  printf("%-10s %-5s %8s %8s %8s %6s %9s %7s\n", "mode", "gate", "rms", "glitch", "r_t_in", "step", "rejected",
+         "resets");
+
+  bool ok = true;
+  for (const auto &m : modes) {
+    Result base = run(m.mode, false, clean);
+    Result gated_clean = run(m.mode, true, clean);
+    Result off = run(m.mode, false, dirty);
+    Result on = run(m.mode, true, dirty);
+    Result lag_off = run(m.mode, false, small_step, true);
+    Result lag_on = run(m.mode, true, small_step, true);
+    for (const Result *r : {&off, &on}) {
+      printf("%-10s %-5s %8.4f %8.3f %8.2f %5ds %9u %7u\n", m.name, r == &on ? "on" : "off", r->rms,
+             r->glitch_max, r->r_t_in / base.r_t_in, r->step_s, (unsigned) r->rejected, (unsigned) r->resets);
+    }
+    printf("%-10s %-5s %8.4f -> %.4f with the gate (small Q, 1 °C T_in step: %u resets)\n", m.name, "lag", lag_off.rms,
+           lag_on.rms, (unsigned) lag_on.resets);
+    if (!(lag_on.rms < lag_off.rms)) {
+      printf("FAIL %s: divergence reset does not help an overconfident filter (rms %.4f vs %.4f)\n", m.name,
+             lag_on.rms, lag_off.rms);
+      ok = false;
+    }
+    if (!off.finite || !on.finite || !gated_clean.finite) {
+      printf("FAIL %s: non-finite state\n", m.name);
+      ok = false;
+    }
+    if (!(on.rms < off.rms) || !(on.glitch_max < off.glitch_max)) {
+      printf("FAIL %s: gate does not reduce the glitch error\n", m.name);
+      ok = false;
+    }
+    if (on.step_s < 0 || on.step_s > MAX_REJECTIONS + 30) {
+      printf("FAIL %s: step not tracked within %d s\n", m.name, MAX_REJECTIONS + 30);
+      ok = false;
+    }
+    if (gated_clean.rejected > 2 || gated_clean.resets > 2) {
+      printf("FAIL %s: clean trace tripped the gate (%u rejected, %u resets)\n", m.name,
+             (unsigned) gated_clean.rejected, (unsigned) gated_clean.resets);
+      ok = false;
+    }
+  }
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
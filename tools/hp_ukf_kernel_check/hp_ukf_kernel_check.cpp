@@ -0,0 +1,166 @@
+// Host-side equivalence check of the kernel backends in hp_ukf_kernels.h (no ESPHome headers).
+//
+// Runs every kernel of HpUkfKernelsT with the reference ScalarBackend and the GCC VectorBackend
+// on random inputs of the shapes the filter uses (n = 4 and 8 states, 2n+1 sigma points,
+// 1..4 available measurements) and reports the largest difference in units in the last place.
+// The backends perform the same operations in the same order, so the expected difference is 0.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_kernel_check check
+//   tools/hp_ukf_kernel_check/hp_ukf_kernel_check --trials 2000 --ulps 0
+//
+// Exits non-zero if any output differs by more than --ulps.
+
+#include "hp_ukf/hp_ukf_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using esphome::hp_ukf::HpUkfKernelsT;
+using esphome::hp_ukf::ScalarBackend;
+using esphome::hp_ukf::VectorBackend;
+
+namespace {
+
+using Ref = HpUkfKernelsT<ScalarBackend>;
+using Vec = HpUkfKernelsT<VectorBackend>;
+
+constexpr int MAX_N = 8;
+constexpr int MAX_COLS = 2 * MAX_N + 1;
+
+// Distance between two floats in representable steps (monotonic integer mapping).
+int64_t ulp_distance(float a, float b) {
+  if (std::isnan(a) || std::isnan(b))
+    return std::isnan(a) && std::isnan(b) ? 0 : INT64_MAX;
+  int32_t ia, ib;
+  memcpy(&ia, &a, 4);
+  memcpy(&ib, &b, 4);
+  int64_t la = ia < 0 ? static_cast<int64_t>(INT32_MIN) - ia : ia;
+  int64_t lb = ib < 0 ? static_cast<int64_t>(INT32_MIN) - ib : ib;
+  return la > lb ? la - lb : lb - la;
+}
+
+struct Report {
+  const char *name;
+  int64_t max_ulps = 0;
+  long outputs = 0;
+};
+
+void compare(Report &rep, const float *ref, const float *vec, int count) {
+  for (int i = 0; i < count; i++)
+    rep.max_ulps = std::max(rep.max_ulps, ulp_distance(ref[i], vec[i]));
+  rep.outputs += count;
+}
+
+struct Inputs {
+  float D[MAX_N * MAX_COLS];
+  float add[MAX_N * (MAX_N + 1) / 2];
+  float Pxz[MAX_N * 4];
+  float S[4 * 4];
+  float v[4];
+  float Pidx[4 * MAX_N];
+  float A[MAX_N * MAX_N];
+  float C[MAX_N * 4];
+  int idx[4];
+};
+
+void fill(std::mt19937 &rng, int n, int m, Inputs &in) {
+  std::uniform_real_distribution<float> u(-2.0f, 2.0f);
+  for (float &x : in.D)
+    x = u(rng);
+  for (float &x : in.add)
+    x = u(rng);
+  for (float &x : in.Pxz)
+    x = u(rng);
+  for (float &x : in.S)
+    x = u(rng);
+  for (float &x : in.v)
+    x = u(rng);
+  for (float &x : in.Pidx)
+    x = u(rng);
+  for (float &x : in.A)
+    x = u(rng);
+  for (float &x : in.C)
+    x = u(rng);
+  // m distinct measured states out of the first four, in increasing order (as available_indices).
+  int order[4] = {0, 1, 2, 3};
+  std::shuffle(order, order + 4, rng);
+  std::sort(order, order + m);
+  for (int i = 0; i < m; i++)
+    in.idx[i] = order[i];
+  (void) n;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int trials = 1000;
+  int64_t max_ulps = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+      trials = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--ulps") == 0 && i + 1 < argc) {
+      max_ulps = atol(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--trials N] [--ulps U]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  Report reports[] = {{"weighted_gram_packed"}, {"weighted_cross"}, {"mat_mul (K)"},
+                      {"mat_mul (K*innov)"},    {"mat_mul_add (A)"}, {"sym_update_packed"}};
+  std::mt19937 rng(12345);
+  const float w0 = -1.5f, w = 0.15625f;
+  for (int t = 0; t < trials; t++) {
+    for (int n : {4, 8}) {
+      int cols = 2 * n + 1;
+      for (int m = 1; m <= 4; m++) {
+        Inputs in;
+        fill(rng, n, m, in);
+        float r[MAX_N * MAX_N], v[MAX_N * MAX_N];
+
+        Ref::weighted_gram_packed(in.D, n, cols, w0, w, in.add, r);
+        Vec::weighted_gram_packed(in.D, n, cols, w0, w, in.add, v);
+        compare(reports[0], r, v, n * (n + 1) / 2);
+
+        Ref::weighted_cross(in.D, n, cols, in.idx, m, w0, w, r);
+        Vec::weighted_cross(in.D, n, cols, in.idx, m, w0, w, v);
+        compare(reports[1], r, v, n * m);
+
+        Ref::mat_mul(in.Pxz, in.S, n, m, m, r);
+        Vec::mat_mul(in.Pxz, in.S, n, m, m, v);
+        compare(reports[2], r, v, n * m);
+
+        Ref::mat_mul(in.Pxz, in.v, n, m, 1, r);
+        Vec::mat_mul(in.Pxz, in.v, n, m, 1, v);
+        compare(reports[3], r, v, n);
+
+        memcpy(r, in.A, sizeof(float) * n * n);
+        memcpy(v, in.A, sizeof(float) * n * n);
+        Ref::mat_mul_add(in.Pxz, in.Pidx, n, m, n, -1.0f, r);
+        Vec::mat_mul_add(in.Pxz, in.Pidx, n, m, n, -1.0f, v);
+        compare(reports[4], r, v, n * n);
+
+        Ref::sym_update_packed(in.A, n, in.C, in.Pxz, m, r);
+        Vec::sym_update_packed(in.A, n, in.C, in.Pxz, m, v);
+        compare(reports[5], r, v, n * (n + 1) / 2);
+      }
+    }
+  }
+
+  printf("scalar vs vector backend, %d trials x n in {4, 8} x m in 1..4\n\n", trials);
+  printf("%-22s %10s %10s\n", "kernel", "outputs", "max ulps");
+  bool ok = true;
+  for (const Report &rep : reports) {
+    bool pass = rep.max_ulps <= max_ulps;
+    printf("%-22s %10ld %10lld%s\n", rep.name, rep.outputs, static_cast<long long>(rep.max_ulps),
+           pass ? "" : "  FAIL");
+    ok = ok && pass;
+  }
+  return ok ? 0 : 1;
+}
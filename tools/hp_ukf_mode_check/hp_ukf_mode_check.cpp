@@ -0,0 +1,196 @@
+// Host check that every filter_mode and update option gives the plain ukf estimate (no ESPHome
+// headers).
+//
+// The model is linear and H selects states, so sr_ukf, linear_kf, ud, sequential_update and
+// fused_predict_update are exact reformulations of the ukf filter and may differ from it only
+// by float rounding. One trace (a synthetic 1 Hz heat pump cycle with missing samples, or a
+// recorded one) is replayed through every variant with the component's call sequence
+// (predict + update, or predict_update when fused), starting from a diagonal P0. Per variant
+// and state dimension the report gives, over all samples, the max state difference in units of
+// the reference sigma, max |x_i - x_ref_i| / sqrt(P_ii), and the max covariance difference,
+// max |P_ij - P_ref_ij| / sqrt(P_ii * P_jj).
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_mode_check check
+//   tools/hp_ukf_mode_check/hp_ukf_mode_check trace.csv --tolerance 2e-3 --p-tolerance 1e-2
+//
+// Exits non-zero if any variant's state differs by more than --tolerance (default 2e-3), its
+// covariance by more than --p-tolerance (default 1e-2), or it produced a non-finite state.
+// The covariance bound is looser because the first updates shrink a variance from P0 = 1 to
+// about R: sr_ukf's rank-1 downdate then cancels to ~3e-3, the Joseph forms to ~3e-4.
+
+#include "hp_ukf/hp_ukf_ukf.h"
+#include "hp_ukf_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::FilterMode;
+using esphome::hp_ukf::HpUkfFilterT;
+using hp_ukf_tools::Sample;
+
+namespace {
+
+constexpr int M = 4;
+
+struct Variant {
+  const char *name;
+  FilterMode mode;
+  bool sequential;
+  bool fused;
+};
+
+const Variant VARIANTS[] = {
+    {"ukf+sequential", esphome::hp_ukf::FILTER_MODE_UKF, true, false},
+    {"ukf+fused", esphome::hp_ukf::FILTER_MODE_UKF, false, true},
+    {"ukf+fused+seq", esphome::hp_ukf::FILTER_MODE_UKF, true, true},
+    {"sr_ukf", esphome::hp_ukf::FILTER_MODE_SR_UKF, false, false},
+    {"sr_ukf+fused", esphome::hp_ukf::FILTER_MODE_SR_UKF, false, true},
+    {"linear_kf", esphome::hp_ukf::FILTER_MODE_LINEAR_KF, false, false},
+    {"ud", esphome::hp_ukf::FILTER_MODE_UD, false, false},
+};
+
+// 1 s samples of a defrost-like cycle with sensor noise and occasional missing readings.
+std::vector<Sample> synthetic_trace(int count) {
+  std::mt19937 rng(2024);
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::vector<Sample> out;
+  for (int k = 0; k < count; k++) {
+    float phase = 6.2831853f * k / 900.0f;
+    Sample s;
+    s.t_ms = 1000u * k;
+    s.z[0] = 21.0f + 0.5f * std::sin(phase) + noise(rng);
+    s.z[1] = 45.0f + 2.0f * std::cos(phase) + 4.0f * noise(rng);
+    s.z[2] = 35.0f + 8.0f * std::sin(phase) + noise(rng);
+    s.z[3] = 25.0f - 5.0f * std::sin(phase) + 4.0f * noise(rng);
+    for (float &z : s.z)
+      if (u(rng) < 0.02f)
+        z = NAN;
+    out.push_back(s);
+  }
+  return out;
+}
+
+// State (N floats) and packed P after every sample.
+struct Run {
+  std::vector<float> x;
+  std::vector<float> P;
+  bool finite = true;
+};
+
+template<int NX> Run replay(const std::vector<Sample> &trace, FilterMode mode, bool sequential, bool fused) {
+  using Filter = HpUkfFilterT<NX>;
+  Filter f;
+  f.set_filter_mode(mode);
+  f.set_sequential_update(sequential);
+  float x0[NX] = {20.0f, 50.0f, 20.0f, 50.0f};
+  for (int c = 0; c < M; c++) {
+    for (const Sample &s : trace) {
+      if (std::isfinite(s.z[c])) {
+        x0[c] = s.z[c];
+        break;
+      }
+    }
+  }
+  float P0[NX * NX] = {};
+  for (int i = 0; i < NX; i++)
+    P0[i * NX + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+
+  Run run;
+  run.x.resize(trace.size() * NX);
+  run.P.resize(trace.size() * Filter::N_PACKED);
+  uint32_t last_ms = trace[0].t_ms;
+  for (size_t k = 0; k < trace.size(); k++) {
+    const Sample &s = trace[k];
+    bool mask[M];
+    for (int c = 0; c < M; c++)
+      mask[c] = std::isfinite(s.z[c]);
+    float dt_s = hp_ukf_tools::step_dt(last_ms, s.t_ms);
+    if (dt_s > 0.0f)
+      last_ms = s.t_ms;
+    if (dt_s > 0.0f && fused) {
+      f.predict_update(dt_s, s.z, mask);
+    } else {
+      if (dt_s > 0.0f)
+        f.predict(dt_s);
+      f.update(s.z, mask);
+    }
+    memcpy(&run.x[k * NX], f.get_state(), sizeof(float) * NX);
+    memcpy(&run.P[k * Filter::N_PACKED], f.get_covariance_packed(), sizeof(float) * Filter::N_PACKED);
+    for (int i = 0; i < NX; i++)
+      run.finite = run.finite && std::isfinite(f.get_state()[i]);
+  }
+  return run;
+}
+
+template<int NX> bool compare(const std::vector<Sample> &trace, double tolerance, double p_tolerance) {
+  using Filter = HpUkfFilterT<NX>;
+  Run ref = replay<NX>(trace, esphome::hp_ukf::FILTER_MODE_UKF, false, false);
+  printf("\nN=%d, %zu samples, reference ukf\n", NX, trace.size());
+  printf("%-15s %14s %14s\n", "variant", "max dx/sigma", "max dP (corr)");
+  bool ok = ref.finite;
+  for (const Variant &v : VARIANTS) {
+    Run run = replay<NX>(trace, v.mode, v.sequential, v.fused);
+    double max_dx = 0.0, max_dp = 0.0;
+    for (size_t k = 0; k < trace.size(); k++) {
+      const float *xr = &ref.x[k * NX];
+      const float *xv = &run.x[k * NX];
+      const float *Pr = &ref.P[k * Filter::N_PACKED];
+      const float *Pv = &run.P[k * Filter::N_PACKED];
+      for (int i = 0; i < NX; i++) {
+        double sii = std::sqrt(std::max((double) Pr[Filter::packed_index(i, i)], 1e-30));
+        max_dx = std::max(max_dx, std::fabs((double) xv[i] - xr[i]) / sii);
+        for (int j = i; j < NX; j++) {
+          double sjj = std::sqrt(std::max((double) Pr[Filter::packed_index(j, j)], 1e-30));
+          int p = Filter::packed_index(i, j);
+          max_dp = std::max(max_dp, std::fabs((double) Pv[p] - Pr[p]) / (sii * sjj));
+        }
+      }
+    }
+    bool pass = run.finite && max_dx <= tolerance && max_dp <= p_tolerance;
+    printf("%-15s %14.3e %14.3e%s\n", v.name, max_dx, max_dp, pass ? "" : "  FAIL");
+    ok = ok && pass;
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *trace_path = nullptr;
+  int samples = 7200;
+  double tolerance = 2e-3;
+  double p_tolerance = 1e-2;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = std::max(2, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--p-tolerance") == 0 && i + 1 < argc) {
+      p_tolerance = atof(argv[++i]);
+    } else if (argv[i][0] != '-' && trace_path == nullptr) {
+      trace_path = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [TRACE(.csv|.bin)] [--samples N] [--tolerance T] [--p-tolerance T]\n", argv[0]);
+      return 2;
+    }
+  }
+  std::vector<Sample> trace;
+  if (trace_path != nullptr) {
+    if (!hp_ukf_tools::load_trace(trace_path, trace))
+      return 2;
+  } else {
+    trace = synthetic_trace(samples);
+  }
+  bool ok = compare<8>(trace, tolerance, p_tolerance);
+  ok = compare<4>(trace, tolerance, p_tolerance) && ok;
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
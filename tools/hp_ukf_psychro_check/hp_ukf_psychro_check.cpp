@@ -0,0 +1,179 @@
+// Host check of the moist-air outputs (hp_ukf_psychro.h, no ESPHome headers).
+//
+// Table: saturation_vapor_pressure() against the Magnus formula it tabulates,
+// 6.112 * exp(17.62 T / (243.12 + T)) hPa, every 0.01 °C over -40..80 °C (max relative error,
+// claimed under 0.125 %), and dew_point_from_vapor_pressure() as its inverse (round trip) and
+// against the closed-form Magnus dew point (claimed within 0.02 °C).
+//
+// Unscented transform: psychro_unscented() against a Monte Carlo estimate (double precision,
+// Gaussian levels drawn with the given covariance, pushed through psychro_outputs()) at heating,
+// cooling and cold operating points, with level sigmas from the filter's typical range up to
+// several times that. Reported per output: the mean difference in units of the Monte Carlo
+// sigma and the variance ratio UT / MC.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_psychro_check check
+//   tools/hp_ukf_psychro_check/hp_ukf_psychro_check [--draws N]
+//
+// Exits non-zero if the table error reaches 0.125 %, the dew point round trip is off by more than
+// 0.001 °C or the dew point by more than 0.02 °C from the closed form, a UT mean is off by more
+// than --tolerance MC sigmas (default 0.03), or a UT variance differs from the Monte Carlo one by
+// more than a factor 1 + --var-tolerance (default 0.02).
+
+#include "hp_ukf/hp_ukf_psychro.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace esphome::hp_ukf;
+
+namespace {
+
+constexpr float PRESSURE_HPA = 1013.25f;
+
+const char *const OUTPUT_NAMES[PSYCHRO_OUTPUT_COUNT] = {
+    "dew point in", "dew point out", "abs hum in", "abs hum out", "enthalpy in", "enthalpy out", "enthalpy delta",
+};
+
+double magnus_es(double t) { return 6.112 * std::exp(17.62 * t / (243.12 + t)); }
+
+double magnus_dew_point(double e) {
+  double g = std::log(e / 6.112);
+  return 243.12 * g / (17.62 - g);
+}
+
+bool check_table() {
+  double max_rel = 0.0, max_rel_t = 0.0, max_round = 0.0, max_dew = 0.0;
+  for (int k = 0; k <= 12000; k++) {
+    float t = PSYCHRO_T_MIN + 0.01f * (float) k;
+    double exact = magnus_es(t);
+    float es = saturation_vapor_pressure(t);
+    double rel = std::fabs(es - exact) / exact;
+    if (rel > max_rel) {
+      max_rel = rel;
+      max_rel_t = t;
+    }
+    max_round = std::max(max_round, (double) std::fabs(dew_point_from_vapor_pressure(es) - t));
+    max_dew = std::max(max_dew, std::fabs(dew_point_from_vapor_pressure((float) exact) - magnus_dew_point(exact)));
+  }
+  bool ok = max_rel < 0.00125 && max_round <= 0.001 && max_dew <= 0.02;
+  printf("saturation pressure table: max relative error %.3f %% (at %.2f °C)%s\n", 100.0 * max_rel, max_rel_t,
+         max_rel < 0.00125 ? "" : "  FAIL");
+  printf("dew point: round trip max %.5f °C%s, vs Magnus inverse max %.4f °C%s\n", max_round,
+         max_round <= 0.001 ? "" : "  FAIL", max_dew, max_dew <= 0.02 ? "" : "  FAIL");
+  return ok;
+}
+
+struct Case {
+  const char *name;
+  float levels[4];
+  float sigma[4];  // T_in, RH_in, T_out, RH_out
+  float corr_in;   // T/RH correlation on each side
+};
+
+// P4 row-major (double) from the case, and the packed float block psychro_unscented() takes.
+void covariance(const Case &c, double *P, float *P4) {
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      P[i * 4 + j] = 0.0;
+  for (int i = 0; i < 4; i++)
+    P[i * 4 + i] = (double) c.sigma[i] * c.sigma[i];
+  for (int side = 0; side < 2; side++) {
+    int t = 2 * side, h = 2 * side + 1;
+    P[t * 4 + h] = P[h * 4 + t] = (double) c.corr_in * c.sigma[t] * c.sigma[h];
+  }
+  for (int i = 0; i < 4; i++)
+    for (int j = i; j < 4; j++)
+      P4[ut_packed_index<4>(i, j)] = (float) P[i * 4 + j];
+}
+
+bool check_case(const Case &c, int draws, double tolerance, double var_tolerance, std::mt19937_64 &rng) {
+  double P[16], L[16] = {};
+  float P4[10];
+  covariance(c, P, P4);
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j <= i; j++) {
+      double s = P[i * 4 + j];
+      for (int k = 0; k < j; k++)
+        s -= L[i * 4 + k] * L[j * 4 + k];
+      L[i * 4 + j] = i == j ? std::sqrt(s) : s / L[j * 4 + j];
+    }
+  }
+
+  std::normal_distribution<double> normal(0.0, 1.0);
+  double sum[PSYCHRO_OUTPUT_COUNT] = {}, sum2[PSYCHRO_OUTPUT_COUNT] = {};
+  for (int d = 0; d < draws; d++) {
+    double u[4];
+    for (double &v : u)
+      v = normal(rng);
+    float x[4], y[PSYCHRO_OUTPUT_COUNT];
+    for (int i = 0; i < 4; i++) {
+      double v = c.levels[i];
+      for (int k = 0; k <= i; k++)
+        v += L[i * 4 + k] * u[k];
+      x[i] = (float) v;
+    }
+    psychro_outputs(x, PRESSURE_HPA, y);
+    for (int o = 0; o < PSYCHRO_OUTPUT_COUNT; o++) {
+      sum[o] += y[o];
+      sum2[o] += (double) y[o] * y[o];
+    }
+  }
+
+  float mean[PSYCHRO_OUTPUT_COUNT], var[PSYCHRO_OUTPUT_COUNT];
+  psychro_unscented(c.levels, P4, PRESSURE_HPA, mean, var);
+  printf("\n%s: T_in %.1f±%.2f RH_in %.0f±%.1f T_out %.1f±%.2f RH_out %.0f±%.1f, T/RH corr %.1f\n", c.name,
+         c.levels[0], c.sigma[0], c.levels[1], c.sigma[1], c.levels[2], c.sigma[2], c.levels[3], c.sigma[3],
+         c.corr_in);
+  printf("  %-15s %11s %11s %11s %11s\n", "output", "UT mean", "MC mean", "dmean/sd", "var UT/MC");
+  bool ok = true;
+  for (int o = 0; o < PSYCHRO_OUTPUT_COUNT; o++) {
+    double mc_mean = sum[o] / draws;
+    double mc_var = std::max(sum2[o] / draws - mc_mean * mc_mean, 1e-30);
+    double dm = std::fabs(mean[o] - mc_mean) / std::sqrt(mc_var);
+    double ratio = var[o] / mc_var;
+    bool pass =
+        std::isfinite(mean[o]) && dm <= tolerance && std::fabs(std::log(ratio)) <= std::log(1.0 + var_tolerance);
+    ok = ok && pass;
+    printf("  %-15s %11.4f %11.4f %11.4f %11.4f%s\n", OUTPUT_NAMES[o], mean[o], mc_mean, dm, ratio,
+           pass ? "" : "  FAIL");
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int draws = 400000;
+  double tolerance = 0.03;
+  double var_tolerance = 0.02;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc) {
+      draws = std::max(1000, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--var-tolerance") == 0 && i + 1 < argc) {
+      var_tolerance = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--draws N] [--tolerance T] [--var-tolerance T]\n", argv[0]);
+      return 2;
+    }
+  }
+  bool ok = check_table();
+
+  const Case cases[] = {
+      {"heating, typical sigma", {21.0f, 45.0f, 35.0f, 25.0f}, {0.2f, 0.5f, 0.05f, 0.05f}, 0.0f},
+      {"heating, wide sigma", {21.0f, 45.0f, 35.0f, 25.0f}, {1.0f, 3.0f, 0.5f, 1.0f}, -0.5f},
+      {"cooling, wide sigma", {26.0f, 60.0f, 12.0f, 85.0f}, {1.0f, 3.0f, 0.5f, 2.0f}, -0.5f},
+      {"cold, wide sigma", {-10.0f, 80.0f, 5.0f, 40.0f}, {1.0f, 3.0f, 0.5f, 1.0f}, -0.3f},
+  };
+  std::mt19937_64 rng(5);
+  for (const Case &c : cases)
+    ok = check_case(c, draws, tolerance, var_tolerance, rng) && ok;
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
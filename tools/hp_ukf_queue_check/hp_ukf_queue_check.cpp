@@ -0,0 +1,208 @@
+// Host check of the measurement queue (MeasurementQueue in hp_ukf_queue.h, no ESPHome headers).
+//
+// Four channels sample at 1 Hz with their own phase and jitter. The inlet readings reach the queue
+// after 0-200 ms, the outlet readings after 0.8-1.6 s, and 0.5 % of all readings after 5 s, so
+// arrivals are out of order and often span a process() call. The queue is processed every
+// update_interval (1 s) with a 2 s queue_window, through the step of HpUkfComponent::filter_step_()
+// (predict with Q scaled by dt / update_interval, then a masked update). The reference fuses the
+// same samples in time order, without the queue, and skips the 5 s ones, which arrive behind the
+// checkpoint and must be dropped. The rollback state (Extra) counts the steps and sums dt, so a
+// checkpoint restore that misses it shows up as a mismatch.
+//
+// Checked for 8 and 4 states: after every process() call the checkpoint (everything up to it is
+// final), and at the end the live filter, must equal the reference at that time bit for bit in x
+// and P, with the same Extra; the dropped count must equal the number of 5 s samples, and at least
+// one replay must have happened.
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_queue_check check
+//   tools/hp_ukf_queue_check/hp_ukf_queue_check [--samples N]
+//
+// Exits non-zero on any mismatch.
+
+#include "hp_ukf/hp_ukf_queue.h"
+#include "hp_ukf/hp_ukf_ukf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using esphome::hp_ukf::HpUkfFilterT;
+using esphome::hp_ukf::MeasurementQueue;
+using esphome::hp_ukf::TimedMeasurement;
+using esphome::hp_ukf::time_before;
+
+namespace {
+
+constexpr int M = 4;
+constexpr int QUEUE_SIZE = 16;
+constexpr uint32_t UPDATE_INTERVAL_MS = 1000;
+constexpr uint32_t QUEUE_WINDOW_MS = 2000;
+constexpr uint32_t LATE_MS = 5000;
+constexpr uint32_t T0_MS = 100000;
+const uint32_t PHASE_MS[M] = {0, 130, 470, 820};
+
+// State that rolls back with the filter (stands in for the control model state).
+struct Extra {
+  int steps = 0;
+  float dt_sum = 0.0f;
+  bool operator==(const Extra &o) const { return steps == o.steps && dt_sum == o.dt_sum; }
+};
+
+struct Arrival {
+  uint32_t arrive_ms;
+  TimedMeasurement m;
+};
+
+struct Input {
+  std::vector<Arrival> arrivals;       // in arrival order
+  std::vector<TimedMeasurement> kept;  // in time order, without the 5 s samples
+  int late = 0;
+};
+
+Input make_input(int seconds) {
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<uint32_t> jitter(0, 40);
+  std::uniform_int_distribution<uint32_t> inlet_delay(0, 200);
+  std::uniform_int_distribution<uint32_t> outlet_delay(800, 1600);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::normal_distribution<float> noise(0.0f, 1.0f);
+  const float base[M] = {21.0f, 45.0f, 35.0f, 25.0f};
+  const float amp[M] = {0.5f, 2.0f, 6.0f, -4.0f};
+  const float sd[M] = {0.3f, 0.5f, 0.03f, 0.015f};
+  Input in;
+  for (int k = 0; k < seconds; k++) {
+    for (int c = 0; c < M; c++) {
+      TimedMeasurement m;
+      m.t_ms = T0_MS + 1000u * k + PHASE_MS[c] + jitter(rng);
+      m.channel = static_cast<uint8_t>(c);
+      m.value = base[c] + amp[c] * std::sin(6.2831853f * m.t_ms / 900000.0f) + sd[c] * noise(rng);
+      uint32_t delay = c <= 1 ? inlet_delay(rng) : outlet_delay(rng);
+      bool late = u(rng) < 0.005f;
+      if (late) {
+        delay = LATE_MS;
+        in.late++;
+      } else {
+        in.kept.push_back(m);
+      }
+      in.arrivals.push_back({m.t_ms + delay, m});
+    }
+  }
+  std::stable_sort(in.arrivals.begin(), in.arrivals.end(),
+                   [](const Arrival &a, const Arrival &b) { return time_before(a.arrive_ms, b.arrive_ms); });
+  std::stable_sort(in.kept.begin(), in.kept.end(),
+                   [](const TimedMeasurement &a, const TimedMeasurement &b) { return time_before(a.t_ms, b.t_ms); });
+  return in;
+}
+
+// HpUkfComponent::filter_step_() without control inputs and diagnostics, plus the Extra count.
+template<int NX>
+void step(HpUkfFilterT<NX> &f, Extra &extra, uint32_t &last_ms, uint32_t t_ms, const float *z, const bool *mask) {
+  int32_t elapsed_ms = static_cast<int32_t>(t_ms - last_ms);
+  if (elapsed_ms > 0) {
+    float dt_s = std::max(1e-6f, std::min(elapsed_ms / 1000.0f, 3600.0f));
+    f.set_process_noise_scale(dt_s * 1000.0f / (float) UPDATE_INTERVAL_MS);
+    f.predict(dt_s);
+    last_ms = t_ms;
+    extra.dt_sum += dt_s;
+  }
+  f.update(z, mask);
+  extra.steps++;
+}
+
+template<int NX> void init(HpUkfFilterT<NX> &f) {
+  float x0[NX] = {21.0f, 45.0f, 35.0f, 25.0f};
+  float P0[NX * NX] = {};
+  for (int i = 0; i < NX; i++)
+    P0[i * NX + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+}
+
+// The reference filter with every kept sample up to and including t_ms fused, one at a time.
+template<int NX> struct Reference {
+  HpUkfFilterT<NX> f;
+  Extra extra;
+  uint32_t last_ms = T0_MS;
+  size_t next = 0;
+
+  void advance_to(const std::vector<TimedMeasurement> &kept, uint32_t t_ms) {
+    while (next < kept.size() && !time_before(t_ms, kept[next].t_ms)) {
+      float z[M] = {NAN, NAN, NAN, NAN};
+      bool mask[M] = {false, false, false, false};
+      z[kept[next].channel] = kept[next].value;
+      mask[kept[next].channel] = true;
+      step(f, extra, last_ms, kept[next].t_ms, z, mask);
+      next++;
+    }
+  }
+};
+
+template<int NX> bool same(const HpUkfFilterT<NX> &a, const HpUkfFilterT<NX> &b) {
+  return memcmp(a.get_state(), b.get_state(), sizeof(float) * NX) == 0 &&
+         memcmp(a.get_covariance_packed(), b.get_covariance_packed(),
+                sizeof(float) * HpUkfFilterT<NX>::N_PACKED) == 0;
+}
+
+template<int NX> bool run(const Input &in) {
+  using Filter = HpUkfFilterT<NX>;
+  Filter filter;
+  init(filter);
+  Extra extra;
+  uint32_t filter_ms = T0_MS;
+  MeasurementQueue<Filter, Extra, QUEUE_SIZE> queue;
+  queue.checkpoint(filter, extra, filter_ms);
+  Reference<NX> ref;
+  init(ref.f);
+
+  int checks = 0, mismatches = 0;
+  size_t a = 0;
+  uint32_t end_ms = in.arrivals.back().arrive_ms + UPDATE_INTERVAL_MS;
+  for (uint32_t now = T0_MS + UPDATE_INTERVAL_MS / 2; !time_before(end_ms, now); now += UPDATE_INTERVAL_MS) {
+    for (; a < in.arrivals.size() && time_before(in.arrivals[a].arrive_ms, now); a++)
+      queue.push(in.arrivals[a].m);
+    queue.process(filter, extra, filter_ms, now, QUEUE_WINDOW_MS,
+                  [&](uint32_t t_ms, const float *z, const bool *mask) {
+                    step(filter, extra, filter_ms, t_ms, z, mask);
+                  });
+    // Every sample up to the checkpoint is final: the checkpoint must be the in-order filter.
+    ref.advance_to(in.kept, queue.get_checkpoint_ms());
+    checks++;
+    if (!same(queue.get_checkpoint(), ref.f) || !(queue.get_extra_checkpoint() == ref.extra) ||
+        ref.last_ms != queue.get_checkpoint_ms()) {
+      if (mismatches++ == 0)
+        printf("  first mismatch at checkpoint %u ms (step %d vs %d)\n",
+               (unsigned) (queue.get_checkpoint_ms() - T0_MS), queue.get_extra_checkpoint().steps, ref.extra.steps);
+    }
+  }
+  ref.advance_to(in.kept, filter_ms);
+  bool final_ok = ref.next == in.kept.size() && same(filter, ref.f) && extra == ref.extra;
+
+  bool ok = mismatches == 0 && final_ok && queue.get_dropped() == (uint32_t) in.late && queue.get_replays() > 0;
+  printf("N=%d: %zu samples, %d checks, %d mismatch(es), final %s, %u replays, %u dropped (%d late)%s\n", NX,
+         in.arrivals.size(), checks, mismatches, final_ok ? "equal" : "DIFFERENT", (unsigned) queue.get_replays(),
+         (unsigned) queue.get_dropped(), in.late, ok ? "" : "  FAIL");
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int seconds = 3600;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      seconds = std::max(10, atoi(argv[++i]));
+    } else {
+      fprintf(stderr, "usage: %s [--samples N]\n", argv[0]);
+      return 2;
+    }
+  }
+  Input in = make_input(seconds);
+  bool ok = run<8>(in);
+  ok = run<4>(in) && ok;
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
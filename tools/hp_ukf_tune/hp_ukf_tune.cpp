@@ -0,0 +1,483 @@
+// Offline trace replay and Q/R tuner for HpUkfFilterT<4> and HpUkfFilterT<8> (no ESPHome headers).
+//
+// Replays a recorded trace of the four inputs through the same filter code as the device, far
+// faster than real time, and searches Q/R diagonals (and with --em the EM lambdas and
+// em_inflation) for the configuration whose innovations best fit the data. Candidates are
+// evaluated in parallel on all cores.
+//
+// Score: mean negative log-likelihood of the innovations per measured scalar (lower is better),
+//   0.5 * (log det(2*pi*S) + nu' S^-1 nu) / m,  S = H P- H' + R,
+// accumulated after --skip warm-up rows. NIS/dof (nu' S^-1 nu averaged per scalar) is reported
+// alongside; a consistent filter has NIS/dof close to 1.
+//
+// Trace formats: see tools/common/hp_ukf_trace.h (CSV t_ms,t_in,rh_in,t_out,rh_out or .bin).
+//
+// Build and run (see Makefile):
+//   make -C tools/hp_ukf_tune
+//   tools/hp_ukf_tune/hp_ukf_tune trace.csv --em --rounds 4
+
+#include "hp_ukf/hp_ukf_ukf.h"
+#include "hp_ukf_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using esphome::hp_ukf::FilterMode;
+using esphome::hp_ukf::HpUkfFilterT;
+using hp_ukf_tools::load_trace;
+using hp_ukf_tools::Sample;
+
+namespace {
+
+constexpr int M = 4;
+constexpr double LOG_2PI = 1.8378770664093453;
+
+struct Options {
+  const char *trace_path = nullptr;
+  int n = 8;
+  FilterMode mode = esphome::hp_ukf::FILTER_MODE_UKF;
+  bool sequential = false;
+  bool em = false;
+  bool grid = true;
+  int skip = 60;
+  int rounds = 3;
+  int jobs = 0;
+  int top = 10;
+};
+
+// ---------------------------------------------------------------------------
+// Parameters: Q diagonal (n), R diagonal (4), then with --em the three lambdas and
+// em_inflation. Q/R are searched on a log scale, lambdas on log(1 - lambda).
+// ---------------------------------------------------------------------------
+
+constexpr int MAX_PARAMS = 16;
+constexpr int P_LAMBDA_Q = 12;
+constexpr int P_LAMBDA_R_IN = 13;
+constexpr int P_LAMBDA_R_OUT = 14;
+constexpr int P_INFLATION = 15;
+
+const char *const PARAM_NAMES[MAX_PARAMS] = {
+    "q_t_in", "q_rh_in", "q_t_out", "q_rh_out", "q_dt_in", "q_dt_out", "q_drh_in", "q_drh_out",
+    "r_t_in", "r_rh_in", "r_t_out", "r_rh_out", "em_lambda_q", "em_lambda_r_inlet", "em_lambda_r_outlet",
+    "em_inflation"};
+
+struct Params {
+  double v[MAX_PARAMS];
+};
+
+struct Score {
+  double nll;
+  double nis_per_dof;
+  long dof;
+  bool finite;
+};
+
+struct Result {
+  Params p;
+  Score s;
+};
+
+// Slots in Params::v that are active for this run (Q slots beyond n are unused).
+std::vector<int> active_params(const Options &opt) {
+  std::vector<int> idx;
+  for (int i = 0; i < opt.n; i++)
+    idx.push_back(i);
+  for (int i = 0; i < M; i++)
+    idx.push_back(8 + i);
+  if (opt.em) {
+    for (int i = P_LAMBDA_Q; i <= P_INFLATION; i++)
+      idx.push_back(i);
+  }
+  return idx;
+}
+
+// Move parameter `k` by `steps` multiples of log(factor), staying in its valid range.
+double step_param(int k, double value, double factor, int steps) {
+  if (k == P_INFLATION)
+    return std::min(2.0, std::max(0.0, value + steps * 0.25 * std::log(factor)));
+  if (k >= P_LAMBDA_Q) {
+    double one_minus = (1.0 - value) * std::pow(factor, steps);
+    return 1.0 - std::min(0.1, std::max(1e-5, one_minus));
+  }
+  return std::max(1e-9, value * std::pow(factor, steps));
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------
+
+// Innovation log-likelihood for the measured channels: S = P[idx, idx] + R (m <= 4), Cholesky
+// in double. Returns false if S is not positive definite.
+template<typename F>
+bool innovation_terms(const float *x, const float *P_packed, const float *r_diag, const float *z, const bool *mask,
+                      double &log_det, double &nis, int &m) {
+  int idx[M];
+  m = 0;
+  for (int c = 0; c < M; c++)
+    if (mask[c])
+      idx[m++] = c;
+  double L[M * M] = {};
+  double nu[M];
+  for (int a = 0; a < m; a++) {
+    nu[a] = static_cast<double>(z[idx[a]]) - x[idx[a]];
+    for (int b = 0; b <= a; b++) {
+      double s = P_packed[F::packed_index(idx[b], idx[a])] + (a == b ? r_diag[idx[a]] : 0.0);
+      for (int k = 0; k < b; k++)
+        s -= L[a * M + k] * L[b * M + k];
+      if (a == b) {
+        if (!(s > 0.0))
+          return false;
+        L[a * M + a] = std::sqrt(s);
+      } else {
+        L[a * M + b] = s / L[b * M + b];
+      }
+    }
+  }
+  log_det = 0.0;
+  nis = 0.0;
+  for (int a = 0; a < m; a++) {
+    double s = nu[a];
+    for (int k = 0; k < a; k++)
+      s -= L[a * M + k] * nu[k];
+    nu[a] = s / L[a * M + a];  // forward solve: nu' S^-1 nu = |L^-1 nu|^2
+    nis += nu[a] * nu[a];
+    log_det += 2.0 * std::log(L[a * M + a]);
+  }
+  return true;
+}
+
+// Same call sequence as HpUkfComponent::setup() and filter_step_() (separate predict/update,
+// update only when the timestamp did not advance, dt clamped to 1 h).
+template<typename F> Score replay(const std::vector<Sample> &trace, const Params &p, const Options &opt) {
+  constexpr int n = F::N;
+  F f;
+  f.set_filter_mode(opt.mode);
+  f.set_sequential_update(opt.sequential);
+  float x0[n] = {20.0f, 50.0f, 20.0f, 50.0f};
+  for (int c = 0; c < M; c++) {
+    for (const Sample &s : trace) {
+      if (std::isfinite(s.z[c])) {
+        x0[c] = s.z[c];
+        break;
+      }
+    }
+  }
+  float P0[n * n] = {};
+  for (int i = 0; i < n; i++)
+    P0[i * n + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+  if (opt.em) {
+    f.enable_em_autotune(true);
+    f.set_em_lambda_q(static_cast<float>(p.v[P_LAMBDA_Q]));
+    f.set_em_lambda_r_inlet(static_cast<float>(p.v[P_LAMBDA_R_IN]));
+    f.set_em_lambda_r_outlet(static_cast<float>(p.v[P_LAMBDA_R_OUT]));
+    f.set_em_inflation(static_cast<float>(p.v[P_INFLATION]));
+  }
+  float Q[n * n] = {};
+  float R[M * M] = {};
+  for (int i = 0; i < n; i++)
+    Q[i * n + i] = static_cast<float>(p.v[i]);
+  for (int i = 0; i < M; i++)
+    R[i * M + i] = static_cast<float>(p.v[8 + i]);
+  f.set_process_noise(Q);
+  f.set_measurement_noise(R);
+
+  Score sc{0.0, 0.0, 0, true};
+  double nis_sum = 0.0;
+  uint32_t last_ms = trace[0].t_ms;
+  for (size_t k = 0; k < trace.size(); k++) {
+    const Sample &s = trace[k];
+    float dt_s = hp_ukf_tools::step_dt(last_ms, s.t_ms);
+    if (dt_s > 0.0f) {
+      f.predict(dt_s);
+      last_ms = s.t_ms;
+    }
+    bool mask[M];
+    int m_avail = 0;
+    for (int c = 0; c < M; c++) {
+      mask[c] = std::isfinite(s.z[c]);
+      m_avail += mask[c] ? 1 : 0;
+    }
+    if (m_avail == 0)
+      continue;
+    if (static_cast<int>(k) >= opt.skip) {
+      float r_diag[M];
+      f.get_measurement_noise_diag(r_diag);
+      double log_det, nis;
+      int m;
+      if (!innovation_terms<F>(f.get_state(), f.get_covariance_packed(), r_diag, s.z, mask, log_det, nis, m)) {
+        sc.finite = false;
+        break;
+      }
+      sc.nll += 0.5 * (m * LOG_2PI + log_det + nis);
+      nis_sum += nis;
+      sc.dof += m;
+    }
+    f.update(s.z, mask);
+  }
+  const float *x = f.get_state();
+  for (int i = 0; i < n; i++)
+    sc.finite = sc.finite && std::isfinite(x[i]);
+  if (!sc.finite || sc.dof == 0 || !std::isfinite(sc.nll)) {
+    sc.finite = false;
+    sc.nll = INFINITY;
+    sc.nis_per_dof = INFINITY;
+    return sc;
+  }
+  sc.nll /= sc.dof;
+  sc.nis_per_dof = nis_sum / sc.dof;
+  return sc;
+}
+
+template<typename F> Params default_params() {
+  F f;
+  float q_diag[F::N], r_diag[M];
+  f.get_process_noise_diag(q_diag);
+  f.get_measurement_noise_diag(r_diag);
+  Params p{};
+  for (int i = 0; i < F::N; i++)
+    p.v[i] = q_diag[i];
+  for (int i = 0; i < M; i++)
+    p.v[8 + i] = r_diag[i];
+  p.v[P_LAMBDA_Q] = f.get_em_lambda_q();
+  p.v[P_LAMBDA_R_IN] = f.get_em_lambda_r_inlet();
+  p.v[P_LAMBDA_R_OUT] = f.get_em_lambda_r_outlet();
+  p.v[P_INFLATION] = 0.5;
+  return p;
+}
+
+// ---------------------------------------------------------------------------
+// Parallel evaluation and search
+// ---------------------------------------------------------------------------
+
+template<typename F>
+std::vector<Result> evaluate(const std::vector<Sample> &trace, const std::vector<Params> &cands, const Options &opt) {
+  std::vector<Result> out(cands.size());
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+    for (size_t i = next++; i < cands.size(); i = next++)
+      out[i] = Result{cands[i], replay<F>(trace, cands[i], opt)};
+  };
+  int jobs = opt.jobs > 0 ? opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (int t = 1; t < jobs; t++)
+    threads.emplace_back(worker);
+  worker();
+  for (auto &t : threads)
+    t.join();
+  return out;
+}
+
+bool better(const Result &a, const Result &b) { return a.s.nll < b.s.nll; }
+
+// Coarse grid: one scale factor per group (Q levels, Q rates, R inlet, R outlet).
+std::vector<Params> grid_candidates(const Params &base, int n) {
+  const double scales[] = {0.1, 0.3, 1.0, 3.0, 10.0};
+  const int groups = (n >= 8) ? 4 : 3;
+  std::vector<Params> out;
+  int combos = 1;
+  for (int g = 0; g < groups; g++)
+    combos *= 5;
+  for (int c = 0; c < combos; c++) {
+    Params p = base;
+    int rest = c;
+    double s[4] = {1.0, 1.0, 1.0, 1.0};
+    for (int g = 0; g < groups; g++) {
+      s[g] = scales[rest % 5];
+      rest /= 5;
+    }
+    double q_rate = (n >= 8) ? s[1] : 1.0;
+    double r_in = (n >= 8) ? s[2] : s[1];
+    double r_out = (n >= 8) ? s[3] : s[2];
+    for (int i = 0; i < 4; i++)
+      p.v[i] *= s[0];
+    for (int i = 4; i < n; i++)
+      p.v[i] *= q_rate;
+    p.v[8] *= r_in;
+    p.v[9] *= r_in;
+    p.v[10] *= r_out;
+    p.v[11] *= r_out;
+    out.push_back(p);
+  }
+  return out;
+}
+
+// One coordinate round: every active parameter at +/-1 and +/-2 steps, all in one parallel
+// batch. The best single move is compared with the combination of each parameter's best move.
+template<typename F>
+Result coordinate_round(const std::vector<Sample> &trace, const Result &cur, double factor, const Options &opt,
+                        std::vector<Result> &all) {
+  std::vector<int> active = active_params(opt);
+  const int steps[] = {-2, -1, 1, 2};
+  std::vector<Params> cands;
+  for (int k : active) {
+    for (int st : steps) {
+      Params p = cur.p;
+      p.v[k] = step_param(k, p.v[k], factor, st);
+      cands.push_back(p);
+    }
+  }
+  std::vector<Result> res = evaluate<F>(trace, cands, opt);
+  all.insert(all.end(), res.begin(), res.end());
+
+  Result best = cur;
+  Params combined = cur.p;
+  bool any = false;
+  for (size_t a = 0; a < active.size(); a++) {
+    const Result *pb = nullptr;
+    for (int s = 0; s < 4; s++) {
+      const Result &r = res[a * 4 + s];
+      if (r.s.finite && better(r, pb ? *pb : cur))
+        pb = &r;
+    }
+    if (pb == nullptr)
+      continue;
+    combined.v[active[a]] = pb->p.v[active[a]];
+    any = true;
+    if (better(*pb, best))
+      best = *pb;
+  }
+  if (any) {
+    std::vector<Result> comb = evaluate<F>(trace, {combined}, opt);
+    all.push_back(comb[0]);
+    if (comb[0].s.finite && better(comb[0], best))
+      best = comb[0];
+  }
+  return best;
+}
+
+void print_params(const Params &p, const Options &opt) {
+  for (int k : active_params(opt))
+    printf("  %-19s %.6e\n", PARAM_NAMES[k], p.v[k]);
+}
+
+template<typename F> int run(const std::vector<Sample> &trace, const Options &opt) {
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<Result> all;
+  Params base = default_params<F>();
+  Result best = evaluate<F>(trace, {base}, opt)[0];
+  all.push_back(best);
+  printf("defaults: nll/dof %.4f  NIS/dof %.3f%s\n", best.s.nll, best.s.nis_per_dof, best.s.finite ? "" : "  NON-FINITE");
+
+  if (opt.grid) {
+    std::vector<Result> res = evaluate<F>(trace, grid_candidates(base, F::N), opt);
+    all.insert(all.end(), res.begin(), res.end());
+    for (const Result &r : res)
+      if (r.s.finite && better(r, best))
+        best = r;
+    printf("grid (%zu configs): nll/dof %.4f  NIS/dof %.3f\n", res.size(), best.s.nll, best.s.nis_per_dof);
+  }
+
+  double factor = 3.0;
+  for (int round = 0; round < opt.rounds; round++) {
+    best = coordinate_round<F>(trace, best, factor, opt, all);
+    printf("round %d (step x%.2f): nll/dof %.4f  NIS/dof %.3f\n", round + 1, factor, best.s.nll,
+           best.s.nis_per_dof);
+    factor = std::sqrt(factor);
+  }
+
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  double span_s = static_cast<uint32_t>(trace.back().t_ms - trace.front().t_ms) / 1000.0;
+  printf("\n%zu replays of %zu samples (%.1f h of data) in %.2f s\n", all.size(), trace.size(), span_s / 3600.0,
+         secs);
+
+  std::sort(all.begin(), all.end(), better);
+  int shown = std::min<int>(opt.top, static_cast<int>(all.size()));
+  printf("\ntop %d:\n%4s %10s %8s  %s\n", shown, "rank", "nll/dof", "NIS/dof", "q_t_in..r_rh_out");
+  for (int i = 0; i < shown; i++) {
+    const Result &r = all[i];
+    printf("%4d %10.4f %8.3f ", i + 1, r.s.nll, r.s.nis_per_dof);
+    for (int k : active_params(opt))
+      if (k < P_LAMBDA_Q)
+        printf(" %.2e", r.p.v[k]);
+    printf("\n");
+  }
+
+  printf("\nbest configuration:\n");
+  print_params(best.p, opt);
+  printf("\nhp_ukf_ukf.h defaults (DEFAULT_Q_DIAG / DEFAULT_R_DIAG):\n");
+  for (int i = 0; i < F::N; i++)
+    printf("  %.7gf,  // %s\n", best.p.v[i], PARAM_NAMES[i]);
+  for (int i = 0; i < M; i++)
+    printf("  %.7gf,  // %s\n", best.p.v[8 + i], PARAM_NAMES[8 + i]);
+  return best.s.finite ? 0 : 1;
+}
+
+bool parse_mode(const char *s, Options &opt) {
+  if (strcmp(s, "ukf") == 0) {
+    opt.mode = esphome::hp_ukf::FILTER_MODE_UKF;
+  } else if (strcmp(s, "ukf_seq") == 0) {
+    opt.mode = esphome::hp_ukf::FILTER_MODE_UKF;
+    opt.sequential = true;
+  } else if (strcmp(s, "sr_ukf") == 0) {
+    opt.mode = esphome::hp_ukf::FILTER_MODE_SR_UKF;
+  } else if (strcmp(s, "linear_kf") == 0) {
+    opt.mode = esphome::hp_ukf::FILTER_MODE_LINEAR_KF;
+  } else if (strcmp(s, "ud") == 0) {
+    opt.mode = esphome::hp_ukf::FILTER_MODE_UD;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s TRACE(.csv|.bin) [--n 4|8] [--mode ukf|ukf_seq|sr_ukf|linear_kf|ud] [--em]\n"
+          "       [--no-grid] [--rounds N] [--skip ROWS] [--jobs N] [--top N]\n",
+          argv0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--n") == 0 && i + 1 < argc) {
+      opt.n = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+      if (!parse_mode(argv[++i], opt)) {
+        usage(argv[0]);
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--em") == 0) {
+      opt.em = true;
+    } else if (strcmp(argv[i], "--no-grid") == 0) {
+      opt.grid = false;
+    } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      opt.rounds = std::max(0, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc) {
+      opt.skip = std::max(0, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      opt.jobs = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+      opt.top = std::max(1, atoi(argv[++i]));
+    } else if (argv[i][0] != '-' && opt.trace_path == nullptr) {
+      opt.trace_path = argv[i];
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (opt.trace_path == nullptr || (opt.n != 4 && opt.n != 8)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<Sample> trace;
+  if (!load_trace(opt.trace_path, trace))
+    return 2;
+  if (static_cast<int>(trace.size()) <= opt.skip) {
+    fprintf(stderr, "trace has %zu rows, need more than --skip %d\n", trace.size(), opt.skip);
+    return 2;
+  }
+  return opt.n == 8 ? run<HpUkfFilterT<8>>(trace, opt) : run<HpUkfFilterT<4>>(trace, opt);
+}
@@ -0,0 +1,220 @@
+// Host-side check of the worker_task concurrency layer (hp_ukf_worker.h) with std::thread
+// (no ESPHome headers).
+//
+// Three threads play the component's roles: the producer pushes samples into the SpscRing and
+// notifies the WorkerThread (update()), the worker drains the ring, steps HpUkfFilterT and
+// publishes an estimate per batch through the SpscSnapshot (worker_run_()), and the consumer
+// polls the snapshot (loop()). Each estimate carries the number of samples fused so far and
+// must equal, bit for bit, the state a sequential replay has after that many samples; a torn
+// or reordered snapshot shows up as a mismatch. The producer yields while the ring is full
+// instead of dropping, so every sample is fused.
+//
+// Build and run (see Makefile; `make tsan` builds with ThreadSanitizer):
+//   make -C tools/hp_ukf_worker_check check
+//   tools/hp_ukf_worker_check/hp_ukf_worker_check [TRACE(.csv|.bin)] [--samples N] [--rounds R]
+//
+// Without a trace a synthetic heat pump cycle is used. Exits non-zero on any mismatch.
+
+#include "hp_ukf/hp_ukf_ukf.h"
+#include "hp_ukf/hp_ukf_worker.h"
+#include "hp_ukf_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+using esphome::hp_ukf::HpUkfFilterT;
+using esphome::hp_ukf::SpscRing;
+using esphome::hp_ukf::SpscSnapshot;
+using esphome::hp_ukf::WorkerThread;
+using hp_ukf_tools::Sample;
+
+namespace {
+
+constexpr int N = 8;
+constexpr int M = 4;
+using Filter = HpUkfFilterT<N>;
+
+struct Estimate {
+  uint32_t fused;
+  float x[N];
+  float P[Filter::N_PACKED];
+};
+
+void init_filter(Filter &f, const std::vector<Sample> &trace) {
+  float x0[N] = {20.0f, 50.0f, 20.0f, 50.0f};
+  for (int c = 0; c < M; c++)
+    if (std::isfinite(trace[0].z[c]))
+      x0[c] = trace[0].z[c];
+  float P0[N * N] = {};
+  for (int i = 0; i < N; i++)
+    P0[i * N + i] = 1.0f;
+  f.set_initial_state(x0, P0);
+}
+
+void step(Filter &f, uint32_t &last_ms, const Sample &s) {
+  float dt_s = hp_ukf_tools::step_dt(last_ms, s.t_ms);
+  if (dt_s > 0.0f) {
+    f.predict(dt_s);
+    last_ms = s.t_ms;
+  }
+  bool mask[M];
+  for (int c = 0; c < M; c++)
+    mask[c] = std::isfinite(s.z[c]);
+  f.update(s.z, mask);
+}
+
+// 1 s samples of a defrost-like cycle with sensor noise and occasional missing readings.
+std::vector<Sample> synthetic_trace(int count) {
+  std::mt19937 rng(2024);
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+  std::vector<Sample> out;
+  for (int k = 0; k < count; k++) {
+    float phase = 6.2831853f * k / 900.0f;
+    Sample s;
+    s.t_ms = 1000u * k;
+    s.z[0] = 21.0f + 0.5f * std::sin(phase) + noise(rng);
+    s.z[1] = 45.0f + 2.0f * std::cos(phase) + 4.0f * noise(rng);
+    s.z[2] = 35.0f + 8.0f * std::sin(phase) + noise(rng);
+    s.z[3] = 25.0f - 5.0f * std::sin(phase) + 4.0f * noise(rng);
+    for (float &z : s.z)
+      if (u(rng) < 0.02f)
+        z = NAN;
+    out.push_back(s);
+  }
+  return out;
+}
+
+struct Shared {
+  const std::vector<Sample> *trace;
+  Filter filter;
+  uint32_t last_ms;
+  WorkerThread worker;
+  SpscRing<Sample, 8> samples;
+  SpscSnapshot<Estimate> estimates;
+  std::atomic<bool> stop{false};
+};
+
+void worker_entry(void *arg) {
+  Shared &sh = *static_cast<Shared *>(arg);
+  uint32_t fused = 0;
+  Sample s;
+  while (!sh.stop.load()) {
+    sh.worker.wait();
+    bool stepped = false;
+    while (sh.samples.pop(s)) {
+      step(sh.filter, sh.last_ms, s);
+      fused++;
+      stepped = true;
+    }
+    if (stepped) {
+      Estimate &e = sh.estimates.write_buffer();
+      e.fused = fused;
+      memcpy(e.x, sh.filter.get_state(), sizeof(e.x));
+      memcpy(e.P, sh.filter.get_covariance_packed(), sizeof(e.P));
+      sh.estimates.publish();
+    }
+  }
+}
+
+bool same(const float *a, const float *b, int n) { return memcmp(a, b, sizeof(float) * n) == 0; }
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *trace_path = nullptr;
+  int samples = 20000;
+  int rounds = 5;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = std::max(1, atoi(argv[++i]));
+    } else if (argv[i][0] != '-' && trace_path == nullptr) {
+      trace_path = argv[i];
+    } else {
+      fprintf(stderr, "usage: %s [TRACE(.csv|.bin)] [--samples N] [--rounds R]\n", argv[0]);
+      return 2;
+    }
+  }
+  std::vector<Sample> trace;
+  if (trace_path != nullptr) {
+    if (!hp_ukf_tools::load_trace(trace_path, trace))
+      return 2;
+  } else {
+    trace = synthetic_trace(samples);
+  }
+
+  // Sequential reference: state and covariance after each fused sample.
+  std::vector<float> ref_x(trace.size() * N), ref_P(trace.size() * Filter::N_PACKED);
+  {
+    Filter f;
+    init_filter(f, trace);
+    uint32_t last_ms = trace[0].t_ms;
+    for (size_t k = 0; k < trace.size(); k++) {
+      step(f, last_ms, trace[k]);
+      memcpy(&ref_x[k * N], f.get_state(), sizeof(float) * N);
+      memcpy(&ref_P[k * Filter::N_PACKED], f.get_covariance_packed(), sizeof(float) * Filter::N_PACKED);
+    }
+  }
+
+  bool ok = true;
+  for (int r = 0; r < rounds && ok; r++) {
+    // Leaked on purpose: the detached worker may still be inside wait() when main returns.
+    Shared *sh = new Shared();
+    sh->trace = &trace;
+    init_filter(sh->filter, trace);
+    sh->last_ms = trace[0].t_ms;
+    if (!sh->worker.start("hp_ukf", 4096, 1, 1, worker_entry, sh)) {
+      fprintf(stderr, "worker start failed\n");
+      return 1;
+    }
+
+    long snapshots = 0, mismatches = 0, regressions = 0;
+    uint32_t last_fused = 0;
+    std::thread consumer([&] {
+      while (last_fused < trace.size()) {
+        if (!sh->estimates.consume()) {
+          std::this_thread::yield();
+          continue;
+        }
+        const Estimate &e = sh->estimates.read_buffer();
+        snapshots++;
+        if (e.fused <= last_fused || e.fused > trace.size()) {
+          regressions++;
+          break;
+        }
+        last_fused = e.fused;
+        size_t k = e.fused - 1;
+        if (!same(e.x, &ref_x[k * N], N) || !same(e.P, &ref_P[k * Filter::N_PACKED], Filter::N_PACKED))
+          mismatches++;
+      }
+    });
+
+    long full = 0;
+    for (const Sample &s : trace) {
+      while (!sh->samples.push(s)) {
+        full++;
+        sh->worker.notify();
+        std::this_thread::yield();
+      }
+      sh->worker.notify();
+    }
+    consumer.join();
+    sh->stop.store(true);
+    sh->worker.notify();
+
+    bool pass = mismatches == 0 && regressions == 0 && last_fused == trace.size();
+    printf("round %d: %zu samples, %ld snapshots, ring full %ld times, %ld mismatch(es), %ld regression(s)%s\n",
+           r + 1, trace.size(), snapshots, full, mismatches, regressions, pass ? "" : "  FAIL");
+    ok = ok && pass;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// Host-side check of the trend_stats engine (components/trend_stats/trend_stats_window.h, no
+// ESPHome headers).
+//
+// A noisy, partly quantized signal with irregular sample spacing, gaps longer than a window and
+// a millis() wrap is fed to TrendClassifier and three TrendWindows. At random publish times
+// each window's sums must equal a brute-force recount of every stored sample whose bucket is
+// still inside the window, and the all-time counts must equal the trend_stats.yaml lambda.
+//
+// Build and run (see Makefile):
+//   make -C tools/trend_stats_check check
+//
+// Exits non-zero on any difference.
+
+#include "trend_stats/trend_stats_window.h"
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using esphome::trend_stats::TREND_COUNTER_COUNT;
+using esphome::trend_stats::TrendClassifier;
+using esphome::trend_stats::TrendCounter;
+using esphome::trend_stats::TrendWindow;
+
+namespace {
+
+// trend_stats.yaml filter lambda, with the globals as members.
+struct LambdaCounts {
+  float previous_value = NAN;
+  int trend = 0;
+  bool reversal_detected = false;
+  long count[TREND_COUNTER_COUNT] = {};
+
+  void operator()(float current_value) {
+    if (std::isnan(previous_value)) {
+      previous_value = current_value;
+      trend = 0;
+      count[0] = 1;
+      return;
+    }
+    count[0]++;
+    int current_trend = 0;
+    if (current_value > previous_value) {
+      current_trend = 1;
+    } else if (current_value < previous_value) {
+      current_trend = -1;
+    } else {
+      count[4]++;
+      return;
+    }
+    bool trend_reversed = (trend != 0 && current_trend != 0 && trend != current_trend);
+    if (trend_reversed) {
+      count[1]++;
+      if (reversal_detected) {
+        count[2]++;
+        reversal_detected = false;
+      } else {
+        reversal_detected = true;
+      }
+    } else {
+      if (trend != 0)
+        count[3]++;
+      reversal_detected = false;
+    }
+    previous_value = current_value;
+    trend = current_trend;
+  }
+};
+
+struct Event {
+  uint64_t t_ms;  // unwrapped
+  uint8_t hits;
+};
+
+}  // namespace
+
+int main() {
+  std::mt19937 rng(7);
+  std::normal_distribution<float> noise(0.0f, 0.3f);
+  std::uniform_real_distribution<float> u(0.0f, 1.0f);
+
+  const uint32_t durations[] = {60000u, 3600000u, 86400000u};
+  const int W = 3;
+  TrendWindow windows[W];
+  for (int w = 0; w < W; w++)
+    windows[w].set_duration(durations[w]);
+
+  TrendClassifier classifier;
+  LambdaCounts lambda;
+  long totals[TREND_COUNTER_COUNT] = {};
+  std::vector<Event> events;
+  uint64_t t = UINT32_MAX - 2u * 86400000u;  // millis() is (uint32_t) t; wraps after two days
+  uint64_t t0 = 0;  // bucket grid origin: the first sample
+  long checks = 0, failures = 0;
+
+  for (int k = 0; k < 600000; k++) {
+    float r = u(rng);
+    t += r < 0.0005f ? 90000000u : (r < 0.01f ? 120000u : 200u + (uint32_t) (u(rng) * 1800.0f));
+    uint32_t millis = (uint32_t) t;
+    if (k == 0)
+      t0 = t;
+    float x = std::round((20.0f + 3.0f * std::sin(k / 5000.0f) + noise(rng)) * 10.0f) / 10.0f;
+    uint8_t hits = classifier.classify(x);
+    lambda(x);
+    for (int c = 0; c < TREND_COUNTER_COUNT; c++)
+      totals[c] += (hits >> c) & 1u;
+    for (auto &w : windows)
+      w.add(millis, hits);
+    events.push_back({t, hits});
+
+    if (u(rng) < 0.002f) {
+      t += (uint64_t) (u(rng) * 5000.0f);  // the next sample is not earlier than this publish
+      for (int w = 0; w < W; w++) {
+        windows[w].advance((uint32_t) t);
+        uint64_t b = durations[w] / TrendWindow::BUCKETS;
+        uint64_t now_bucket = (t - t0) / b;
+        long expect[TREND_COUNTER_COUNT] = {};
+        for (size_t i = events.size(); i-- > 0;) {
+          uint64_t bucket = (events[i].t_ms - t0) / b;
+          if (bucket + TrendWindow::BUCKETS <= now_bucket)
+            break;
+          for (int c = 0; c < TREND_COUNTER_COUNT; c++)
+            expect[c] += (events[i].hits >> c) & 1u;
+        }
+        checks++;
+        for (int c = 0; c < TREND_COUNTER_COUNT; c++) {
+          if ((long) windows[w].sum((TrendCounter) c) != expect[c]) {
+            if (failures++ < 10)
+              printf("mismatch: window %u ms, counter %d, sum %u, expected %ld (t=%u)\n", (unsigned) durations[w], c,
+                     (unsigned) windows[w].sum((TrendCounter) c), expect[c], (unsigned) (t - t0));
+            break;
+          }
+        }
+      }
+    }
+  }
+  for (int c = 0; c < TREND_COUNTER_COUNT; c++) {
+    if (totals[c] != lambda.count[c]) {
+      printf("total mismatch: counter %d, %ld vs lambda %ld\n", c, totals[c], lambda.count[c]);
+      failures++;
+    }
+  }
+  printf("%zu samples, %ld window checks, %ld failure(s); reversals %.2f %%, flatlines %.2f %% of datapoints\n",
+         events.size(), checks, failures, 100.0 * totals[1] / totals[0], 100.0 * totals[4] / totals[0]);
+  printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+  return failures == 0 ? 0 : 1;
+}